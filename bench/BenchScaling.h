@@ -0,0 +1,121 @@
+#ifndef CHESS_BENCH_SCALING_HEADER_GUARD
+#define CHESS_BENCH_SCALING_HEADER_GUARD
+
+#include "BenchUtil.h"
+#include "MockBoard.h"
+#include <dirent.h>
+
+// realtime positions sent to many boards at once, shared by the benchmarks
+// that compare ways of driving many boards
+
+// result of one benchScaling run
+struct BenchScaling {
+  size_t received;
+  size_t sent;
+
+  // CPU of the SDK's threads, the thread sending the positions excluded
+  double cpuPerFrameUs;
+  double cpuPerBoardPercent;
+
+  double p50;
+  double p99;
+
+  // threads of the process while the boards are connected
+  size_t threads;
+};
+
+inline uint64_t benchScalingSentAt[1 << 16];
+inline BenchLatency benchScalingLatency;
+
+// board callback that records the latency of a stamped position
+inline void benchScalingOnBoard(const uint8_t *board, uint64_t) {
+  auto now = benchMicros();
+  benchScalingLatency.add(static_cast<double>(now - benchScalingSentAt[benchSequence(board) & 0xffff]));
+}
+
+// number of threads of the process
+inline size_t benchThreads() {
+  size_t count = 0;
+  if (DIR *dir = opendir("/proc/self/task")) {
+    while (auto entry = readdir(dir)) {
+      count += entry->d_name[0] != '.';
+    }
+    closedir(dir);
+  }
+  return count;
+}
+
+/**
+connect a link to each of the mock boards with makeLink(path), then send
+every board hz positions per second for the given time
+Returns the measurements, received is 0 if a link could not connect
+*/
+template <class MakeLink> BenchScaling benchScaling(MockBoards &boards, long hz, long millis, MakeLink makeLink) {
+  BenchScaling result = {};
+  benchScalingLatency.clear();
+  auto threadsBefore = benchThreads();
+  vector<shared_ptr<ChessLink>> links;
+  for (size_t i = 0; i < boards.size(); i++) {
+    auto link = makeLink(boards.path(i));
+    link->setDuplicateSuppression(false, 0);
+    link->setBoardCallback(benchScalingOnBoard);
+    if (!link->connect()) {
+      return result;
+    }
+    links.push_back(link);
+  }
+  this_thread::sleep_for(chrono::milliseconds(300));
+  result.threads = benchThreads();
+
+  // every position gets its own sequence number, board after board
+  auto board = MockBoards::initialBoard();
+  long rounds = hz * millis / 1000;
+  double sender = 0;
+  auto cpu = benchProcessCpu();
+  auto start = chrono::steady_clock::now();
+  for (long round = 0; round < rounds; round++) {
+    auto senderStart = benchThreadCpu();
+    for (size_t i = 0; i < boards.size(); i++) {
+      auto sequence = static_cast<uint32_t>(round * boards.size() + i);
+      benchStamp(board.data(), sequence);
+      benchScalingSentAt[sequence & 0xffff] = benchMicros();
+      boards.sendBoard(i, board.data());
+      result.sent++;
+    }
+    sender += benchThreadCpu() - senderStart;
+    this_thread::sleep_until(start + chrono::microseconds((round + 1) * 1000000 / hz));
+  }
+  this_thread::sleep_for(chrono::milliseconds(200));
+  double used = benchProcessCpu() - cpu - sender;
+  double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+  result.received = benchScalingLatency.count();
+  result.cpuPerFrameUs = used * 1e6 / max<size_t>(result.received, 1);
+  result.cpuPerBoardPercent = used / seconds * 100 / boards.size();
+  result.p50 = benchScalingLatency.percentile(50);
+  result.p99 = benchScalingLatency.percentile(99);
+  for (auto &link : links) {
+    link->disconnect();
+  }
+  // read threads end on their own after a disconnect, let them go before the
+  // next run counts its threads
+  links.clear();
+  auto deadline = chrono::steady_clock::now() + chrono::seconds(2);
+  while (benchThreads() > threadsBefore && chrono::steady_clock::now() < deadline) {
+    this_thread::sleep_for(chrono::milliseconds(10));
+  }
+  return result;
+}
+
+// print the header of the table printed with benchScalingRow
+inline void benchScalingHeader(void) {
+  printf("%-8s %6s %8s %13s %13s %13s %10s %10s\n", "drive", "boards", "threads", "frames", "cpu us/frame",
+         "cpu %/board", "p50 us", "p99 us");
+}
+
+inline void benchScalingRow(const char *mode, size_t boards, const BenchScaling &r) {
+  printf("%-8s %6zu %8zu %6zu/%-6zu %13.1f %13.3f %10.0f %10.0f\n", mode, boards, r.threads, r.received, r.sent,
+         r.cpuPerFrameUs, r.cpuPerBoardPercent, r.p50, r.p99);
+}
+
+#endif // CHESS_BENCH_SCALING_HEADER_GUARD
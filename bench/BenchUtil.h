@@ -0,0 +1,130 @@
+#ifndef CHESS_BENCH_UTIL_HEADER_GUARD
+#define CHESS_BENCH_UTIL_HEADER_GUARD
+
+#include "ChessBoard.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <vector>
+
+#ifdef __linux__
+#include <ctime>
+#include <sys/resource.h>
+#endif
+
+// helpers shared by the benchmarks
+
+/**
+returns true if the benchmark was started with --quick, which only checks
+that it runs, e.g. from ctest
+*/
+inline bool benchQuick(int argc, char **argv) {
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--quick") == 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+/**
+returns the value of an option --name=value, fallback if it is not given
+*/
+inline long benchOption(int argc, char **argv, const char *name, long fallback) {
+  size_t length = strlen(name);
+  for (int i = 1; i < argc; i++) {
+    if (strncmp(argv[i], "--", 2) == 0 && strncmp(argv[i] + 2, name, length) == 0 && argv[i][2 + length] == '=') {
+      return strtol(argv[i] + 3 + length, nullptr, 10);
+    }
+  }
+  return fallback;
+}
+
+// steady clock time in microseconds, the clock ChessLink timestamps with
+inline uint64_t benchMicros() {
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+#ifdef __linux__
+// CPU time of the process in seconds
+inline double benchProcessCpu() {
+  rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  return usage.ru_utime.tv_sec + usage.ru_stime.tv_sec + (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1e6;
+}
+
+// CPU time of the calling thread in seconds, to take the driver's own work
+// out of benchProcessCpu
+inline double benchThreadCpu() {
+  timespec time;
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID, &time);
+  return time.tv_sec + time.tv_nsec / 1e9;
+}
+#endif
+
+/**
+write a sequence number into the first 8 squares of a packed position, as
+base 12 digits so that every nibble stays a valid piece code; the rest of the
+position is left alone
+*/
+inline void benchStamp(unsigned char *packed, uint32_t sequence) {
+  for (int i = 0; i < 4; i++) {
+    unsigned low = sequence % 12;
+    sequence /= 12;
+    unsigned high = sequence % 12;
+    sequence /= 12;
+    packed[i] = static_cast<unsigned char>(low | (high << 4));
+  }
+}
+
+// the sequence number written by benchStamp
+inline uint32_t benchSequence(const unsigned char *packed) {
+  uint32_t sequence = 0;
+  for (int i = 3; i >= 0; i--) {
+    sequence = sequence * 12 + (packed[i] >> 4);
+    sequence = sequence * 12 + (packed[i] & 0x0f);
+  }
+  return sequence;
+}
+
+// collects latency samples in microseconds from any thread
+class BenchLatency {
+private:
+  std::mutex samplesMutex;
+  std::vector<double> samples;
+
+public:
+  void add(double micros) {
+    std::lock_guard<std::mutex> lock(this->samplesMutex);
+    this->samples.push_back(micros);
+  }
+
+  size_t count() {
+    std::lock_guard<std::mutex> lock(this->samplesMutex);
+    return this->samples.size();
+  }
+
+  void clear() {
+    std::lock_guard<std::mutex> lock(this->samplesMutex);
+    this->samples.clear();
+  }
+
+  // returns the percentile p of 0-100 of the samples, 0 if there are none
+  double percentile(double p) {
+    std::lock_guard<std::mutex> lock(this->samplesMutex);
+    if (this->samples.empty()) {
+      return 0;
+    }
+    std::sort(this->samples.begin(), this->samples.end());
+    size_t index = static_cast<size_t>(p / 100 * (this->samples.size() - 1) + 0.5);
+    return this->samples[index];
+  }
+};
+
+#endif // CHESS_BENCH_UTIL_HEADER_GUARD
@@ -0,0 +1,76 @@
+// One application thread driving many boards.
+//
+// Every mock board is asked for its battery and file count and gets an LED
+// update. The blocking methods handle one board after another; the coroutine
+// layer starts one task per board from the same thread and waits for all of
+// them, while the SDK's threads do the work.
+
+#include "BenchUtil.h"
+#include "ChessLinkAsync.h"
+#include "MockBoard.h"
+
+static const array<bitset<8>, 8> LEDS = {bitset<8>("10000001")};
+
+// the sequence of one board, counts it in failures if a step failed
+static ChessTask board(ChessLinkAsync link, atomic<int> &failures) {
+  auto battery = co_await link.battery();
+  auto count = co_await link.fileCount();
+  auto written = co_await link.setLedAsync(LEDS);
+  if (battery <= 0 || count != 1 || written <= 0) {
+    failures++;
+  }
+}
+
+int main(int argc, char **argv) {
+  bool quick = benchQuick(argc, argv);
+  long count = benchOption(argc, argv, "boards", quick ? 4 : 64);
+  long delayUs = benchOption(argc, argv, "delay-us", 5000);
+
+  MockBoards boards(static_cast<size_t>(count));
+  boards.setResponseDelay(chrono::microseconds(delayUs));
+  vector<shared_ptr<ChessLink>> links;
+  for (size_t i = 0; i < boards.size(); i++) {
+    boards.addGame(i, {MockBoards::initialBoard()});
+    links.push_back(ChessLink::fromHidrawConnect(boards.path(i)));
+    if (!links.back()->connect()) {
+      printf("could not open %s\n", boards.path(i).c_str());
+      return 1;
+    }
+  }
+
+  printf("%-10s %6s %10s %14s\n", "calls", "boards", "total ms", "ms per board");
+  for (string mode : {"blocking", "coroutine"}) {
+    // start with full pacing buckets
+    this_thread::sleep_for(chrono::milliseconds(400));
+    atomic<int> failures(0);
+    auto start = benchMicros();
+    if (mode == "blocking") {
+      for (auto &link : links) {
+        auto battery = link->getBattery();
+        auto files = link->getFileCount();
+        auto written = link->setLedAsync(LEDS).get();
+        if (battery == 0 || files != 1 || written <= 0) {
+          failures++;
+        }
+      }
+    } else {
+      vector<ChessTask> tasks;
+      for (auto &link : links) {
+        tasks.push_back(board(ChessLinkAsync(link), failures));
+      }
+      for (auto &task : tasks) {
+        task.wait();
+      }
+    }
+    double ms = (benchMicros() - start) / 1000.0;
+    if (failures > 0) {
+      printf("%-10s %d boards failed\n", mode.c_str(), failures.load());
+      return 1;
+    }
+    printf("%-10s %6ld %10.1f %14.2f\n", mode.c_str(), count, ms, ms / count);
+  }
+  for (auto &link : links) {
+    link->disconnect();
+  }
+  return 0;
+}
@@ -0,0 +1,102 @@
+// Positions per second turned into a FEN placement field: the original
+// ChessLink::toFen against ChessBoardDecoder::fen with every kernel the CPU
+// supports, and ChessBoardDecoder::unpack alone.
+
+#include "BenchUtil.h"
+#include <cmath>
+#include <random>
+#include <string>
+
+using namespace std;
+
+constexpr unsigned char CHESS_PIECES[] = {
+    '0', 'q', 'k', 'b', 'p', 'n', 'R', 'P', 'r', 'B', 'N', 'Q', 'K',
+};
+
+// ChessLink::toFen as it was before the decoder, data is the whole message
+static string legacyFen(unsigned char *data, size_t length) {
+  if (length <= 32) {
+    return "";
+  }
+  string fen = "";
+  int empty = 0;
+  for (int i = 0; i < 8; i++) {
+    for (int j = 7; j >= 0; j--) {
+      char piece = j % 2 == 0 ? CHESS_PIECES[data[(i * 8 + j) / 2 + 2] & 0x0f]
+                              : CHESS_PIECES[data[static_cast<int>(floor((i * 8 + j) / 2 + 2))] >> 4];
+      if (piece == '0')
+        empty++;
+      else {
+        if (empty > 0) {
+          fen += to_string(empty);
+          empty = 0;
+        }
+      }
+      if (piece != '0')
+        fen += piece;
+    }
+    if (empty > 0)
+      fen += to_string(empty);
+    if (i < 7)
+      fen += "/";
+    empty = 0;
+  }
+  return fen;
+}
+
+static volatile size_t sink;
+
+int main(int argc, char **argv) {
+  bool quick = benchQuick(argc, argv);
+  long rounds = benchOption(argc, argv, "rounds", quick ? 10000 : 2000000);
+
+  // a set of positions from the initial one to a few pieces, as messages
+  mt19937 random(1);
+  uniform_int_distribution<int> piece(0, 12), coin(0, 3);
+  vector<array<unsigned char, 2 + 36>> messages(1024);
+  for (auto &message : messages) {
+    message = {0x01, 0x24};
+    for (size_t b = 0; b < PACKED_BOARD_SIZE; b++) {
+      int low = coin(random) ? 0 : piece(random);
+      int high = coin(random) ? 0 : piece(random);
+      message[2 + b] = static_cast<unsigned char>(low | high << 4);
+    }
+  }
+
+  printf("%-14s %10s %10s %10s\n", "decoder", "positions", "ns each", "M/s");
+  auto report = [&](const char *name, double seconds) {
+    printf("%-14s %10ld %10.1f %10.2f\n", name, rounds, seconds * 1e9 / rounds, rounds / seconds / 1e6);
+  };
+
+  size_t total = 0;
+  auto start = benchMicros();
+  for (long i = 0; i < rounds; i++) {
+    auto &message = messages[i & 1023];
+    total += legacyFen(message.data(), message.size()).size();
+  }
+  report("legacy toFen", (benchMicros() - start) / 1e6);
+
+  const pair<ChessBoardDecoder::Kernel, const char *> kernels[] = {
+      {ChessBoardDecoder::Scalar, "scalar"}, {ChessBoardDecoder::Ssse3, "ssse3"}, {ChessBoardDecoder::Avx2, "avx2"}};
+  for (auto &kernel : kernels) {
+    if (!ChessBoardDecoder::supports(kernel.first)) {
+      continue;
+    }
+    char fen[BOARD_FEN_MAX];
+    start = benchMicros();
+    for (long i = 0; i < rounds; i++) {
+      total += ChessBoardDecoder::fen(kernel.first, messages[i & 1023].data() + 2, fen);
+    }
+    report((string("fen ") + kernel.second).c_str(), (benchMicros() - start) / 1e6);
+
+    char squares[64];
+    start = benchMicros();
+    for (long i = 0; i < rounds; i++) {
+      ChessBoardDecoder::unpack(kernel.first, messages[i & 1023].data() + 2, squares);
+      total += static_cast<unsigned char>(squares[i & 63]);
+    }
+    report((string("unpack ") + kernel.second).c_str(), (benchMicros() - start) / 1e6);
+  }
+  sink = total;
+  return 0;
+}
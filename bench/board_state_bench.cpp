@@ -0,0 +1,62 @@
+// Cost per frame of getting a BoardState and of working with it.
+//
+// Consumers used to receive a FEN and parse it back into a board; the
+// BoardState is decoded straight from the packed payload instead. Both are
+// timed, followed by the operations done on every frame: equality, diff,
+// hash and the square events between two positions.
+
+#include "BenchUtil.h"
+#include <random>
+
+using namespace std;
+
+static volatile uint64_t sink;
+
+int main(int argc, char **argv) {
+  bool quick = benchQuick(argc, argv);
+  long rounds = benchOption(argc, argv, "rounds", quick ? 10000 : 5000000);
+
+  mt19937 random(1);
+  uniform_int_distribution<int> piece(0, 12), coin(0, 3);
+  vector<array<unsigned char, PACKED_BOARD_SIZE>> positions(1024);
+  for (auto &packed : positions) {
+    for (auto &byte : packed) {
+      int low = coin(random) ? 0 : piece(random);
+      int high = coin(random) ? 0 : piece(random);
+      byte = static_cast<unsigned char>(low | high << 4);
+    }
+  }
+  vector<BoardState> states;
+  for (auto &packed : positions) {
+    states.push_back(BoardState::fromPacked(packed.data()));
+  }
+
+  printf("%-22s %10s %10s %10s\n", "operation", "count", "ns each", "M/s");
+  auto time = [&](const char *name, auto &&body) {
+    uint64_t total = 0;
+    auto start = benchMicros();
+    for (long i = 0; i < rounds; i++) {
+      total += body(static_cast<size_t>(i) & 1023);
+    }
+    double seconds = (benchMicros() - start) / 1e6;
+    sink = total;
+    printf("%-22s %10ld %10.1f %10.2f\n", name, rounds, seconds * 1e9 / rounds, rounds / seconds / 1e6);
+  };
+
+  time("fen, then parse it", [&](size_t i) {
+    char fen[BOARD_FEN_MAX];
+    ChessBoardDecoder::fen(positions[i].data(), fen);
+    BoardState state;
+    BoardState::fromFen(fen, state);
+    return state.occupied;
+  });
+  time("fromPacked", [&](size_t i) { return BoardState::fromPacked(positions[i].data()).occupied; });
+  time("operator==", [&](size_t i) { return static_cast<uint64_t>(states[i] == states[(i + 1) & 1023]); });
+  time("diff", [&](size_t i) { return states[i].diff(states[(i + 1) & 1023]); });
+  time("hash", [&](size_t i) { return states[i].hash(); });
+  time("events", [&](size_t i) {
+    ChessSquareEvent events[SQUARE_EVENTS_MAX];
+    return static_cast<uint64_t>(states[i].events(states[(i + 1) & 1023], 0, events));
+  });
+  return 0;
+}
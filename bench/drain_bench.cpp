@@ -0,0 +1,69 @@
+// Time to download and delete every game stored on a board.
+//
+// A mock board holding the same games is drained once with drainAllGames
+// and once with the loop applications used before, getFile with delete
+// until the file count is 0. The board answers after a fixed delay, like the
+// round trip of a real board.
+
+#include "BenchUtil.h"
+#include "MockBoard.h"
+
+// a game of plies positions, every one stamped with its ply
+static MockGame game(long plies) {
+  MockGame positions;
+  auto board = MockBoards::initialBoard();
+  for (long ply = 0; ply < plies; ply++) {
+    benchStamp(board.data(), static_cast<uint32_t>(ply));
+    positions.push_back(board);
+  }
+  return positions;
+}
+
+int main(int argc, char **argv) {
+  bool quick = benchQuick(argc, argv);
+  long games = benchOption(argc, argv, "games", quick ? 3 : 100);
+  long plies = benchOption(argc, argv, "plies", 80);
+  long delayUs = benchOption(argc, argv, "delay-us", 5000);
+
+  printf("%-10s %6s %10s %10s %14s\n", "drain", "games", "positions", "total s", "ms per game");
+  for (string mode : {"getFile", "drain"}) {
+    MockBoards boards(1);
+    boards.setResponseDelay(chrono::microseconds(delayUs));
+    for (long i = 0; i < games; i++) {
+      boards.addGame(0, game(plies));
+    }
+    auto link = ChessLink::fromHidrawConnect(boards.path(0));
+    if (!link->connect()) {
+      printf("could not open %s\n", boards.path(0).c_str());
+      return 1;
+    }
+
+    size_t positions = 0;
+    long drained = 0;
+    auto start = benchMicros();
+    if (mode == "getFile") {
+      while (link->getFileCount() > 0) {
+        auto file = link->getFile(true);
+        if (file.empty()) {
+          break;
+        }
+        positions += file.size();
+        drained++;
+      }
+    } else {
+      ChessGameSink sink;
+      sink.onPosition = [&positions](size_t, const unsigned char *) { positions++; };
+      drained = link->drainAllGames(sink);
+    }
+    double seconds = (benchMicros() - start) / 1e6;
+    // the last delete was written, give the board time to carry it out
+    boards.waitCommands(0, 0x39, static_cast<uint64_t>(games), chrono::seconds(1));
+    if (drained != games || positions != static_cast<size_t>(games * plies) || boards.games(0) != 0) {
+      printf("%-10s drained %ld of %ld games, %zu positions\n", mode.c_str(), drained, games, positions);
+      return 1;
+    }
+    printf("%-10s %6ld %10zu %10.2f %14.1f\n", mode.c_str(), games, positions, seconds, seconds * 1000 / games);
+    link->disconnect();
+  }
+  return 0;
+}
@@ -0,0 +1,68 @@
+// Throughput of ChessFrameDecoder.
+//
+// A stream of realtime positions with a battery report now and then is fed
+// as one message per report, as large reports holding many messages and cut
+// into small reports so that most messages are reassembled. The original
+// read loop, which took every report as one message of readBuf[1] + 2 bytes,
+// is timed on the one message per report stream for comparison.
+
+#include "BenchUtil.h"
+#include "ChessFrameDecoder.h"
+
+static volatile uint64_t sink;
+
+int main(int argc, char **argv) {
+  bool quick = benchQuick(argc, argv);
+  long messages = benchOption(argc, argv, "messages", quick ? 10000 : 2000000);
+
+  // the messages and where each one starts in the stream
+  std::vector<unsigned char> stream;
+  std::vector<size_t> starts;
+  unsigned char position[2 + 36] = {0x01, 0x24};
+  const unsigned char battery[] = {0x2A, 0x02, 80, 0};
+  for (long i = 0; i < messages; i++) {
+    starts.push_back(stream.size());
+    if (i % 100 == 99) {
+      stream.insert(stream.end(), battery, battery + sizeof(battery));
+    } else {
+      benchStamp(position + 2, static_cast<uint32_t>(i));
+      stream.insert(stream.end(), position, position + sizeof(position));
+    }
+  }
+  starts.push_back(stream.size());
+
+  printf("%-10s %10s %12s %10s %10s\n", "reports", "messages", "report bytes", "MB/s", "Mmsg/s");
+  for (std::string mode : {"legacy", "single", "packed", "split"}) {
+    ChessFrameDecoder decoder;
+    uint64_t delivered = 0;
+    auto onFrame = [&delivered](const unsigned char *data, size_t length) { delivered += data[0] + length; };
+    size_t reportBytes = mode == "packed" ? 4096 : 7;
+    auto start = benchMicros();
+    if (mode == "legacy" || mode == "single") {
+      for (size_t i = 0; i + 1 < starts.size(); i++) {
+        const unsigned char *report = stream.data() + starts[i];
+        size_t length = starts[i + 1] - starts[i];
+        if (mode == "legacy") {
+          onFrame(report, static_cast<size_t>(report[1]) + 2);
+        } else {
+          decoder.feed(report, length, onFrame);
+        }
+      }
+    } else {
+      for (size_t at = 0; at < stream.size(); at += reportBytes) {
+        decoder.feed(stream.data() + at, std::min(reportBytes, stream.size() - at), onFrame);
+      }
+    }
+    double seconds = (benchMicros() - start) / 1e6;
+    sink = delivered;
+    if (mode != "legacy" && decoder.stats().frames != static_cast<uint64_t>(messages)) {
+      printf("%-10s delivered %lu of %ld messages\n", mode.c_str(), static_cast<unsigned long>(decoder.stats().frames),
+             messages);
+      return 1;
+    }
+    std::string bytes = mode == "legacy" || mode == "single" ? "message" : std::to_string(reportBytes);
+    printf("%-10s %10ld %12s %10.1f %10.2f\n", mode.c_str(), messages, bytes.c_str(), stream.size() / seconds / 1e6,
+           messages / seconds / 1e6);
+  }
+  return 0;
+}
@@ -0,0 +1,91 @@
+// System calls and latency per report of the hidapi and hidraw transports.
+//
+// A mock board sends realtime positions at a fixed interval to a link using
+// either transport. The system calls the SDK's threads make while waiting
+// for and reading reports are counted by wrapping the libc functions; the
+// thread that sends the reports is not counted.
+
+#include "BenchUtil.h"
+#include "MockBoard.h"
+#include <dlfcn.h>
+#include <poll.h>
+#include <sys/epoll.h>
+#include <unistd.h>
+
+// calls that wait for a report and calls that read one
+static atomic<uint64_t> waits(0);
+static atomic<uint64_t> reads(0);
+
+// false on the threads of the benchmark itself
+static thread_local bool counted = true;
+
+// look up the libc function a wrapper stands in for
+template <class F> static F next(const char *name) { return reinterpret_cast<F>(dlsym(RTLD_NEXT, name)); }
+
+extern "C" ssize_t read(int fd, void *buf, size_t count) {
+  static auto real = next<ssize_t (*)(int, void *, size_t)>("read");
+  reads += counted;
+  return real(fd, buf, count);
+}
+
+extern "C" int poll(struct pollfd *fds, nfds_t nfds, int timeout) {
+  static auto real = next<int (*)(struct pollfd *, nfds_t, int)>("poll");
+  waits += counted;
+  return real(fds, nfds, timeout);
+}
+
+extern "C" int epoll_wait(int epfd, struct epoll_event *events, int maxevents, int timeout) {
+  static auto real = next<int (*)(int, struct epoll_event *, int, int)>("epoll_wait");
+  waits += counted;
+  return real(epfd, events, maxevents, timeout);
+}
+
+static uint64_t sentAt[1 << 16];
+static BenchLatency latency;
+
+static void onBoard(const uint8_t *board, uint64_t) {
+  auto now = benchMicros();
+  latency.add(static_cast<double>(now - sentAt[benchSequence(board) & 0xffff]));
+}
+
+int main(int argc, char **argv) {
+  bool quick = benchQuick(argc, argv);
+  long frames = benchOption(argc, argv, "frames", quick ? 20 : 2000);
+  long gapUs = benchOption(argc, argv, "gap-us", 5000);
+  counted = false;
+
+  printf("%-8s %9s %10s %10s %12s %12s %12s\n", "read", "frames", "p50 us", "p99 us", "waits/frame", "reads/frame",
+         "cpu us/frame");
+  for (string mode : {"hidapi", "hidraw"}) {
+    MockBoards boards(1);
+    latency.clear();
+    auto link =
+        mode == "hidapi" ? ChessLink::fromHidPath(boards.path(0)) : ChessLink::fromHidrawConnect(boards.path(0));
+    link->setDuplicateSuppression(false, 0);
+    link->setBoardCallback(onBoard);
+    if (!link->connect()) {
+      printf("%-8s could not open %s\n", mode.c_str(), boards.path(0).c_str());
+      return 1;
+    }
+    this_thread::sleep_for(chrono::milliseconds(200));
+
+    auto board = MockBoards::initialBoard();
+    auto waitsBefore = waits.load();
+    auto readsBefore = reads.load();
+    auto cpu = benchProcessCpu();
+    for (long i = 0; i < frames; i++) {
+      benchStamp(board.data(), static_cast<uint32_t>(i));
+      sentAt[i & 0xffff] = benchMicros();
+      boards.sendBoard(0, board.data());
+      this_thread::sleep_for(chrono::microseconds(gapUs));
+    }
+    this_thread::sleep_for(chrono::milliseconds(100));
+    cpu = benchProcessCpu() - cpu;
+
+    printf("%-8s %4zu/%-4ld %10.0f %10.0f %12.2f %12.2f %12.1f\n", mode.c_str(), latency.count(), frames,
+           latency.percentile(50), latency.percentile(99), double(waits - waitsBefore) / frames,
+           double(reads - readsBefore) / frames, cpu * 1e6 / frames);
+    link->disconnect();
+  }
+  return 0;
+}
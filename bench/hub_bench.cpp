@@ -0,0 +1,75 @@
+// CPU per frame and latency of many boards on the threads of a ChessLinkHub,
+// against a hidraw transport with its own read thread per board.
+//
+// Every mock board sends 50 realtime positions per second; the hub's I/O
+// threads or the read threads turn them into board callbacks. The time from
+// connect to the first position shows that a hub thread starts watching a
+// board as soon as it is connected.
+
+#include "BenchScaling.h"
+#include "ChessLinkHub.h"
+
+static atomic<uint64_t> firstAt;
+
+static void onFirst(const uint8_t *, uint64_t) {
+  uint64_t none = 0;
+  firstAt.compare_exchange_strong(none, benchMicros());
+}
+
+// microseconds from connect until a position sent right after it reaches the
+// callback, 0 if it never does
+static double connectLatency(MockBoards &boards, shared_ptr<ChessLink> link) {
+  firstAt = 0;
+  link->setBoardCallback(onFirst);
+  // let the driving thread go idle first
+  this_thread::sleep_for(chrono::milliseconds(100));
+  auto start = benchMicros();
+  if (!link->connect()) {
+    return 0;
+  }
+  auto board = MockBoards::initialBoard();
+  boards.sendBoard(0, board.data());
+  auto deadline = chrono::steady_clock::now() + chrono::seconds(2);
+  while (firstAt == 0 && chrono::steady_clock::now() < deadline) {
+    this_thread::sleep_for(chrono::microseconds(100));
+  }
+  link->disconnect();
+  return firstAt ? static_cast<double>(firstAt - start) : 0;
+}
+
+int main(int argc, char **argv) {
+  bool quick = benchQuick(argc, argv);
+  long millis = benchOption(argc, argv, "ms", quick ? 300 : 3000);
+  long hz = benchOption(argc, argv, "hz", 50);
+  long threads = benchOption(argc, argv, "threads", 0);
+
+  ChessLinkHub hub(static_cast<unsigned>(threads));
+
+  benchScalingHeader();
+  for (size_t count : quick ? vector<size_t>{1, 4} : vector<size_t>{1, 16, 128}) {
+    for (string mode : {"threads", "hub"}) {
+      MockBoards boards(count);
+      auto result = benchScaling(boards, hz, millis, [&](string path) {
+        return mode == "hub" ? hub.attach(path) : ChessLink::fromHidrawConnect(path);
+      });
+      if (result.received == 0) {
+        printf("%-8s could not drive %zu boards\n", mode.c_str(), count);
+        return 1;
+      }
+      benchScalingRow(mode.c_str(), count, result);
+    }
+  }
+
+  printf("\n%-8s %16s\n", "drive", "connect->frame us");
+  for (string mode : {"threads", "hub"}) {
+    MockBoards boards(1);
+    auto link = mode == "hub" ? hub.attach(boards.path(0)) : ChessLink::fromHidrawConnect(boards.path(0));
+    double latency = connectLatency(boards, link);
+    if (latency == 0) {
+      printf("%-8s no position after connect\n", mode.c_str());
+      return 1;
+    }
+    printf("%-8s %16.0f\n", mode.c_str(), latency);
+  }
+  return 0;
+}
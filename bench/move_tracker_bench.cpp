@@ -0,0 +1,126 @@
+// Positions per second a ChessMoveTracker turns into moves.
+//
+// Random legal games are generated with the tracker itself and replayed
+// three ways: as realtime BoardStates, as realtime BoardStates with the
+// position of the lifted piece in between every move, which the tracker has
+// to ignore, and as FEN files through ChessMoveTracker::replay.
+
+#include "BenchUtil.h"
+#include "ChessMoveTracker.h"
+#include <random>
+#include <string>
+
+using namespace std;
+
+static void clearSquare(BoardState &board, int square) {
+  for (auto &pieces : board.pieces) {
+    pieces &= ~(1ull << square);
+  }
+}
+
+static void putPiece(BoardState &board, int square, uint8_t piece) {
+  clearSquare(board, square);
+  board.pieces[piece - 1] |= 1ull << square;
+}
+
+// the position after a legal move
+static BoardState afterMove(const BoardState &board, const ChessMove &move) {
+  BoardState next = board;
+  clearSquare(next, move.from);
+  putPiece(next, move.to, move.promotion ? move.promotion : move.piece);
+  if (move.flags & ChessMove::EnPassant) {
+    clearSquare(next, move.from / 8 * 8 + move.to % 8);
+  }
+  if (move.flags & ChessMove::Castle) {
+    int rookFrom = move.to % 8 == 6 ? move.to + 1 : move.to - 2;
+    int rookTo = move.to % 8 == 6 ? move.to - 1 : move.to + 1;
+    auto rook = board.pieceAt(rookFrom);
+    clearSquare(next, rookFrom);
+    putPiece(next, rookTo, rook);
+  }
+  next.occupied = 0;
+  for (auto pieces : next.pieces) {
+    next.occupied |= pieces;
+  }
+  return next;
+}
+
+struct Game {
+  vector<BoardState> positions;
+  vector<BoardState> withLifts;
+  vector<string> fens;
+};
+
+static Game randomGame(mt19937 &random, int plies) {
+  ChessMoveTracker tracker;
+  Game game;
+  game.positions.push_back(tracker.board());
+  game.withLifts.push_back(tracker.board());
+  game.fens.push_back(tracker.fen());
+  for (int ply = 0; ply < plies; ply++) {
+    ChessMove moves[LEGAL_MOVES_MAX];
+    size_t count = tracker.legalMoves(moves);
+    if (count == 0) {
+      break;
+    }
+    auto &move = moves[uniform_int_distribution<size_t>(0, count - 1)(random)];
+    auto next = afterMove(tracker.board(), move);
+    auto lifted = tracker.board();
+    clearSquare(lifted, move.from);
+    lifted.occupied &= ~(1ull << move.from);
+    if (!tracker.update(next)) {
+      break;
+    }
+    game.positions.push_back(next);
+    game.withLifts.push_back(lifted);
+    game.withLifts.push_back(next);
+    game.fens.push_back(tracker.fen());
+  }
+  return game;
+}
+
+static volatile size_t sink;
+
+int main(int argc, char **argv) {
+  bool quick = benchQuick(argc, argv);
+  long count = benchOption(argc, argv, "games", quick ? 5 : 500);
+  long rounds = benchOption(argc, argv, "rounds", quick ? 1 : 10);
+
+  mt19937 random(1);
+  vector<Game> games;
+  size_t moves = 0;
+  for (long i = 0; i < count; i++) {
+    games.push_back(randomGame(random, 200));
+    moves += games.back().positions.size() - 1;
+  }
+
+  printf("%-18s %10s %10s %12s %12s\n", "feed", "positions", "moves", "ns/position", "positions/s");
+  for (string mode : {"realtime", "realtime+lifts", "replay fen"}) {
+    size_t positions = 0, found = 0;
+    auto start = benchMicros();
+    for (long round = 0; round < rounds; round++) {
+      for (auto &game : games) {
+        if (mode == "replay fen") {
+          positions += game.fens.size();
+          found += ChessMoveTracker::replay(game.fens).size();
+          continue;
+        }
+        auto &feed = mode == "realtime" ? game.positions : game.withLifts;
+        ChessMoveTracker tracker;
+        for (auto &board : feed) {
+          found += tracker.update(board);
+        }
+        positions += feed.size();
+      }
+    }
+    double seconds = (benchMicros() - start) / 1e6;
+    sink = found;
+    if (found != moves * rounds) {
+      printf("%-18s found %zu of %zu moves\n", mode.c_str(), found, moves * rounds);
+      return 1;
+    }
+    printf("%-18s %10zu %10zu %12.0f %12.0f\n", mode.c_str(), positions, found, seconds * 1e9 / positions,
+           positions / seconds);
+  }
+  return 0;
+}
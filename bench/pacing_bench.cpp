@@ -0,0 +1,64 @@
+// Duration of the standard startup sequence under different pacing policies.
+//
+// The sequence is what an application does after connecting: query both
+// versions, the battery and the file count one after another, then set the
+// LEDs and wait until they were sent. It runs against a mock board that
+// answers after a fixed delay, once with the single 200 ms bucket all
+// opcodes shared originally and once with per-opcode buckets.
+
+#include "BenchUtil.h"
+#include "MockBoard.h"
+
+// the per-opcode policy: queries get their own buckets, LEDs and everything
+// else keep the default
+static void perOpcode(ChessHardConnect &device) {
+  device.setPacing(0x27, 20, 2);
+  device.setPacing(0x29, 20, 1);
+  device.setPacing(0x31, 20, 1);
+  device.setPacing(0x0a, 100, 1);
+}
+
+int main(int argc, char **argv) {
+  bool quick = benchQuick(argc, argv);
+  long runs = benchOption(argc, argv, "runs", quick ? 1 : 10);
+  long delayUs = benchOption(argc, argv, "delay-us", 5000);
+
+  MockBoards boards(1);
+  boards.setResponseDelay(chrono::microseconds(delayUs));
+  boards.addGame(0, {MockBoards::initialBoard()});
+
+  printf("%-12s %6s %10s %10s %10s\n", "policy", "runs", "mean ms", "min ms", "max ms");
+  for (string policy : {"global", "per-opcode"}) {
+    auto link = ChessLink::fromHidrawConnect(boards.path(0));
+    if (!link->connect()) {
+      printf("could not open %s\n", boards.path(0).c_str());
+      return 1;
+    }
+    if (policy == "per-opcode") {
+      perOpcode(*link->device);
+    }
+
+    double total = 0, fastest = 1e18, slowest = 0;
+    for (long run = 0; run < runs; run++) {
+      // start every run with full buckets
+      this_thread::sleep_for(chrono::milliseconds(400));
+      auto start = benchMicros();
+      bool ok = !link->getMcuVersion().empty() && !link->getBleVersion().empty();
+      ok = link->getBattery() > 0 && ok;
+      ok = link->getFileCount() > 0 && ok;
+      array<bitset<8>, 8> leds = {bitset<8>("10000001")};
+      ok = link->setLedAsync(leds).get() > 0 && ok;
+      double ms = (benchMicros() - start) / 1000.0;
+      if (!ok) {
+        printf("%-12s run %ld failed\n", policy.c_str(), run);
+        return 1;
+      }
+      total += ms;
+      fastest = min(fastest, ms);
+      slowest = max(slowest, ms);
+    }
+    printf("%-12s %6ld %10.1f %10.1f %10.1f\n", policy.c_str(), runs, total / runs, fastest, slowest);
+    link->disconnect();
+  }
+  return 0;
+}
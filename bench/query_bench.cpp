@@ -0,0 +1,68 @@
+// Time to read the device information of a board: the four blocking queries
+// one after another against queryDeviceInfo, which sends them all before
+// waiting. The mock board answers after a fixed delay, like the round trip
+// of a real board. Both run under the default pacing, which spaces every
+// write by 200 ms whatever its opcode, and with the queries paced per opcode.
+
+#include "BenchUtil.h"
+#include "MockBoard.h"
+
+// reads the device information the way the mode names
+static ChessDeviceInfo deviceInfo(ChessLink &link, const string &mode) {
+  if (mode == "pipelined") {
+    return link.queryDeviceInfo();
+  }
+  ChessDeviceInfo info;
+  info.mcuVersion = link.getMcuVersion();
+  info.bleVersion = link.getBleVersion();
+  info.battery = static_cast<int>(link.getBattery());
+  info.fileCount = static_cast<int>(link.getFileCount());
+  return info;
+}
+
+int main(int argc, char **argv) {
+  bool quick = benchQuick(argc, argv);
+  long runs = benchOption(argc, argv, "runs", quick ? 1 : 10);
+  long delayUs = benchOption(argc, argv, "delay-us", 5000);
+
+  MockBoards boards(1);
+  boards.setResponseDelay(chrono::microseconds(delayUs));
+  boards.addGame(0, {MockBoards::initialBoard()});
+
+  auto link = ChessLink::fromHidrawConnect(boards.path(0));
+  if (!link->connect()) {
+    printf("could not open %s\n", boards.path(0).c_str());
+    return 1;
+  }
+
+  printf("%-12s %-12s %6s %10s %10s %10s\n", "pacing", "queries", "runs", "mean ms", "min ms", "max ms");
+  for (string policy : {"global", "per-opcode"}) {
+    if (policy == "per-opcode") {
+      link->device->setPacing(0x27, 20, 2);
+      link->device->setPacing(0x29, 20, 1);
+      link->device->setPacing(0x31, 20, 1);
+    }
+    for (string mode : {"sequential", "pipelined"}) {
+      double total = 0, fastest = 1e18, slowest = 0;
+      for (long run = 0; run < runs; run++) {
+        // start every run with full pacing buckets
+        this_thread::sleep_for(chrono::milliseconds(400));
+        auto start = benchMicros();
+        auto info = deviceInfo(*link, mode);
+        double ms = (benchMicros() - start) / 1000.0;
+        if (info.mcuVersion != MOCK_MCU_VERSION || info.bleVersion != MOCK_BLE_VERSION || info.battery <= 0 ||
+            info.fileCount != 1) {
+          printf("%-12s %-12s run %ld failed\n", policy.c_str(), mode.c_str(), run);
+          return 1;
+        }
+        total += ms;
+        fastest = min(fastest, ms);
+        slowest = max(slowest, ms);
+      }
+      printf("%-12s %-12s %6ld %10.1f %10.1f %10.1f\n", policy.c_str(), mode.c_str(), runs, total / runs, fastest,
+             slowest);
+    }
+  }
+  link->disconnect();
+  return 0;
+}
@@ -0,0 +1,103 @@
+// Frame-to-callback latency and idle wake-ups of the read thread.
+//
+// A mock board sends realtime positions at random intervals; the time from
+// writing a frame to the board callback is measured for the reactor of the
+// hidraw transport, the hidapi transport and a copy of the original read loop
+// (hid_read_timeout of 100 ms, then a 10 ms sleep whenever nothing arrived).
+// Afterwards the board stays silent and the read thread's wake-ups are
+// counted.
+
+#include "BenchUtil.h"
+#include "MockBoard.h"
+#include <random>
+
+static uint64_t sentAt[1 << 16];
+static BenchLatency latency;
+
+static void onBoard(const uint8_t *board, uint64_t) {
+  auto now = benchMicros();
+  latency.add(static_cast<double>(now - sentAt[benchSequence(board) & 0xffff]));
+}
+
+// the read loop of the original SDK, counts its iterations in wakeups
+static void legacyLoop(string path, atomic_bool &stop, atomic<uint64_t> &wakeups) {
+  auto handle = hid_open_path(path.c_str());
+  if (!handle) {
+    return;
+  }
+  unsigned char readBuf[256];
+  while (!stop) {
+    wakeups++;
+    int res = hid_read_timeout(handle, readBuf, sizeof(readBuf), 100);
+    if (res >= 1) {
+      if (readBuf[0] == 0x01) {
+        char fen[BOARD_FEN_MAX];
+        ChessBoardDecoder::fen(readBuf + 2, fen);
+        onBoard(readBuf + 2, 0);
+      }
+    } else if (res == 0) {
+      this_thread::sleep_for(chrono::milliseconds(10));
+    } else {
+      break;
+    }
+  }
+  hid_close(handle);
+}
+
+int main(int argc, char **argv) {
+  bool quick = benchQuick(argc, argv);
+  long frames = benchOption(argc, argv, "frames", quick ? 10 : 150);
+  long idleMs = benchOption(argc, argv, "idle-ms", quick ? 300 : 3000);
+
+  printf("%-8s %8s %10s %10s %10s %14s\n", "read", "frames", "p50 us", "p99 us", "max us", "idle wakeup/s");
+  for (string mode : {"legacy", "hidapi", "hidraw"}) {
+    MockBoards boards(1);
+    latency.clear();
+
+    shared_ptr<ChessLink> link;
+    atomic_bool stop(false);
+    atomic<uint64_t> legacyWakeups(0);
+    thread legacy;
+    if (mode == "legacy") {
+      legacy = thread(legacyLoop, boards.path(0), ref(stop), ref(legacyWakeups));
+    } else {
+      link = mode == "hidapi" ? ChessLink::fromHidPath(boards.path(0)) : ChessLink::fromHidrawConnect(boards.path(0));
+      link->setBoardCallback(onBoard);
+      if (!link->connect()) {
+        printf("%-8s could not open %s\n", mode.c_str(), boards.path(0).c_str());
+        return 1;
+      }
+    }
+    this_thread::sleep_for(chrono::milliseconds(200));
+
+    // frames at random intervals longer than a read timeout, so that they
+    // arrive at any point of a polling cycle
+    mt19937 random(1);
+    uniform_int_distribution<int> gap(20000, 200000);
+    auto board = MockBoards::initialBoard();
+    for (long i = 0; i < frames; i++) {
+      benchStamp(board.data(), static_cast<uint32_t>(i));
+      sentAt[i & 0xffff] = benchMicros();
+      boards.sendBoard(0, board.data());
+      this_thread::sleep_for(chrono::microseconds(gap(random)));
+    }
+    this_thread::sleep_for(chrono::milliseconds(200));
+
+    auto wakeups = [&]() { return link ? link->getReadWakeups() : legacyWakeups.load(); };
+    auto idleStart = wakeups();
+    this_thread::sleep_for(chrono::milliseconds(idleMs));
+    double idle = (wakeups() - idleStart) * 1000.0 / idleMs;
+
+    printf("%-8s %4zu/%-4ld %10.0f %10.0f %10.0f %14.1f\n", mode.c_str(), latency.count(), frames,
+           latency.percentile(50), latency.percentile(99), latency.percentile(100), idle);
+
+    stop = true;
+    if (legacy.joinable()) {
+      legacy.join();
+    }
+    if (link) {
+      link->disconnect();
+    }
+  }
+  return 0;
+}
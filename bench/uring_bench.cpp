@@ -0,0 +1,36 @@
+// CPU per frame and latency of many boards on one io_uring loop, against a
+// hidraw transport with its own read thread per board.
+//
+// Every mock board sends 50 realtime positions per second; the loop thread
+// or the read threads turn them into board callbacks.
+
+#include "BenchScaling.h"
+#include "ChessUring.h"
+
+int main(int argc, char **argv) {
+  bool quick = benchQuick(argc, argv);
+  long millis = benchOption(argc, argv, "ms", quick ? 300 : 3000);
+  long hz = benchOption(argc, argv, "hz", 50);
+
+  auto loop = ChessUringLoop::create();
+  if (!loop) {
+    printf("io_uring is not available\n");
+    return 0;
+  }
+
+  benchScalingHeader();
+  for (size_t count : quick ? vector<size_t>{1, 4} : vector<size_t>{1, 16, 64}) {
+    for (string mode : {"threads", "uring"}) {
+      MockBoards boards(count);
+      auto result = benchScaling(boards, hz, millis, [&](string path) {
+        return mode == "uring" ? ChessLink::fromUringLoop(loop, path) : ChessLink::fromHidrawConnect(path);
+      });
+      if (result.received == 0) {
+        printf("%-8s could not drive %zu boards\n", mode.c_str(), count);
+        return 1;
+      }
+      benchScalingRow(mode.c_str(), count, result);
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,77 @@
+// Read latency while the writer thread is flooded with LED updates.
+//
+// A mock board sends realtime positions while another thread calls setLed as
+// fast as it can. The frame-to-callback latency is compared with a run
+// without LED updates, together with how long each setLed call blocked its
+// caller and how many LED frames were coalesced.
+
+#include "BenchUtil.h"
+#include "MockBoard.h"
+#include <random>
+
+static uint64_t sentAt[1 << 16];
+static BenchLatency latency;
+
+static void onBoard(const uint8_t *board, uint64_t) {
+  auto now = benchMicros();
+  latency.add(static_cast<double>(now - sentAt[benchSequence(board) & 0xffff]));
+}
+
+int main(int argc, char **argv) {
+  bool quick = benchQuick(argc, argv);
+  long frames = benchOption(argc, argv, "frames", quick ? 20 : 300);
+
+  printf("%-6s %-6s %8s %10s %10s %10s %12s %12s %10s\n", "read", "leds", "frames", "p50 us", "p99 us", "max us",
+         "setLed calls", "call p99 us", "coalesced");
+  for (string mode : {"hidapi", "hidraw"}) {
+    for (bool flood : {false, true}) {
+      MockBoards boards(1);
+      latency.clear();
+      auto link =
+          mode == "hidapi" ? ChessLink::fromHidPath(boards.path(0)) : ChessLink::fromHidrawConnect(boards.path(0));
+      link->setBoardCallback(onBoard);
+      if (!link->connect()) {
+        printf("%-6s could not open %s\n", mode.c_str(), boards.path(0).c_str());
+        return 1;
+      }
+      this_thread::sleep_for(chrono::milliseconds(200));
+
+      atomic_bool stop(false);
+      BenchLatency calls;
+      thread leds;
+      if (flood) {
+        leds = thread([&]() {
+          uint8_t square = 0;
+          while (!stop) {
+            auto start = benchMicros();
+            link->setLed(square % 8, square / 8 % 8, square & 64);
+            calls.add(static_cast<double>(benchMicros() - start));
+            square++;
+            this_thread::sleep_for(chrono::microseconds(200));
+          }
+        });
+      }
+
+      mt19937 random(1);
+      uniform_int_distribution<int> gap(2000, 12000);
+      auto board = MockBoards::initialBoard();
+      for (long i = 0; i < frames; i++) {
+        benchStamp(board.data(), static_cast<uint32_t>(i));
+        sentAt[i & 0xffff] = benchMicros();
+        boards.sendBoard(0, board.data());
+        this_thread::sleep_for(chrono::microseconds(gap(random)));
+      }
+      this_thread::sleep_for(chrono::milliseconds(100));
+      stop = true;
+      if (leds.joinable()) {
+        leds.join();
+      }
+
+      printf("%-6s %-6s %4zu/%-4ld %10.0f %10.0f %10.0f %12zu %12.0f %10lu\n", mode.c_str(), flood ? "flood" : "none",
+             latency.count(), frames, latency.percentile(50), latency.percentile(99), latency.percentile(100),
+             calls.count(), calls.percentile(99), static_cast<unsigned long>(link->device->getCoalescedWrites()));
+      link->disconnect();
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,511 @@
+#include "ChessBoard.h"
+#include <cstdint>
+#include <cstring>
+
+// runtime dispatch to the shuffle kernels, only where the compiler supports
+// per-function targets and cpu detection without extra runtime libraries
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__)) && !defined(_WIN32)
+#define CHESS_BOARD_X86_DISPATCH
+#endif
+
+#if defined(CHESS_BOARD_X86_DISPATCH) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+// piece character of every piece code, codes 13-15 are not used by the board
+constexpr char CHESS_PIECES[16] = {
+    '0', 'q', 'k', 'b', 'p', 'n', 'R', 'P', 'r', 'B', 'N', 'Q', 'K', '0', '0', '0',
+};
+
+// square k of the board is nibble k of the payload, low nibble first; in FEN
+// order every rank runs from k = rank * 8 + 7 down to k = rank * 8
+static void unpackScalar(const unsigned char *packed, char *squares) {
+  for (int rank = 0; rank < 8; rank++) {
+    for (int col = 0; col < 8; col++) {
+      int k = rank * 8 + 7 - col;
+      unsigned char byte = packed[k / 2];
+      squares[rank * 8 + col] = CHESS_PIECES[k % 2 ? byte >> 4 : byte & 0x0f];
+    }
+  }
+}
+
+#ifdef CHESS_BOARD_X86_DISPATCH
+// reverse the 4 bytes of every rank, then interleave high and low nibbles, so
+// that the squares come out in FEN order; the piece characters are looked up
+// with a second shuffle
+__attribute__((target("ssse3"))) static void unpackSsse3(const unsigned char *packed, char *squares) {
+  const __m128i table = _mm_setr_epi8('0', 'q', 'k', 'b', 'p', 'n', 'R', 'P', 'r', 'B', 'N', 'Q', 'K', '0', '0', '0');
+  const __m128i reverse = _mm_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12);
+  const __m128i mask = _mm_set1_epi8(0x0f);
+  for (int half = 0; half < 2; half++) {
+    __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(packed + half * 16));
+    v = _mm_shuffle_epi8(v, reverse);
+    __m128i lo = _mm_and_si128(v, mask);
+    __m128i hi = _mm_and_si128(_mm_srli_epi16(v, 4), mask);
+    __m128i first = _mm_shuffle_epi8(table, _mm_unpacklo_epi8(hi, lo));
+    __m128i second = _mm_shuffle_epi8(table, _mm_unpackhi_epi8(hi, lo));
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(squares + half * 32), first);
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(squares + half * 32 + 16), second);
+  }
+}
+
+// same as unpackSsse3 on the whole payload at once; the unpacks work per
+// 128-bit lane, so the lanes are put back in order at the end
+__attribute__((target("avx2"))) static void unpackAvx2(const unsigned char *packed, char *squares) {
+  const __m256i table = _mm256_setr_epi8('0', 'q', 'k', 'b', 'p', 'n', 'R', 'P', 'r', 'B', 'N', 'Q', 'K', '0', '0',
+                                         '0', '0', 'q', 'k', 'b', 'p', 'n', 'R', 'P', 'r', 'B', 'N', 'Q', 'K', '0',
+                                         '0', '0');
+  const __m256i reverse = _mm256_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12, 3, 2, 1, 0, 7, 6, 5,
+                                           4, 11, 10, 9, 8, 15, 14, 13, 12);
+  const __m256i mask = _mm256_set1_epi8(0x0f);
+  __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(packed));
+  v = _mm256_shuffle_epi8(v, reverse);
+  __m256i lo = _mm256_and_si256(v, mask);
+  __m256i hi = _mm256_and_si256(_mm256_srli_epi16(v, 4), mask);
+  __m256i a = _mm256_unpacklo_epi8(hi, lo);
+  __m256i b = _mm256_unpackhi_epi8(hi, lo);
+  __m256i first = _mm256_shuffle_epi8(table, _mm256_permute2x128_si256(a, b, 0x20));
+  __m256i second = _mm256_shuffle_epi8(table, _mm256_permute2x128_si256(a, b, 0x31));
+  _mm256_storeu_si256(reinterpret_cast<__m256i *>(squares), first);
+  _mm256_storeu_si256(reinterpret_cast<__m256i *>(squares + 32), second);
+}
+#endif
+
+// square s of a BoardState is nibble 63 - s of the payload, so the bitboards
+// are built from the payload in reverse byte order, high nibble first
+static void stateScalar(const unsigned char *packed, BoardState &state) {
+  uint64_t boards[16] = {};
+  for (int square = 0; square < 64; square++) {
+    int k = 63 - square;
+    unsigned char byte = packed[k / 2];
+    boards[k % 2 ? byte >> 4 : byte & 0x0f] |= 1ull << square;
+  }
+  for (int i = 0; i < 12; i++) {
+    state.pieces[i] = boards[i + 1];
+  }
+}
+
+#ifdef CHESS_BOARD_X86_DISPATCH
+// reverse the payload and interleave its nibbles into one piece code per
+// square in a1..h8 order, then collect one bitboard per code with compares
+__attribute__((target("ssse3"))) static void stateSsse3(const unsigned char *packed, BoardState &state) {
+  const __m128i reverse = _mm_setr_epi8(15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0);
+  const __m128i mask = _mm_set1_epi8(0x0f);
+  __m128i squares[4];
+  for (int half = 0; half < 2; half++) {
+    __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(packed + 16 - half * 16));
+    v = _mm_shuffle_epi8(v, reverse);
+    __m128i lo = _mm_and_si128(v, mask);
+    __m128i hi = _mm_and_si128(_mm_srli_epi16(v, 4), mask);
+    squares[half * 2] = _mm_unpacklo_epi8(hi, lo);
+    squares[half * 2 + 1] = _mm_unpackhi_epi8(hi, lo);
+  }
+  for (int i = 0; i < 12; i++) {
+    const __m128i code = _mm_set1_epi8(static_cast<char>(i + 1));
+    uint64_t board = 0;
+    for (int q = 0; q < 4; q++) {
+      board |= static_cast<uint64_t>(static_cast<uint16_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(squares[q], code))))
+               << (q * 16);
+    }
+    state.pieces[i] = board;
+  }
+}
+
+__attribute__((target("avx2"))) static void stateAvx2(const unsigned char *packed, BoardState &state) {
+  const __m256i reverse = _mm256_setr_epi8(15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10,
+                                           9, 8, 7, 6, 5, 4, 3, 2, 1, 0);
+  const __m256i mask = _mm256_set1_epi8(0x0f);
+  __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(packed));
+  v = _mm256_shuffle_epi8(_mm256_permute4x64_epi64(v, 0x4e), reverse);
+  __m256i lo = _mm256_and_si256(v, mask);
+  __m256i hi = _mm256_and_si256(_mm256_srli_epi16(v, 4), mask);
+  __m256i a = _mm256_unpacklo_epi8(hi, lo);
+  __m256i b = _mm256_unpackhi_epi8(hi, lo);
+  __m256i low = _mm256_permute2x128_si256(a, b, 0x20);
+  __m256i high = _mm256_permute2x128_si256(a, b, 0x31);
+  for (int i = 0; i < 12; i++) {
+    const __m256i code = _mm256_set1_epi8(static_cast<char>(i + 1));
+    uint64_t l = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(low, code)));
+    uint64_t h = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(high, code)));
+    state.pieces[i] = l | (h << 32);
+  }
+}
+#endif
+
+using StateFunction = void (*)(const unsigned char *, BoardState &);
+
+static StateFunction selectState() {
+#ifdef CHESS_BOARD_X86_DISPATCH
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2")) {
+    return stateAvx2;
+  }
+  if (__builtin_cpu_supports("ssse3")) {
+    return stateSsse3;
+  }
+#endif
+  return stateScalar;
+}
+
+static const StateFunction STATE = selectState();
+
+BoardState BoardState::fromPacked(const unsigned char *packed) {
+  BoardState state;
+  STATE(packed, state);
+  uint64_t occupied = 0;
+  for (size_t i = 0; i < 12; i++) {
+    occupied |= state.pieces[i];
+  }
+  state.occupied = occupied;
+  return state;
+}
+
+bool BoardState::fromFen(const char *fen, BoardState &state) {
+  state.pieces = {};
+  int rank = 7;
+  int file = 0;
+  for (; *fen && *fen != ' '; fen++) {
+    char c = *fen;
+    if (c == '/') {
+      if (file != 8 || rank == 0) {
+        return false;
+      }
+      rank--;
+      file = 0;
+    } else if (c >= '1' && c <= '8') {
+      file += c - '0';
+      if (file > 8) {
+        return false;
+      }
+    } else {
+      int code = 1;
+      while (code <= 12 && CHESS_PIECES[code] != c) {
+        code++;
+      }
+      if (code > 12 || file >= 8) {
+        return false;
+      }
+      state.pieces[code - 1] |= 1ull << (rank * 8 + file);
+      file++;
+    }
+  }
+  if (rank != 0 || file != 8) {
+    return false;
+  }
+  uint64_t occupied = 0;
+  for (size_t i = 0; i < 12; i++) {
+    occupied |= state.pieces[i];
+  }
+  state.occupied = occupied;
+  return true;
+}
+
+uint8_t BoardState::pieceAt(int square) const {
+  uint8_t piece = Empty;
+  for (size_t i = 0; i < 12; i++) {
+    piece |= static_cast<uint8_t>(((this->pieces[i] >> square) & 1) * (i + 1));
+  }
+  return piece;
+}
+
+// index of the lowest set bit, bits must not be 0
+static inline int lowestSquare(uint64_t bits) {
+#if defined(__GNUC__) || defined(__clang__)
+  return __builtin_ctzll(bits);
+#elif defined(_MSC_VER) && defined(_M_X64)
+  unsigned long index;
+  _BitScanForward64(&index, bits);
+  return static_cast<int>(index);
+#else
+  int index = 0;
+  while (!(bits & 1)) {
+    bits >>= 1;
+    index++;
+  }
+  return index;
+#endif
+}
+
+ChessBoardDebounce::ChessBoardDebounce() {
+  this->candidate = {};
+  this->since = 0;
+  this->frames = 0;
+  this->hasCandidate = false;
+  this->pending = false;
+  this->resetPending = false;
+  this->window = 0;
+  this->minFrames = 0;
+  this->absorbedCount = 0;
+  this->settledCount = 0;
+}
+
+void ChessBoardDebounce::checkReset(void) {
+  if (this->resetPending.exchange(false)) {
+    this->hasCandidate = false;
+    this->pending = false;
+  }
+}
+
+bool ChessBoardDebounce::accept(const unsigned char *packed, uint64_t timestamp) {
+  this->checkReset();
+  auto window = this->window.load();
+  auto minFrames = this->minFrames.load();
+  if (window == 0 && minFrames == 0) {
+    this->hasCandidate = false;
+    this->pending = false;
+    return true;
+  }
+
+  if (!this->hasCandidate || !ChessBoardDecoder::equal(packed, this->candidate.data())) {
+    if (this->pending) {
+      this->absorbedCount += this->frames;
+    }
+    memcpy(this->candidate.data(), packed, PACKED_BOARD_SIZE);
+    this->since = timestamp;
+    this->frames = 0;
+    this->hasCandidate = true;
+    this->pending = true;
+  }
+  this->frames++;
+
+  if (this->pending) {
+    if ((minFrames == 0 || this->frames < minFrames) && (window == 0 || timestamp - this->since < window)) {
+      return false;
+    }
+    this->pending = false;
+    this->settledCount++;
+  }
+  // frames of a stable position pass
+  return true;
+}
+
+uint64_t ChessBoardDebounce::remaining(uint64_t now) {
+  this->checkReset();
+  auto window = this->window.load();
+  if (!this->pending || window == 0) {
+    return UINT64_MAX;
+  }
+  return now - this->since >= window ? 0 : this->since + window - now;
+}
+
+bool ChessBoardDebounce::expire(uint64_t now, unsigned char *packed) {
+  if (this->remaining(now) != 0) {
+    return false;
+  }
+  this->pending = false;
+  this->settledCount++;
+  memcpy(packed, this->candidate.data(), PACKED_BOARD_SIZE);
+  return true;
+}
+
+void ChessBoardDebounce::reset(void) { this->resetPending = true; }
+
+void ChessBoardDebounce::configure(uint32_t windowMs, uint32_t frames) {
+  this->window = static_cast<uint64_t>(windowMs) * 1000;
+  this->minFrames = frames;
+}
+
+ChessDebounceStats ChessBoardDebounce::stats(void) const {
+  return {this->absorbedCount.load(), this->settledCount.load()};
+}
+
+size_t BoardState::events(const BoardState &next, uint64_t timestamp, ChessSquareEvent *events) const {
+  // a square whose piece changed is both lifted and placed, so the lifts are
+  // the changed squares occupied before and the places those occupied after
+  uint64_t changed = this->diff(next);
+  size_t n = 0;
+  for (uint64_t bits = changed & this->occupied; bits; bits &= bits - 1) {
+    int square = lowestSquare(bits);
+    events[n++] = {static_cast<uint8_t>(square), this->pieceAt(square), ChessSquareEvent::Lift, timestamp};
+  }
+  for (uint64_t bits = changed & next.occupied; bits; bits &= bits - 1) {
+    int square = lowestSquare(bits);
+    events[n++] = {static_cast<uint8_t>(square), next.pieceAt(square), ChessSquareEvent::Place, timestamp};
+  }
+  return n;
+}
+
+using UnpackFunction = void (*)(const unsigned char *, char *);
+
+// the implementation of a kernel, nullptr if it cannot run on this CPU
+static UnpackFunction unpackFunction(ChessBoardDecoder::Kernel kernel) {
+  switch (kernel) {
+  case ChessBoardDecoder::Scalar:
+    return unpackScalar;
+#ifdef CHESS_BOARD_X86_DISPATCH
+  case ChessBoardDecoder::Ssse3:
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("ssse3") ? unpackSsse3 : nullptr;
+  case ChessBoardDecoder::Avx2:
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2") ? unpackAvx2 : nullptr;
+#endif
+  default:
+    return nullptr;
+  }
+}
+
+static ChessBoardDecoder::Kernel selectKernel() {
+  for (auto kernel : {ChessBoardDecoder::Avx2, ChessBoardDecoder::Ssse3}) {
+    if (unpackFunction(kernel)) {
+      return kernel;
+    }
+  }
+  return ChessBoardDecoder::Scalar;
+}
+
+static const ChessBoardDecoder::Kernel KERNEL = selectKernel();
+static const UnpackFunction UNPACK = unpackFunction(KERNEL);
+
+// write the placement field of 64 unpacked squares
+static size_t fenOf(const char *squares, char *fen) {
+  size_t n = 0;
+  for (int rank = 0; rank < 8; rank++) {
+    char empty = 0;
+    for (int col = 0; col < 8; col++) {
+      char piece = squares[rank * 8 + col];
+      if (piece == '0') {
+        empty++;
+      } else {
+        if (empty > 0) {
+          fen[n++] = static_cast<char>('0' + empty);
+          empty = 0;
+        }
+        fen[n++] = piece;
+      }
+    }
+    if (empty > 0) {
+      fen[n++] = static_cast<char>('0' + empty);
+    }
+    if (rank < 7) {
+      fen[n++] = '/';
+    }
+  }
+  fen[n] = '\0';
+  return n;
+}
+
+ChessBoardDecoder::Kernel ChessBoardDecoder::kernel(void) { return KERNEL; }
+
+bool ChessBoardDecoder::supports(Kernel kernel) { return unpackFunction(kernel) != nullptr; }
+
+void ChessBoardDecoder::unpack(const unsigned char *packed, char *squares) { UNPACK(packed, squares); }
+
+size_t ChessBoardDecoder::fen(const unsigned char *packed, char *fen) {
+  char squares[64];
+  UNPACK(packed, squares);
+  return fenOf(squares, fen);
+}
+
+void ChessBoardDecoder::unpack(Kernel kernel, const unsigned char *packed, char *squares) {
+  unpackFunction(kernel)(packed, squares);
+}
+
+size_t ChessBoardDecoder::fen(Kernel kernel, const unsigned char *packed, char *fen) {
+  char squares[64];
+  unpackFunction(kernel)(packed, squares);
+  return fenOf(squares, fen);
+}
+
+// the compares of equal, the vector ones are compiled for their instruction
+// set where the kernels are dispatched at runtime
+#ifdef CHESS_BOARD_X86_DISPATCH
+#define CHESS_BOARD_TARGET(isa) __attribute__((target(isa)))
+#else
+#define CHESS_BOARD_TARGET(isa)
+#endif
+
+static bool equalScalar(const unsigned char *a, const unsigned char *b) {
+  uint64_t x[4], y[4];
+  memcpy(x, a, sizeof(x));
+  memcpy(y, b, sizeof(y));
+  return ((x[0] ^ y[0]) | (x[1] ^ y[1]) | (x[2] ^ y[2]) | (x[3] ^ y[3])) == 0;
+}
+
+#if defined(CHESS_BOARD_X86_DISPATCH) || defined(__SSE2__)
+CHESS_BOARD_TARGET("sse2") static inline bool equalSse2(const unsigned char *a, const unsigned char *b) {
+  __m128i lo = _mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(a)),
+                              _mm_loadu_si128(reinterpret_cast<const __m128i *>(b)));
+  __m128i hi = _mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(a + 16)),
+                              _mm_loadu_si128(reinterpret_cast<const __m128i *>(b + 16)));
+  return _mm_movemask_epi8(_mm_and_si128(lo, hi)) == 0xffff;
+}
+#endif
+
+#if defined(CHESS_BOARD_X86_DISPATCH) || defined(__AVX2__)
+CHESS_BOARD_TARGET("avx2") static inline bool equalAvx2(const unsigned char *a, const unsigned char *b) {
+  __m256i va = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(a));
+  __m256i vb = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(b));
+  return static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(va, vb))) == 0xffffffffu;
+}
+#endif
+
+// called for every realtime frame, so the compare is inlined with the vector
+// width the build targets instead of going through the runtime dispatch
+bool ChessBoardDecoder::equal(const unsigned char *a, const unsigned char *b) {
+#if defined(__AVX2__)
+  return equalAvx2(a, b);
+#elif defined(__SSE2__)
+  return equalSse2(a, b);
+#else
+  return equalScalar(a, b);
+#endif
+}
+
+bool ChessBoardDecoder::equal(Kernel kernel, const unsigned char *a, const unsigned char *b) {
+  switch (kernel) {
+#ifdef CHESS_BOARD_X86_DISPATCH
+  case Ssse3:
+    return equalSse2(a, b);
+  case Avx2:
+    return equalAvx2(a, b);
+#endif
+  default:
+    return equalScalar(a, b);
+  }
+}
+
+ChessBoardFilter::ChessBoardFilter() {
+  this->last = {};
+  this->lastTime = 0;
+  this->hasLast = false;
+  this->resetPending = false;
+  this->enabled = true;
+  this->heartbeat = 0;
+  this->deliveredCount = 0;
+  this->suppressedCount = 0;
+}
+
+bool ChessBoardFilter::accept(const unsigned char *packed, uint64_t timestamp) {
+  if (this->resetPending.exchange(false)) {
+    this->hasLast = false;
+  }
+  if (this->enabled && this->hasLast && ChessBoardDecoder::equal(packed, this->last.data())) {
+    auto interval = this->heartbeat.load();
+    if (interval == 0 || timestamp - this->lastTime < interval) {
+      this->suppressedCount++;
+      return false;
+    }
+  } else {
+    memcpy(this->last.data(), packed, PACKED_BOARD_SIZE);
+    this->hasLast = true;
+  }
+  this->lastTime = timestamp;
+  this->deliveredCount++;
+  return true;
+}
+
+void ChessBoardFilter::reset(void) { this->resetPending = true; }
+
+void ChessBoardFilter::configure(bool enabled, uint32_t heartbeatMs) {
+  this->heartbeat = static_cast<uint64_t>(heartbeatMs) * 1000;
+  this->enabled = enabled;
+}
+
+ChessBoardFilterStats ChessBoardFilter::stats(void) const {
+  return {this->deliveredCount.load(), this->suppressedCount.load()};
+}
@@ -0,0 +1,322 @@
+#ifndef CHESS_BOARD_HEADER_GUARD
+#define CHESS_BOARD_HEADER_GUARD
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+// bytes of a packed board position, two squares per byte
+constexpr size_t PACKED_BOARD_SIZE = 32;
+
+// longest piece placement field of a FEN plus the terminating NUL
+constexpr size_t BOARD_FEN_MAX = 64 + 7 + 1;
+
+/**
+Decoder for the packed board positions of 0x01 messages.
+
+The 32 payload bytes hold one piece code per nibble. unpack expands them into
+64 piece characters with a byte shuffle (AVX2 or SSSE3 when the CPU supports
+it, a scalar table lookup otherwise), and fen writes the run-length encoded
+placement field into a caller provided buffer without allocating.
+*/
+struct ChessBoardDecoder {
+  // implementations of unpack
+  enum Kernel { Scalar, Ssse3, Avx2 };
+
+  /**
+  returns the kernel unpack and fen use on this CPU
+  */
+  static Kernel kernel(void);
+
+  /**
+  returns true if a kernel can run on this CPU
+  */
+  static bool supports(Kernel kernel);
+
+  /**
+  expand a packed position into 64 piece characters in FEN order, rank 8 to
+  rank 1 and file a to h, '0' for empty squares
+  */
+  static void unpack(const unsigned char *packed, char *squares);
+
+  /**
+  write the piece placement field of a packed position to fen, which must
+  hold BOARD_FEN_MAX characters
+  Returns the length of the field, without the terminating NUL
+  */
+  static size_t fen(const unsigned char *packed, char *fen);
+
+  /**
+  unpack and fen with a given kernel, which must be supported; for the tests
+  and benchmarks
+  */
+  static void unpack(Kernel kernel, const unsigned char *packed, char *squares);
+  static size_t fen(Kernel kernel, const unsigned char *packed, char *fen);
+
+  /**
+  compare two packed positions as one 256-bit value
+  Returns true if they are identical
+  */
+  static bool equal(const unsigned char *a, const unsigned char *b);
+
+  /**
+  equal with the compare of a given kernel, which must be supported; the
+  SSSE3 kernel compares with SSE2; for the tests
+  */
+  static bool equal(Kernel kernel, const unsigned char *a, const unsigned char *b);
+};
+
+// counters of a ChessBoardFilter
+struct ChessBoardFilterStats {
+  // positions handed on
+  uint64_t delivered;
+
+  // positions dropped because they repeat the last delivered one
+  uint64_t suppressed;
+};
+
+/**
+Drops realtime positions that are identical to the last delivered one.
+The board reports its position continuously, even when nothing moved, so
+only changes are handed on; with a heartbeat an unchanged position is still
+handed on once every heartbeat interval.
+accept is only called from the read thread, the other methods may be called
+from any thread.
+*/
+class ChessBoardFilter {
+private:
+  // last delivered position and the time it was delivered at
+  std::array<unsigned char, PACKED_BOARD_SIZE> last;
+  uint64_t lastTime;
+  bool hasLast;
+
+  // set by reset, makes the next position pass
+  std::atomic<bool> resetPending;
+
+  std::atomic<bool> enabled;
+
+  // heartbeat interval in microseconds, 0 for none
+  std::atomic<uint64_t> heartbeat;
+
+  std::atomic<uint64_t> deliveredCount;
+  std::atomic<uint64_t> suppressedCount;
+
+public:
+  ChessBoardFilter();
+
+  /**
+  check a position read at timestamp, in microseconds
+  Returns true if it has to be delivered
+  */
+  bool accept(const unsigned char *packed, uint64_t timestamp);
+
+  /**
+  forget the last position, e.g. after a reconnect or a mode switch
+  */
+  void reset(void);
+
+  /**
+  enable or disable the suppression, heartbeatMs is the interval at which an
+  unchanged position is delivered anyway, 0 for never
+  */
+  void configure(bool enabled, uint32_t heartbeatMs);
+
+  /**
+  returns the counters
+  */
+  ChessBoardFilterStats stats(void) const;
+};
+
+// counters of a ChessBoardDebounce
+struct ChessDebounceStats {
+  // frames of positions that changed again before they became stable
+  uint64_t absorbed;
+
+  // positions that became stable and were handed on
+  uint64_t settled;
+};
+
+/**
+Holds back realtime positions until they are stable.
+While a piece slides across the board, the board reports a burst of
+intermediate positions. A position is only handed on once it was reported
+unchanged for a time window or for a number of consecutive frames, whichever
+comes first. Since the board may stop reporting once it is still, expire
+hands on a position whose window elapsed without another frame; the read
+thread calls it when the reactor times out.
+accept, remaining and expire are only called from the read thread, the other
+methods may be called from any thread.
+*/
+class ChessBoardDebounce {
+private:
+  // position waiting to become stable, the time it was first read at and the
+  // number of frames it was read in
+  std::array<unsigned char, PACKED_BOARD_SIZE> candidate;
+  uint64_t since;
+  uint64_t frames;
+  bool hasCandidate;
+
+  // true until the candidate became stable
+  bool pending;
+
+  // set by reset, drops the candidate
+  std::atomic<bool> resetPending;
+
+  // window in microseconds and number of frames, 0 if not used
+  std::atomic<uint64_t> window;
+  std::atomic<uint32_t> minFrames;
+
+  std::atomic<uint64_t> absorbedCount;
+  std::atomic<uint64_t> settledCount;
+
+  // drop the candidate if reset was called
+  void checkReset(void);
+
+public:
+  ChessBoardDebounce();
+
+  /**
+  check a position read at timestamp, in microseconds
+  Returns true if the position is stable and has to be delivered
+  */
+  bool accept(const unsigned char *packed, uint64_t timestamp);
+
+  /**
+  returns the microseconds until the pending position becomes stable by its
+  window, UINT64_MAX if there is none
+  */
+  uint64_t remaining(uint64_t now);
+
+  /**
+  if the window of the pending position elapsed by now, copy the position to
+  packed, which must hold PACKED_BOARD_SIZE bytes
+  Returns true if the position has to be delivered
+  */
+  bool expire(uint64_t now, unsigned char *packed);
+
+  /**
+  forget the pending position, e.g. after a reconnect or a mode switch
+  */
+  void reset(void);
+
+  /**
+  set the stability window in milliseconds and the number of frames, a
+  position is stable when either is reached; 0 turns that criterion off and
+  0 for both turns the debounce off
+  */
+  void configure(uint32_t windowMs, uint32_t frames);
+
+  /**
+  returns the counters
+  */
+  ChessDebounceStats stats(void) const;
+};
+
+/**
+A piece lifted from or placed on a square, derived from two consecutive
+positions
+*/
+struct ChessSquareEvent {
+  enum Type : uint8_t {
+    Lift = 0,
+    Place = 1,
+  };
+
+  // 0 is a1, 7 is h1 and 63 is h8
+  uint8_t square;
+
+  // piece code of the board protocol, see BoardState::Piece
+  uint8_t piece;
+
+  uint8_t type;
+
+  // steady clock time in microseconds at which the position was read
+  uint64_t timestamp;
+};
+
+// most events between two positions, a lift and a place on every square
+constexpr size_t SQUARE_EVENTS_MAX = 2 * 64;
+
+/**
+Board position as bitboards, one per piece code of the board protocol plus
+the occupancy mask. Bit 0 is square a1, bit 7 is h1 and bit 63 is h8.
+Comparison, diff and hash run without branches.
+*/
+struct BoardState {
+  // piece codes of the board protocol, pieces[code - 1] is the bitboard of
+  // that piece
+  enum Piece : uint8_t {
+    Empty = 0,
+    BlackQueen = 1,
+    BlackKing = 2,
+    BlackBishop = 3,
+    BlackPawn = 4,
+    BlackKnight = 5,
+    WhiteRook = 6,
+    WhitePawn = 7,
+    BlackRook = 8,
+    WhiteBishop = 9,
+    WhiteKnight = 10,
+    WhiteQueen = 11,
+    WhiteKing = 12,
+  };
+
+  std::array<uint64_t, 12> pieces;
+
+  uint64_t occupied;
+
+  /**
+  decode the packed position of a 0x01 message, PACKED_BOARD_SIZE bytes
+  */
+  static BoardState fromPacked(const unsigned char *packed);
+
+  /**
+  parse the piece placement field of a FEN, as returned by ChessLink::getFile,
+  parsing stops at the first space
+  Returns false if the field is malformed
+  */
+  static bool fromFen(const char *fen, BoardState &state);
+
+  /**
+  returns the piece code on a square, Empty if there is none
+  */
+  uint8_t pieceAt(int square) const;
+
+  /**
+  returns the squares whose content differs between the two positions
+  */
+  uint64_t diff(const BoardState &other) const {
+    uint64_t d = 0;
+    for (size_t i = 0; i < 12; i++) {
+      d |= this->pieces[i] ^ other.pieces[i];
+    }
+    return d;
+  }
+
+  /**
+  write the events that turn this position into next to events, which must
+  hold SQUARE_EVENTS_MAX entries; all lifts come before all places, each in
+  square order
+  Returns the number of events
+  */
+  size_t events(const BoardState &next, uint64_t timestamp, ChessSquareEvent *events) const;
+
+  bool operator==(const BoardState &other) const { return this->diff(other) == 0; }
+
+  bool operator!=(const BoardState &other) const { return this->diff(other) != 0; }
+
+  /**
+  returns a hash of the position
+  */
+  uint64_t hash() const {
+    uint64_t h = 0x9e3779b97f4a7c15ull;
+    for (size_t i = 0; i < 12; i++) {
+      h = (h ^ this->pieces[i]) * 0xff51afd7ed558ccdull;
+      h ^= h >> 32;
+    }
+    return h;
+  }
+};
+
+#endif // CHESS_BOARD_HEADER_GUARD
@@ -0,0 +1,47 @@
+#include "ChessFrameDecoder.h"
+
+// payload length of the messages with a fixed layout, 0 if any length is valid
+static constexpr std::array<unsigned char, 256> expectedLengths() {
+  std::array<unsigned char, 256> lengths = {};
+  // board position: 32 bytes of pieces and 4 bytes of trailer
+  lengths[0x01] = 0x24;
+  // battery: level and charging state
+  lengths[0x2A] = 0x02;
+  // file transfer start and end markers
+  lengths[0x37] = 0x01;
+  return lengths;
+}
+
+static constexpr std::array<unsigned char, 256> EXPECTED_LENGTHS = expectedLengths();
+
+// highest piece code of a board position
+constexpr unsigned char MAX_PIECE = 12;
+
+ChessFrameDecoder::ChessFrameDecoder() {
+  this->have = 0;
+  this->frameCount = 0;
+  this->resyncCount = 0;
+  this->malformedCount = 0;
+}
+
+bool ChessFrameDecoder::plausible(unsigned char opcode, unsigned char length) {
+  return EXPECTED_LENGTHS[opcode] == 0 || EXPECTED_LENGTHS[opcode] == length;
+}
+
+bool ChessFrameDecoder::valid(const unsigned char *data, size_t length) {
+  if (data[0] == 0x01) {
+    // every nibble must be a known piece code
+    for (size_t i = 2; i < 2 + 32 && i < length; i++) {
+      if ((data[i] & 0x0f) > MAX_PIECE || (data[i] >> 4) > MAX_PIECE) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+void ChessFrameDecoder::reset(void) { this->have = 0; }
+
+ChessFrameStats ChessFrameDecoder::stats(void) const {
+  return {this->frameCount.load(), this->resyncCount.load(), this->malformedCount.load()};
+}
@@ -0,0 +1,117 @@
+#ifndef CHESS_FRAME_DECODER_HEADER_GUARD
+#define CHESS_FRAME_DECODER_HEADER_GUARD
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+// counters of a ChessFrameDecoder
+struct ChessFrameStats {
+  // frames delivered
+  uint64_t frames;
+
+  // bytes dropped to find the start of the next frame
+  uint64_t resyncs;
+
+  // complete frames dropped because their content is invalid
+  uint64_t malformed;
+};
+
+/**
+Incremental decoder that turns the reports read from the board into protocol
+messages of the form [opcode, length, payload...].
+
+A report may hold several messages, a message may be split across reports and
+reports may be padded with zero bytes; the decoder splits and reassembles them
+in a fixed buffer without allocating. Messages with a known opcode but an
+unexpected length are treated as loss of sync and skipped byte by byte.
+*/
+class ChessFrameDecoder {
+public:
+  // longest message, opcode and length byte plus 255 bytes payload
+  static constexpr size_t FRAME_MAX = 2 + 255;
+
+private:
+  // partial message carried over from the previous report
+  std::array<unsigned char, FRAME_MAX> frame;
+  size_t have;
+
+  std::atomic<uint64_t> frameCount;
+  std::atomic<uint64_t> resyncCount;
+  std::atomic<uint64_t> malformedCount;
+
+  // false if a message header cannot be the start of a message
+  static bool plausible(unsigned char opcode, unsigned char length);
+
+  // false if the content of a complete message is invalid
+  static bool valid(const unsigned char *data, size_t length);
+
+  // count a complete message and hand it on if it is valid
+  template <class F> void deliver(const unsigned char *data, size_t length, F &onFrame) {
+    if (valid(data, length)) {
+      this->frameCount++;
+      onFrame(data, length);
+    } else {
+      this->malformedCount++;
+    }
+  }
+
+public:
+  ChessFrameDecoder();
+
+  /**
+  feed the bytes of one report, onFrame(const unsigned char *, size_t) is
+  called for every complete message, which is only valid during the call
+  */
+  template <class F> void feed(const unsigned char *data, size_t length, F &&onFrame) {
+    size_t i = 0;
+    while (i < length) {
+      if (this->have == 0) {
+        if (data[i] == 0) {
+          // report padding
+          i++;
+          continue;
+        }
+        if (length - i >= 2) {
+          if (!plausible(data[i], data[i + 1])) {
+            this->resyncCount++;
+            i++;
+            continue;
+          }
+          // whole message inside the report, no copy needed
+          size_t size = data[i + 1] + 2;
+          if (length - i >= size) {
+            this->deliver(data + i, size, onFrame);
+            i += size;
+            continue;
+          }
+        }
+      }
+
+      this->frame[this->have++] = data[i++];
+      if (this->have == 2 && !plausible(this->frame[0], this->frame[1])) {
+        this->resyncCount++;
+        this->frame[0] = this->frame[1];
+        this->have = this->frame[0] == 0 ? 0 : 1;
+        continue;
+      }
+      if (this->have >= 2 && this->have == static_cast<size_t>(this->frame[1]) + 2) {
+        this->have = 0;
+        this->deliver(this->frame.data(), static_cast<size_t>(this->frame[1]) + 2, onFrame);
+      }
+    }
+  }
+
+  /**
+  drop a partial message, e.g. after the board disconnected
+  */
+  void reset(void);
+
+  /**
+  returns the counters
+  */
+  ChessFrameStats stats(void) const;
+};
+
+#endif // CHESS_FRAME_DECODER_HEADER_GUARD
@@ -0,0 +1,149 @@
+#include "ChessGameCodec.h"
+#include <cstring>
+
+constexpr unsigned char GAME_CODEC_MAGIC[4] = {'C', 'L', 'G', 1};
+
+// square s of the format is nibble 63 - s of the packed position
+static inline unsigned char pieceOf(const unsigned char *packed, int square) {
+  int k = 63 - square;
+  return k % 2 ? packed[k / 2] >> 4 : packed[k / 2] & 0x0f;
+}
+
+static inline void setPiece(unsigned char *packed, int square, unsigned char piece) {
+  int k = 63 - square;
+  if (k % 2) {
+    packed[k / 2] = static_cast<unsigned char>((packed[k / 2] & 0x0f) | (piece << 4));
+  } else {
+    packed[k / 2] = static_cast<unsigned char>((packed[k / 2] & 0xf0) | (piece & 0x0f));
+  }
+}
+
+void ChessGameFile::add(const unsigned char *packed) { this->arena.insert(this->arena.end(), packed, packed + PACKED_BOARD_SIZE); }
+
+size_t ChessGameFile::size(void) const { return this->arena.size() / PACKED_BOARD_SIZE; }
+
+bool ChessGameFile::empty(void) const { return this->arena.empty(); }
+
+const unsigned char *ChessGameFile::position(size_t index) const {
+  return this->arena.data() + index * PACKED_BOARD_SIZE;
+}
+
+size_t ChessGameFile::fen(size_t index, char *fen) const { return ChessBoardDecoder::fen(this->position(index), fen); }
+
+std::string ChessGameFile::fen(size_t index) const {
+  char fen[BOARD_FEN_MAX];
+  return std::string(fen, this->fen(index, fen));
+}
+
+std::vector<std::string> ChessGameFile::fens(void) const {
+  std::vector<std::string> positions;
+  positions.reserve(this->size());
+  char fen[BOARD_FEN_MAX];
+  for (size_t i = 0; i < this->size(); i++) {
+    positions.emplace_back(fen, this->fen(i, fen));
+  }
+  return positions;
+}
+
+void ChessGameFile::clear(void) { this->arena.clear(); }
+
+ChessGameEncoder::ChessGameEncoder() { this->clear(); }
+
+void ChessGameEncoder::add(const unsigned char *packed) {
+  if (this->count++ == 0) {
+    this->data.insert(this->data.end(), GAME_CODEC_MAGIC, GAME_CODEC_MAGIC + sizeof(GAME_CODEC_MAGIC));
+    this->data.insert(this->data.end(), packed, packed + PACKED_BOARD_SIZE);
+    memcpy(this->last.data(), packed, PACKED_BOARD_SIZE);
+    return;
+  }
+
+  unsigned char squares[64];
+  unsigned char pieces[64];
+  size_t n = 0;
+  for (int square = 0; square < 64; square++) {
+    auto piece = pieceOf(packed, square);
+    if (piece != pieceOf(this->last.data(), square)) {
+      squares[n] = static_cast<unsigned char>(square);
+      pieces[n] = piece;
+      n++;
+    }
+  }
+
+  this->data.push_back(static_cast<unsigned char>(n));
+  this->data.insert(this->data.end(), squares, squares + n);
+  for (size_t i = 0; i < n; i += 2) {
+    unsigned char high = i + 1 < n ? pieces[i + 1] : 0;
+    this->data.push_back(static_cast<unsigned char>(pieces[i] | (high << 4)));
+  }
+  memcpy(this->last.data(), packed, PACKED_BOARD_SIZE);
+}
+
+size_t ChessGameEncoder::positions(void) const { return this->count; }
+
+const std::vector<unsigned char> &ChessGameEncoder::bytes(void) const { return this->data; }
+
+void ChessGameEncoder::clear(void) {
+  this->data.clear();
+  this->last = {};
+  this->count = 0;
+}
+
+ChessGameDecoder::ChessGameDecoder(const unsigned char *data, size_t size) {
+  this->data = data;
+  this->size = size;
+  this->offset = 0;
+  this->current = {};
+  this->failed = false;
+}
+
+bool ChessGameDecoder::next(unsigned char *packed) {
+  if (this->failed || this->offset == this->size) {
+    return false;
+  }
+
+  if (this->offset == 0) {
+    if (this->size < GAME_CODEC_HEADER_SIZE || memcmp(this->data, GAME_CODEC_MAGIC, sizeof(GAME_CODEC_MAGIC)) != 0) {
+      this->failed = true;
+      return false;
+    }
+    memcpy(this->current.data(), this->data + sizeof(GAME_CODEC_MAGIC), PACKED_BOARD_SIZE);
+    this->offset = GAME_CODEC_HEADER_SIZE;
+  } else {
+    size_t n = this->data[this->offset];
+    size_t length = 1 + n + (n + 1) / 2;
+    if (n > 64 || this->size - this->offset < length) {
+      this->failed = true;
+      return false;
+    }
+    const unsigned char *squares = this->data + this->offset + 1;
+    const unsigned char *pieces = squares + n;
+    for (size_t i = 0; i < n; i++) {
+      if (squares[i] >= 64) {
+        this->failed = true;
+        return false;
+      }
+      unsigned char piece = i % 2 ? pieces[i / 2] >> 4 : pieces[i / 2] & 0x0f;
+      setPiece(this->current.data(), squares[i], piece);
+    }
+    this->offset += length;
+  }
+
+  memcpy(packed, this->current.data(), PACKED_BOARD_SIZE);
+  return true;
+}
+
+bool ChessGameDecoder::error(void) const { return this->failed; }
+
+std::vector<std::string> ChessGameDecoder::toFen(const unsigned char *data, size_t size) {
+  std::vector<std::string> positions;
+  ChessGameDecoder decoder(data, size);
+  unsigned char packed[PACKED_BOARD_SIZE];
+  char fen[BOARD_FEN_MAX];
+  while (decoder.next(packed)) {
+    positions.emplace_back(fen, ChessBoardDecoder::fen(packed, fen));
+  }
+  if (decoder.error()) {
+    positions.clear();
+  }
+  return positions;
+}
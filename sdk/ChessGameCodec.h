@@ -0,0 +1,152 @@
+#ifndef CHESS_GAME_CODEC_HEADER_GUARD
+#define CHESS_GAME_CODEC_HEADER_GUARD
+
+#include "ChessBoard.h"
+#include <string>
+#include <vector>
+
+/*
+Compact binary format of a game file.
+
+  4 bytes   magic 'C' 'L' 'G' and format version 1
+  32 bytes  first position, packed as in the 0x01 message
+  then one record per further position:
+  1 byte    number n of squares that changed, 0 to 64
+  n bytes   the squares, 0 is a1, 7 is h1 and 63 is h8
+  (n+1)/2   the new piece codes of the squares, two per byte, the first
+  bytes     square in the low nibble
+
+A move takes 4 bytes (en passant 6, castling 7), compared to about 60 bytes
+for a FEN. Positions are reproduced exactly, including the intermediate ones
+the board recorded, since nothing is inferred.
+*/
+
+/**
+Positions of a game file as received, PACKED_BOARD_SIZE bytes each in one
+contiguous buffer. FENs are only built when asked for.
+*/
+class ChessGameFile {
+private:
+  std::vector<unsigned char> arena;
+
+public:
+  /**
+  append a packed position, PACKED_BOARD_SIZE bytes
+  */
+  void add(const unsigned char *packed);
+
+  /**
+  returns the number of positions
+  */
+  size_t size(void) const;
+
+  /**
+  returns true if there is no position
+  */
+  bool empty(void) const;
+
+  /**
+  returns the packed position at index, PACKED_BOARD_SIZE bytes
+  */
+  const unsigned char *position(size_t index) const;
+
+  /**
+  write the piece placement field of the position at index to fen, which
+  must hold BOARD_FEN_MAX characters
+  Returns the length of the field, without the terminating NUL
+  */
+  size_t fen(size_t index, char *fen) const;
+
+  /**
+  returns the piece placement field of the position at index
+  */
+  std::string fen(size_t index) const;
+
+  /**
+  returns the piece placement fields of all positions, as ChessLink::getFile
+  */
+  std::vector<std::string> fens(void) const;
+
+  /**
+  remove all positions
+  */
+  void clear(void);
+};
+
+// size of the header and the first position
+constexpr size_t GAME_CODEC_HEADER_SIZE = 4 + PACKED_BOARD_SIZE;
+
+/**
+Builds the binary form of a game from its packed positions, one at a time.
+*/
+class ChessGameEncoder {
+private:
+  std::vector<unsigned char> data;
+
+  // last position added
+  std::array<unsigned char, PACKED_BOARD_SIZE> last;
+
+  size_t count;
+
+public:
+  ChessGameEncoder();
+
+  /**
+  append a packed position, PACKED_BOARD_SIZE bytes
+  */
+  void add(const unsigned char *packed);
+
+  /**
+  returns the number of positions added
+  */
+  size_t positions(void) const;
+
+  /**
+  returns the encoded game, empty if no position was added
+  */
+  const std::vector<unsigned char> &bytes(void) const;
+
+  /**
+  start a new game
+  */
+  void clear(void);
+};
+
+/**
+Reads the positions of a game in binary form, one at a time.
+The decoder does not copy the data, it must stay valid while it is used.
+*/
+class ChessGameDecoder {
+private:
+  const unsigned char *data;
+  size_t size;
+
+  // offset of the next record, 0 before the first position
+  size_t offset;
+
+  std::array<unsigned char, PACKED_BOARD_SIZE> current;
+
+  bool failed;
+
+public:
+  ChessGameDecoder(const unsigned char *data, size_t size);
+
+  /**
+  decode the next position into packed, PACKED_BOARD_SIZE bytes
+  Returns false at the end of the game or if the data is malformed
+  */
+  bool next(unsigned char *packed);
+
+  /**
+  returns true if the data was malformed, as opposed to having ended
+  */
+  bool error(void) const;
+
+  /**
+  decode a whole game into the piece placement fields of its positions
+  Returns the positions, empty if the data is malformed
+  */
+  static std::vector<std::string> toFen(const unsigned char *data, size_t size);
+};
+
+#endif // CHESS_GAME_CODEC_HEADER_GUARD
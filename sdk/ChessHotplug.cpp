@@ -0,0 +1,177 @@
+#include "ChessHotplug.h"
+#include <cstdlib>
+#include <cstring>
+
+#ifdef __linux__
+#include <cerrno>
+#include <linux/netlink.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+// how long reconnecting is retried after a hotplug event, until udev made
+// the device accessible, millisecond
+constexpr uint64_t HOTPLUG_RETRY_WINDOW = 2000;
+
+// interval of the reconnect attempts while a hotplug monitor reports nothing,
+// in case an event was missed, millisecond
+constexpr uint64_t HOTPLUG_SCAN_INTERVAL = 5000;
+
+#ifdef __linux__
+// multicast groups of NETLINK_KOBJECT_UEVENT: raw kernel events, and the same
+// events rebroadcast by udev once its rules, e.g. permissions, are applied
+constexpr uint32_t UEVENT_GROUP_KERNEL = 1;
+constexpr uint32_t UEVENT_GROUP_UDEV = 2;
+
+// udev messages start with this prefix followed by a header, the offset of
+// the properties is its third field
+constexpr char UDEV_PREFIX[] = "libudev";
+constexpr size_t UDEV_PROPERTIES_OFFSET = 16;
+
+// HID_ID=<bus>:<vendor>:<product>, all hexadecimal
+static bool parseHidId(const char *value, uint16_t &vendorId, uint16_t &productId) {
+  char *end;
+  strtoul(value, &end, 16);
+  if (*end != ':') {
+    return false;
+  }
+  vendorId = static_cast<uint16_t>(strtoul(end + 1, &end, 16));
+  if (*end != ':') {
+    return false;
+  }
+  productId = static_cast<uint16_t>(strtoul(end + 1, &end, 16));
+  return *end == '\0';
+}
+
+// true if the uevent in message adds a HID device accepted by match
+static bool matches(const char *message, size_t length, const ChessHotplug::Match &match) {
+  size_t offset;
+  if (length > UDEV_PROPERTIES_OFFSET + 4 && memcmp(message, UDEV_PREFIX, sizeof(UDEV_PREFIX)) == 0) {
+    uint32_t properties;
+    memcpy(&properties, message + UDEV_PROPERTIES_OFFSET, sizeof(properties));
+    offset = properties;
+  } else {
+    // kernel events start with action@devpath
+    offset = strnlen(message, length) + 1;
+  }
+
+  bool add = false;
+  bool hid = false;
+  bool found = false;
+  uint16_t vendorId = 0;
+  uint16_t productId = 0;
+  while (offset < length) {
+    const char *property = message + offset;
+    size_t n = strnlen(property, length - offset);
+    if (offset + n == length) {
+      // not terminated
+      break;
+    }
+    if (strcmp(property, "ACTION=add") == 0) {
+      add = true;
+    } else if (strcmp(property, "SUBSYSTEM=hid") == 0) {
+      hid = true;
+    } else if (strncmp(property, "HID_ID=", 7) == 0) {
+      found = parseHidId(property + 7, vendorId, productId);
+    }
+    offset += n + 1;
+  }
+  return add && hid && found && match(vendorId, productId);
+}
+#endif
+
+ChessHotplug::ChessHotplug() { this->socketFd = -1; }
+
+ChessHotplug::~ChessHotplug() { this->close(); }
+
+bool ChessHotplug::open(void) {
+#ifdef __linux__
+  if (this->socketFd >= 0) {
+    return true;
+  }
+  int fd = socket(AF_NETLINK, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, NETLINK_KOBJECT_UEVENT);
+  if (fd < 0) {
+    return false;
+  }
+  sockaddr_nl addr = {};
+  addr.nl_family = AF_NETLINK;
+  addr.nl_groups = UEVENT_GROUP_KERNEL | UEVENT_GROUP_UDEV;
+  if (bind(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) != 0) {
+    ::close(fd);
+    return false;
+  }
+  this->socketFd = fd;
+  return true;
+#else
+  return false;
+#endif
+}
+
+bool ChessHotplug::open(int fd) {
+  this->close();
+  this->socketFd = fd;
+  return fd >= 0;
+}
+
+void ChessHotplug::close(void) {
+#ifdef __linux__
+  if (this->socketFd >= 0) {
+    ::close(this->socketFd);
+    this->socketFd = -1;
+  }
+#endif
+}
+
+int ChessHotplug::descriptor(void) const { return this->socketFd; }
+
+bool ChessHotplug::added(const Match &match) {
+  bool res = false;
+#ifdef __linux__
+  if (this->socketFd < 0) {
+    return false;
+  }
+  char message[8192];
+  for (;;) {
+    auto n = recv(this->socketFd, message, sizeof(message), MSG_DONTWAIT);
+    if (n > 0) {
+      res = matches(message, static_cast<size_t>(n), match) || res;
+    } else if (n < 0 && errno == EINTR) {
+      continue;
+    } else {
+      // events were dropped if the socket buffer overflowed, one of them may
+      // have been the board
+      if (n < 0 && errno == ENOBUFS) {
+        res = true;
+        continue;
+      }
+      break;
+    }
+  }
+#else
+  (void)match;
+#endif
+  return res;
+}
+
+ChessReconnect::ChessReconnect() {
+  this->retryUntil = 0;
+  this->nextScan = 0;
+}
+
+bool ChessReconnect::attempt(uint64_t now, bool monitored) {
+  if (monitored && now >= this->retryUntil && now < this->nextScan) {
+    return false;
+  }
+  this->nextScan = now + HOTPLUG_SCAN_INTERVAL * 1000;
+  return true;
+}
+
+bool ChessReconnect::retrying(uint64_t now, bool monitored) const { return !monitored || now < this->retryUntil; }
+
+void ChessReconnect::plugged(uint64_t now) { this->retryUntil = now + HOTPLUG_RETRY_WINDOW * 1000; }
+
+void ChessReconnect::wake(void) { this->nextScan = 0; }
+
+void ChessReconnect::connected(void) { this->retryUntil = 0; }
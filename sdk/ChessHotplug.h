@@ -0,0 +1,109 @@
+#ifndef CHESS_HOTPLUG_HEADER_GUARD
+#define CHESS_HOTPLUG_HEADER_GUARD
+
+#include <cstdint>
+#include <functional>
+
+/**
+Watches for HID devices being plugged in.
+
+On Linux the monitor listens to the kobject uevents the kernel and udev
+broadcast over netlink, so a disconnected ChessLink can block in its reactor
+on descriptor() and enumerate devices only once a matching one appears,
+instead of polling. The uevents carry the vendor and product id of the HID
+device but not its usage page, a match only means that enumerating is worth
+it. On other platforms, or if the socket cannot be opened, there is no
+descriptor and the caller has to keep polling.
+*/
+class ChessHotplug {
+private:
+  // netlink socket, -1 if not open
+  int socketFd;
+
+public:
+  // decides whether an added HID device with this vendor and product id may
+  // be the board
+  using Match = std::function<bool(uint16_t vendorId, uint16_t productId)>;
+
+  ChessHotplug();
+  ~ChessHotplug();
+
+  ChessHotplug(const ChessHotplug &) = delete;
+  ChessHotplug &operator=(const ChessHotplug &) = delete;
+
+  /**
+  start monitoring, does nothing if already started
+  Returns true if devices are monitored
+  */
+  bool open(void);
+
+  /**
+  monitor a descriptor that receives uevents in the netlink format instead
+  of the netlink socket, e.g. one end of a socketpair; the monitor owns it
+  Returns true if fd is valid
+  */
+  bool open(int fd);
+
+  /**
+  stop monitoring, uevents arriving meanwhile are not seen
+  */
+  void close(void);
+
+  /**
+  returns the descriptor that becomes readable when uevents arrive, -1 if
+  devices are not monitored
+  */
+  int descriptor(void) const;
+
+  /**
+  consume the pending uevents without blocking
+  Returns true if a HID device accepted by match was added
+  */
+  bool added(const Match &match);
+};
+
+/**
+When a disconnected board is worth reconnecting to, in steady microseconds.
+
+Without a hotplug monitor every attempt is due. With one, attempts are only
+due for 2 seconds after a board was plugged in, until udev made the device
+accessible, and once every 5 seconds in case an event was missed. Only used
+by the thread that drives the link.
+*/
+class ChessReconnect {
+private:
+  uint64_t retryUntil;
+  uint64_t nextScan;
+
+public:
+  ChessReconnect();
+
+  /**
+  check whether to try connecting at now, and if so schedule the next scan
+  Returns true if an attempt is due
+  */
+  bool attempt(uint64_t now, bool monitored);
+
+  /**
+  returns true while failed attempts are retried quickly, i.e. without a
+  monitor or shortly after a board was plugged in
+  */
+  bool retrying(uint64_t now, bool monitored) const;
+
+  /**
+  a board may have been plugged in, retry from now on for a while
+  */
+  void plugged(uint64_t now);
+
+  /**
+  make the next attempt due right away, e.g. after ChessLink::connect
+  */
+  void wake(void);
+
+  /**
+  the board was connected, forget the retries
+  */
+  void connected(void);
+};
+
+#endif // CHESS_HOTPLUG_HEADER_GUARD
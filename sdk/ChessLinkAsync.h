@@ -0,0 +1,219 @@
+#ifndef CHESS_LINK_ASYNC_HEADER_GUARD
+#define CHESS_LINK_ASYNC_HEADER_GUARD
+
+#include "EasyLink.h"
+
+// C++20 coroutine layer on top of the non-blocking ChessLink methods, only
+// available when the compiler supports coroutines
+#if defined(__cpp_impl_coroutine) && __has_include(<coroutine>)
+#include <coroutine>
+#include <atomic>
+#include <exception>
+#include <utility>
+
+/**
+Awaitable for one non-blocking ChessLink operation.
+The coroutine is suspended until the operation completes and is resumed on
+the SDK thread that completed it, so the application needs no thread of its
+own per board. An operation that completes before the coroutine finished
+suspending does not suspend it at all.
+*/
+template <class T> class ChessOperation {
+private:
+  // starts the operation with a completion callback
+  function<void(function<void(T)>)> start;
+
+  T result;
+
+  // set by the first of await_suspend and the completion callback to get
+  // past the start of the operation; the second one continues the coroutine
+  atomic_bool handoff;
+
+public:
+  explicit ChessOperation(function<void(function<void(T)>)> start) : start(move(start)), result(), handoff(false) {}
+
+  bool await_ready() const noexcept { return false; }
+
+  bool await_suspend(coroutine_handle<> handle) {
+    this->start([this, handle](T value) {
+      this->result = move(value);
+      if (this->handoff.exchange(true, memory_order_acq_rel)) {
+        handle.resume();
+      }
+    });
+    // completed synchronously, carry on without suspending
+    return !this->handoff.exchange(true, memory_order_acq_rel);
+  }
+
+  T await_resume() { return move(this->result); }
+};
+
+/**
+Coroutine type, the coroutine starts right away.
+The task owns the coroutine frame: wait() blocks until the coroutine
+returned, and the frame is freed by whichever of the task and the coroutine
+finishes last, so a task may also be dropped to let the coroutine run on by
+itself.
+example:
+ChessTask run(ChessLinkAsync link) {
+  auto battery = co_await link.battery();
+  co_await link.setLedAsync(leds);
+}
+run(link).wait();
+*/
+class ChessTask {
+public:
+  struct promise_type;
+
+private:
+  coroutine_handle<promise_type> handle;
+
+  // suspends the coroutine when it returns and frees it if its task is gone
+  struct FinalAwaiter {
+    bool await_ready() const noexcept { return false; }
+    void await_suspend(coroutine_handle<promise_type> handle) noexcept;
+    void await_resume() const noexcept {}
+  };
+
+  explicit ChessTask(coroutine_handle<promise_type> handle) : handle(handle) {}
+
+public:
+  struct promise_type {
+    // set once the coroutine returned
+    atomic_bool finished{false};
+
+    // set by the first of the coroutine and its task to let go of the frame
+    atomic_bool released{false};
+
+    ChessTask get_return_object() noexcept { return ChessTask(coroutine_handle<promise_type>::from_promise(*this)); }
+    suspend_never initial_suspend() noexcept { return {}; }
+    FinalAwaiter final_suspend() noexcept { return {}; }
+    void return_void() noexcept {}
+    void unhandled_exception() noexcept { terminate(); }
+  };
+
+  ChessTask(ChessTask &&other) noexcept : handle(exchange(other.handle, nullptr)) {}
+  ChessTask(const ChessTask &) = delete;
+  ChessTask &operator=(const ChessTask &) = delete;
+  ChessTask &operator=(ChessTask &&other) noexcept {
+    if (this != &other) {
+      this->release();
+      this->handle = exchange(other.handle, nullptr);
+    }
+    return *this;
+  }
+  ~ChessTask() { this->release(); }
+
+  /**
+  returns true once the coroutine returned
+  */
+  bool done() const { return !this->handle || this->handle.promise().finished.load(memory_order_acquire); }
+
+  /**
+  block until the coroutine returned
+  */
+  void wait() const {
+    if (this->handle) {
+      this->handle.promise().finished.wait(false, memory_order_acquire);
+    }
+  }
+
+private:
+  // let go of the frame, freeing it if the coroutine already returned
+  void release() {
+    if (this->handle && this->handle.promise().released.exchange(true, memory_order_acq_rel)) {
+      this->handle.destroy();
+    }
+    this->handle = nullptr;
+  }
+};
+
+inline void ChessTask::FinalAwaiter::await_suspend(coroutine_handle<promise_type> handle) noexcept {
+  auto &promise = handle.promise();
+  promise.finished.store(true, memory_order_release);
+  promise.finished.notify_all();
+  if (promise.released.exchange(true, memory_order_acq_rel)) {
+    handle.destroy();
+  }
+}
+
+/**
+Coroutine interface of a ChessLink.
+Do not call the blocking ChessLink methods from these coroutines, since after
+the first co_await they run on the threads those methods wait for.
+*/
+class ChessLinkAsync {
+private:
+  shared_ptr<ChessLink> link;
+
+public:
+  explicit ChessLinkAsync(shared_ptr<ChessLink> link) : link(move(link)) {}
+
+  // access to the underlying ChessLink
+  ChessLink *operator->() const { return this->link.get(); }
+
+  /**
+  query mcu version, empty on failure
+  */
+  ChessOperation<string> mcuVersion() {
+    auto l = this->link;
+    return ChessOperation<string>([l](function<void(string)> done) { l->getMcuVersionAsync(move(done)); });
+  }
+
+  /**
+  query ble version, empty on failure
+  */
+  ChessOperation<string> bleVersion() {
+    auto l = this->link;
+    return ChessOperation<string>([l](function<void(string)> done) { l->getBleVersionAsync(move(done)); });
+  }
+
+  /**
+  query battery state, -1 on failure
+  */
+  ChessOperation<int> battery() {
+    auto l = this->link;
+    return ChessOperation<int>([l](function<void(int)> done) { l->getBatteryAsync(move(done)); });
+  }
+
+  /**
+  query saved file count, -1 on failure
+  */
+  ChessOperation<int> fileCount() {
+    auto l = this->link;
+    return ChessOperation<int>([l](function<void(int)> done) { l->getFileCountAsync(move(done)); });
+  }
+
+  /**
+  Control the buzzer to sound, resumes once the command was sent
+  Returns the result of the write, <= 0 on failure
+  */
+  ChessOperation<int> beep(const uint16_t frequency = 1000, const uint16_t duration = 200) {
+    auto l = this->link;
+    return ChessOperation<int>(
+        [l, frequency, duration](function<void(int)> done) { l->beepAsync(frequency, duration, move(done)); });
+  }
+
+  /**
+  Control led light, resumes once the command was sent
+  Returns the result of the write, <= 0 on failure
+  */
+  ChessOperation<int> setLedAsync(const array<bitset<8>, 8> status) {
+    auto l = this->link;
+    return ChessOperation<int>([l, status](function<void(int)> done) { l->setLedAsync(status, move(done)); });
+  }
+
+  /**
+  get the next saved file, see ChessLink::getFile
+  Returns the list of fen, empty if there is no file or the transfer failed
+  */
+  ChessOperation<vector<string>> nextGameFile(bool is_delete = true) {
+    auto l = this->link;
+    return ChessOperation<vector<string>>(
+        [l, is_delete](function<void(vector<string>)> done) { l->getFileAsync(move(done), is_delete); });
+  }
+};
+
+#endif
+
+#endif // CHESS_LINK_ASYNC_HEADER_GUARD
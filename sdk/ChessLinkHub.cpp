@@ -0,0 +1,357 @@
+#include "ChessLinkHub.h"
+
+#ifdef __linux__
+
+#include <pthread.h>
+#include <unordered_map>
+
+// default number of I/O threads at most
+constexpr unsigned HUB_MAX_THREADS = 4;
+
+// reactor token of the hotplug monitor, boards are identified by their
+// address
+constexpr uint64_t HOTPLUG_TOKEN = 1;
+
+// steady clock time in microseconds, the clock ChessLink timestamps with
+static uint64_t steadyMicros(chrono::steady_clock::time_point time) {
+  return chrono::duration_cast<chrono::microseconds>(time.time_since_epoch()).count();
+}
+
+struct ChessLinkHub::Board {
+  // the device is only used while the ChessLink is locked, which owns it
+  weak_ptr<ChessLink> chesslink;
+  Connect *device;
+
+  // set by any thread when commands were queued
+  atomic_bool queued;
+
+  // set by any thread when the link was connected, disconnected or its
+  // timers changed, the next visit runs ChessLink::service right away
+  atomic_bool woken;
+
+  // when the head of the queue may be sent, and when ChessLink::service
+  // wants to run again, steady microseconds
+  chrono::steady_clock::time_point writeDue;
+  uint64_t serviceAt;
+
+  // descriptor in the reactor, -1 if none, and the connect it belongs to
+  int watchedFd;
+  unsigned watchedConnect;
+
+  Board() {
+    this->device = nullptr;
+    this->queued = false;
+    this->woken = false;
+    this->writeDue = chrono::steady_clock::time_point::max();
+    this->serviceAt = 0;
+    this->watchedFd = -1;
+    this->watchedConnect = 0;
+  }
+};
+
+struct ChessLinkHub::Worker {
+  ChessReactor reactor;
+
+  thread ioThread;
+
+  atomic_bool stopping;
+
+  // set when all boards need a visit: commands queued, boards attached, a
+  // board plugged in or disconnected
+  atomic_bool dirty;
+
+  // boards attached but not yet taken by the thread
+  mutex addMutex;
+  vector<shared_ptr<Board>> added;
+
+  // boards of the thread
+  vector<shared_ptr<Board>> boards;
+
+  // number of boards attached, for choosing the thread of the next one
+  atomic<size_t> load;
+
+  // tells the thread when a board may have been plugged in, open while one
+  // of its boards is absent
+  ChessHotplug hotplug;
+  bool hotplugWatched;
+
+  // the board each descriptor in the reactor belongs to; a closed node
+  // leaves the reactor by itself and its number may already be reused by
+  // another board when the old board notices
+  unordered_map<int, Board *> watching;
+
+  atomic<uint64_t> wakeups;
+
+  Worker() {
+    this->stopping = false;
+    this->dirty = false;
+    this->load = 0;
+    this->hotplugWatched = false;
+    this->wakeups = 0;
+  }
+
+  // thread body
+  void run(void);
+
+  // visit all boards: timers, reconnects, writes and the reactor's
+  // descriptors; Returns when the next timer or paced write is due
+  chrono::steady_clock::time_point visit(chrono::steady_clock::time_point now);
+
+  // read a board whose node is readable
+  void read(Board &board, unsigned char *readBuf, size_t length, chrono::steady_clock::time_point &due);
+
+  // put the descriptor of a board in the reactor, or take it out if -1
+  void watch(Board &board, int fd);
+};
+
+class ChessLinkHub::Connect : public ChessHidrawConnect {
+private:
+  friend class ChessLinkHub;
+
+  shared_ptr<Worker> worker;
+
+  shared_ptr<Board> board;
+
+protected:
+  // overload, wakes the board's thread
+  void b_queued(void) {
+    this->board->queued = true;
+    this->worker->dirty = true;
+    if (this_thread::get_id() != this->worker->ioThread.get_id()) {
+      this->worker->reactor.wake();
+    }
+  }
+
+public:
+  Connect(string path, shared_ptr<Worker> worker, shared_ptr<Board> board) : ChessHidrawConnect(path) {
+    this->worker = worker;
+    this->board = board;
+  }
+
+  // overload, refuses to open the node once the hub is gone
+  bool b_connect(void) { return !this->worker->stopping && ChessHidrawConnect::b_connect(); }
+
+  // overload, wakes the board's thread, which services the link right away
+  void b_wake(void) {
+    this->board->woken = true;
+    this->worker->dirty = true;
+    if (this_thread::get_id() != this->worker->ioThread.get_id()) {
+      this->worker->reactor.wake();
+    }
+  }
+};
+
+void ChessLinkHub::Worker::watch(Board &board, int fd) {
+  if (board.watchedFd >= 0) {
+    auto it = this->watching.find(board.watchedFd);
+    if (it != this->watching.end() && it->second == &board) {
+      this->reactor.remove(board.watchedFd);
+      this->watching.erase(it);
+    }
+    board.watchedFd = -1;
+  }
+  if (fd >= 0 && this->reactor.add(fd, reinterpret_cast<uint64_t>(&board))) {
+    this->watching[fd] = &board;
+    board.watchedFd = fd;
+  }
+}
+
+chrono::steady_clock::time_point ChessLinkHub::Worker::visit(chrono::steady_clock::time_point now) {
+  auto micros = steadyMicros(now);
+  bool monitored = this->hotplugWatched;
+  bool absent = false;
+  auto due = chrono::steady_clock::time_point::max();
+  for (size_t i = 0; i < this->boards.size();) {
+    auto &board = *this->boards[i];
+    auto chesslink = board.chesslink.lock();
+    if (!chesslink) {
+      this->watch(board, -1);
+      this->boards[i] = this->boards.back();
+      this->boards.pop_back();
+      this->load--;
+      continue;
+    }
+    auto device = board.device;
+
+    // a reopened node may reuse the previous descriptor number, which the
+    // kernel has already dropped from the reactor
+    int fd = device->b_fd();
+    unsigned count = device->connectCount;
+    if (fd != board.watchedFd || count != board.watchedConnect) {
+      this->watch(board, fd);
+      board.watchedConnect = count;
+    }
+
+    // debounce and reconnect timers
+    if (board.woken.exchange(false) || micros >= board.serviceAt) {
+      board.serviceAt = micros + static_cast<uint64_t>(chesslink->service(micros, monitored)) * 1000;
+    }
+    if (!device->connectStatus && chesslink->reconnected) {
+      absent = true;
+    }
+
+    if (board.queued.exchange(false) || now >= board.writeDue) {
+      ChessCommand cmd;
+      while (device->nextWrite(now, cmd, board.writeDue)) {
+        device->sendWrite(cmd);
+      }
+    }
+
+    due = min(due, board.writeDue);
+    due = min(due, chrono::steady_clock::time_point(chrono::microseconds(board.serviceAt)));
+    i++;
+  }
+
+  // with a hotplug monitor, absent boards only enumerate the devices once a
+  // matching one was added, see ChessLink::service
+  if (absent && !this->hotplugWatched && this->hotplug.open()) {
+    this->hotplugWatched = this->reactor.add(this->hotplug.descriptor(), HOTPLUG_TOKEN);
+  } else if (!absent && this->hotplug.descriptor() >= 0) {
+    this->reactor.remove(this->hotplug.descriptor());
+    this->hotplug.close();
+    this->hotplugWatched = false;
+  }
+  return due;
+}
+
+void ChessLinkHub::Worker::read(Board &board, unsigned char *readBuf, size_t length,
+                                chrono::steady_clock::time_point &due) {
+  auto chesslink = board.chesslink.lock();
+  if (!chesslink) {
+    return;
+  }
+  int res = board.device->read(readBuf, length);
+  auto now = chrono::steady_clock::now();
+  chesslink->receive(readBuf, res, steadyMicros(now));
+  if (!board.device->connectStatus) {
+    this->dirty = true;
+    return;
+  }
+  // the report may have started a debounce window
+  auto micros = steadyMicros(now);
+  board.serviceAt = micros + static_cast<uint64_t>(chesslink->service(micros, this->hotplugWatched)) * 1000;
+  due = min(due, chrono::steady_clock::time_point(chrono::microseconds(board.serviceAt)));
+}
+
+void ChessLinkHub::Worker::run(void) {
+  unsigned char readBuf[256];
+  vector<uint64_t> ready;
+  auto due = chrono::steady_clock::time_point::min();
+  while (!this->stopping) {
+    this->wakeups++;
+    {
+      lock_guard<mutex> lock(this->addMutex);
+      for (auto &board : this->added) {
+        this->boards.push_back(move(board));
+      }
+      this->added.clear();
+    }
+
+    auto now = chrono::steady_clock::now();
+    if (this->dirty.exchange(false) || now >= due) {
+      due = this->visit(now);
+    }
+
+    int timeout = -1;
+    if (due != chrono::steady_clock::time_point::max()) {
+      // round up, so that the timer is due when the wait times out
+      auto wait = chrono::ceil<chrono::milliseconds>(max(due - now, chrono::steady_clock::duration::zero()));
+      timeout = static_cast<int>(wait.count());
+    }
+    this->reactor.wait(timeout, ready);
+
+    for (auto token : ready) {
+      if (token == HOTPLUG_TOKEN) {
+        if (this->hotplug.added(ChessHidConnect::isBoard)) {
+          auto micros = steadyMicros(chrono::steady_clock::now());
+          for (auto &board : this->boards) {
+            if (auto chesslink = board->chesslink.lock()) {
+              chesslink->plugged(micros);
+              board->serviceAt = 0;
+            }
+          }
+          this->dirty = true;
+        }
+        continue;
+      }
+      this->read(*reinterpret_cast<Board *>(token), readBuf, sizeof(readBuf), due);
+    }
+  }
+}
+
+ChessLinkHub::ChessLinkHub(unsigned threads, bool pinned) {
+  unsigned cores = thread::hardware_concurrency();
+  if (threads == 0) {
+    threads = min(max(cores, 1u), HUB_MAX_THREADS);
+  }
+  for (unsigned i = 0; i < threads; i++) {
+    auto worker = make_shared<Worker>();
+    worker->ioThread = thread(&Worker::run, worker.get());
+    if (pinned && i < cores) {
+      cpu_set_t cpus;
+      CPU_ZERO(&cpus);
+      CPU_SET(i, &cpus);
+      pthread_setaffinity_np(worker->ioThread.native_handle(), sizeof(cpus), &cpus);
+    }
+    this->workers.push_back(worker);
+  }
+}
+
+ChessLinkHub::~ChessLinkHub() {
+  for (auto &worker : this->workers) {
+    worker->stopping = true;
+    worker->reactor.wake();
+  }
+  for (auto &worker : this->workers) {
+    worker->ioThread.join();
+    // the boards keep the worker, but nothing reads or writes them any more;
+    // links that outlive the hub fail their queued and future commands
+    for (auto *boards : {&worker->boards, &worker->added}) {
+      for (auto &board : *boards) {
+        if (auto chesslink = board->chesslink.lock()) {
+          chesslink->disconnect();
+          board->device->stopWriter();
+        }
+      }
+    }
+  }
+}
+
+shared_ptr<ChessLink> ChessLinkHub::attach(string path) {
+  auto lighter = [](const shared_ptr<Worker> &a, const shared_ptr<Worker> &b) { return a->load < b->load; };
+  auto worker = *min_element(this->workers.begin(), this->workers.end(), lighter);
+  auto board = make_shared<Board>();
+  auto device = new Connect(path, worker, board);
+  board->device = device;
+  shared_ptr<ChessLink> r(new ChessLink(device));
+  board->chesslink = r;
+
+  worker->load++;
+  {
+    lock_guard<mutex> lock(worker->addMutex);
+    worker->added.push_back(board);
+  }
+  worker->dirty = true;
+  worker->reactor.wake();
+  return r;
+}
+
+size_t ChessLinkHub::getThreads(void) { return this->workers.size(); }
+
+vector<size_t> ChessLinkHub::getBoards(void) {
+  vector<size_t> boards;
+  for (auto &worker : this->workers) {
+    boards.push_back(worker->load);
+  }
+  return boards;
+}
+
+uint64_t ChessLinkHub::getWakeups(void) {
+  uint64_t wakeups = 0;
+  for (auto &worker : this->workers) {
+    wakeups += worker->wakeups;
+  }
+  return wakeups;
+}
+
+#endif
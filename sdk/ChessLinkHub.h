@@ -0,0 +1,77 @@
+#ifndef CHESS_LINK_HUB_HEADER_GUARD
+#define CHESS_LINK_HUB_HEADER_GUARD
+
+#include "EasyLink.h"
+
+#ifdef __linux__
+
+/**
+Drives any number of boards from a small fixed pool of I/O threads, instead
+of a read thread and a writer thread per ChessLink.
+
+A board is attached to the thread with the fewest boards and stays on it, so
+its reports, writes, debounce timers and reconnects are all handled by the
+same thread, which waits for all of its boards in one ChessReactor and only
+visits the boards whose node is readable unless a timer is due or commands
+were queued. The boards are opened through their hidraw nodes, see
+ChessHidrawConnect. A thread sends the commands of its boards itself as their
+pacing allows and is blocked for the transfer, like a writer thread would be.
+*/
+class ChessLinkHub {
+private:
+  // a board and the state its thread keeps for it
+  struct Board;
+
+  // an I/O thread and its boards
+  struct Worker;
+
+  // hidraw transport of a board, wakes its thread when commands are queued
+  class Connect;
+
+  vector<shared_ptr<Worker>> workers;
+
+public:
+  /**
+  start the I/O threads, threads is their number, 0 for one per core up to
+  four; pinned binds each thread to its own core, as far as there are cores
+  */
+  ChessLinkHub(unsigned threads = 0, bool pinned = false);
+
+  /**
+  stop the I/O threads, the boards still attached are disconnected and no
+  longer read
+  */
+  ~ChessLinkHub();
+
+  ChessLinkHub(const ChessLinkHub &) = delete;
+  ChessLinkHub &operator=(const ChessLinkHub &) = delete;
+
+  /**
+  attach a board to the thread with the fewest boards
+  path is the board's hidraw node, empty to open the first board found
+  whenever it connects. The callbacks of the link run on its I/O thread,
+  they must not call the blocking methods of any ChessLink of the hub.
+  Returns the link, connect() it to open the board
+  */
+  shared_ptr<ChessLink> attach(string path = "");
+
+  /**
+  returns the number of I/O threads
+  */
+  size_t getThreads(void);
+
+  /**
+  returns the number of boards attached to each I/O thread
+  */
+  vector<size_t> getBoards(void);
+
+  /**
+  returns how many times the I/O threads have woken up, for measuring idle
+  wakeups per second
+  */
+  uint64_t getWakeups(void);
+};
+
+#endif
+
+#endif // CHESS_LINK_HUB_HEADER_GUARD
@@ -0,0 +1,449 @@
+#include "ChessMoveTracker.h"
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+using Piece = BoardState::Piece;
+
+// piece codes by side, white first, and by type
+enum PieceType { Pawn, Knight, Bishop, Rook, Queen, King };
+
+constexpr uint8_t PIECE_CODES[2][6] = {
+    {Piece::WhitePawn, Piece::WhiteKnight, Piece::WhiteBishop, Piece::WhiteRook, Piece::WhiteQueen, Piece::WhiteKing},
+    {Piece::BlackPawn, Piece::BlackKnight, Piece::BlackBishop, Piece::BlackRook, Piece::BlackQueen, Piece::BlackKing},
+};
+
+static BoardState initialPosition() {
+  BoardState board;
+  BoardState::fromFen("rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR", board);
+  return board;
+}
+
+static const BoardState INITIAL_POSITION = initialPosition();
+
+constexpr uint64_t bit(int square) { return 1ull << square; }
+
+// index of the lowest and highest set bit, bits must not be 0
+static inline int lowest(uint64_t bits) {
+#if defined(__GNUC__) || defined(__clang__)
+  return __builtin_ctzll(bits);
+#elif defined(_MSC_VER) && defined(_M_X64)
+  unsigned long index;
+  _BitScanForward64(&index, bits);
+  return static_cast<int>(index);
+#else
+  int index = 0;
+  while (!(bits & 1)) {
+    bits >>= 1;
+    index++;
+  }
+  return index;
+#endif
+}
+
+static inline int highest(uint64_t bits) {
+#if defined(__GNUC__) || defined(__clang__)
+  return 63 - __builtin_clzll(bits);
+#elif defined(_MSC_VER) && defined(_M_X64)
+  unsigned long index;
+  _BitScanReverse64(&index, bits);
+  return static_cast<int>(index);
+#else
+  int index = 63;
+  while (!(bits >> 63)) {
+    bits <<= 1;
+    index--;
+  }
+  return index;
+#endif
+}
+
+// rays run north, east, north-east and north-west towards higher squares and
+// south, west, south-east and south-west towards lower ones
+constexpr int RAY_DIRECTIONS[8][2] = {{1, 0}, {0, 1}, {1, 1}, {1, -1}, {-1, 0}, {0, -1}, {-1, 1}, {-1, -1}};
+
+struct AttackTables {
+  uint64_t knight[64];
+  uint64_t king[64];
+  // squares attacked by a pawn of each side
+  uint64_t pawn[2][64];
+  uint64_t rays[8][64];
+};
+
+static uint64_t steps(int square, const int (*offsets)[2], int count, int distance) {
+  uint64_t bits = 0;
+  for (int i = 0; i < count; i++) {
+    int rank = square / 8;
+    int file = square % 8;
+    for (int d = 0; d < distance; d++) {
+      rank += offsets[i][0];
+      file += offsets[i][1];
+      if (rank < 0 || rank > 7 || file < 0 || file > 7) {
+        break;
+      }
+      bits |= bit(rank * 8 + file);
+    }
+  }
+  return bits;
+}
+
+static AttackTables attackTables() {
+  const int knight[8][2] = {{2, 1}, {2, -1}, {-2, 1}, {-2, -1}, {1, 2}, {1, -2}, {-1, 2}, {-1, -2}};
+  const int whitePawn[2][2] = {{1, 1}, {1, -1}};
+  const int blackPawn[2][2] = {{-1, 1}, {-1, -1}};
+  AttackTables tables;
+  for (int square = 0; square < 64; square++) {
+    tables.knight[square] = steps(square, knight, 8, 1);
+    tables.king[square] = steps(square, RAY_DIRECTIONS, 8, 1);
+    tables.pawn[0][square] = steps(square, whitePawn, 2, 1);
+    tables.pawn[1][square] = steps(square, blackPawn, 2, 1);
+    for (int direction = 0; direction < 8; direction++) {
+      tables.rays[direction][square] = steps(square, RAY_DIRECTIONS + direction, 1, 7);
+    }
+  }
+  return tables;
+}
+
+static const AttackTables TABLES = attackTables();
+
+// squares a slider on square reaches along one ray, up to the first blocker
+static inline uint64_t ray(int direction, int square, uint64_t occupied) {
+  uint64_t attacks = TABLES.rays[direction][square];
+  uint64_t blockers = attacks & occupied;
+  if (blockers) {
+    attacks ^= TABLES.rays[direction][direction < 4 ? lowest(blockers) : highest(blockers)];
+  }
+  return attacks;
+}
+
+static inline uint64_t rookAttacks(int square, uint64_t occupied) {
+  return ray(0, square, occupied) | ray(1, square, occupied) | ray(4, square, occupied) | ray(5, square, occupied);
+}
+
+static inline uint64_t bishopAttacks(int square, uint64_t occupied) {
+  return ray(2, square, occupied) | ray(3, square, occupied) | ray(6, square, occupied) | ray(7, square, occupied);
+}
+
+// castling rights lost when a piece moves from or to a square
+static uint8_t castlingLost(int square) {
+  switch (square) {
+  case 0:
+    return ChessMoveTracker::WhiteQueenside;
+  case 4:
+    return ChessMoveTracker::WhiteKingside | ChessMoveTracker::WhiteQueenside;
+  case 7:
+    return ChessMoveTracker::WhiteKingside;
+  case 56:
+    return ChessMoveTracker::BlackQueenside;
+  case 60:
+    return ChessMoveTracker::BlackKingside | ChessMoveTracker::BlackQueenside;
+  case 63:
+    return ChessMoveTracker::BlackKingside;
+  default:
+    return 0;
+  }
+}
+
+static std::string squareName(int square) {
+  return {static_cast<char>('a' + square % 8), static_cast<char>('1' + square / 8)};
+}
+
+std::string ChessMove::uci() const {
+  static const char PROMOTION_LETTERS[] = "0qkbpnrprbnqk";
+  std::string text = squareName(this->from) + squareName(this->to);
+  if (this->promotion != Piece::Empty) {
+    text += PROMOTION_LETTERS[this->promotion];
+  }
+  return text;
+}
+
+ChessMoveTracker::ChessMoveTracker() { this->reset(); }
+
+void ChessMoveTracker::reset(void) { this->reset(INITIAL_POSITION, true); }
+
+void ChessMoveTracker::reset(const BoardState &board, bool whiteToMove) {
+  this->position = board;
+  this->white = whiteToMove;
+  this->enPassant = -1;
+  this->halfmoves = 0;
+  this->fullmoves = 1;
+
+  this->castling = 0;
+  auto at = [&board](int square, uint8_t piece) { return board.pieceAt(square) == piece; };
+  if (at(4, Piece::WhiteKing)) {
+    this->castling |= at(7, Piece::WhiteRook) ? WhiteKingside : 0;
+    this->castling |= at(0, Piece::WhiteRook) ? WhiteQueenside : 0;
+  }
+  if (at(60, Piece::BlackKing)) {
+    this->castling |= at(63, Piece::BlackRook) ? BlackKingside : 0;
+    this->castling |= at(56, Piece::BlackRook) ? BlackQueenside : 0;
+  }
+}
+
+bool ChessMoveTracker::attacked(int square, bool byWhite) const {
+  const uint8_t *codes = PIECE_CODES[byWhite ? 0 : 1];
+  auto pieces = [this, codes](int type) { return this->position.pieces[codes[type] - 1]; };
+  uint64_t occupied = this->position.occupied;
+  // a pawn attacks the square if a pawn of the other side on the square
+  // would attack the pawn
+  return (TABLES.pawn[byWhite ? 1 : 0][square] & pieces(Pawn)) || (TABLES.knight[square] & pieces(Knight)) ||
+         (TABLES.king[square] & pieces(King)) ||
+         (rookAttacks(square, occupied) & (pieces(Rook) | pieces(Queen))) ||
+         (bishopAttacks(square, occupied) & (pieces(Bishop) | pieces(Queen)));
+}
+
+size_t ChessMoveTracker::generate(uint64_t fromMask, ChessMove *moves) const {
+  const int side = this->white ? 0 : 1;
+  const uint8_t *codes = PIECE_CODES[side];
+  const uint8_t *theirCodes = PIECE_CODES[1 - side];
+  uint64_t own = 0;
+  for (int type = Pawn; type <= King; type++) {
+    own |= this->position.pieces[codes[type] - 1];
+  }
+  const uint64_t occupied = this->position.occupied;
+  const uint64_t their = occupied & ~own;
+  size_t n = 0;
+
+  auto add = [&](int from, int to, uint8_t piece, uint8_t flags) {
+    uint8_t captured = (their & bit(to)) ? this->position.pieceAt(to) : static_cast<uint8_t>(Piece::Empty);
+    moves[n++] = {static_cast<uint8_t>(from),
+                  static_cast<uint8_t>(to),
+                  piece,
+                  captured,
+                  static_cast<uint8_t>(Piece::Empty),
+                  static_cast<uint8_t>(flags | (captured ? ChessMove::Capture : 0))};
+  };
+  auto addPawn = [&](int from, int to) {
+    if (to / 8 == 0 || to / 8 == 7) {
+      for (int type : {Queen, Rook, Bishop, Knight}) {
+        add(from, to, codes[Pawn], ChessMove::Promotion);
+        moves[n - 1].promotion = codes[type];
+      }
+    } else {
+      add(from, to, codes[Pawn], 0);
+    }
+  };
+
+  // pawns
+  const int forward = this->white ? 8 : -8;
+  for (uint64_t bits = this->position.pieces[codes[Pawn] - 1] & fromMask; bits; bits &= bits - 1) {
+    int from = lowest(bits);
+    int to = from + forward;
+    if (to >= 0 && to < 64 && !(occupied & bit(to))) {
+      addPawn(from, to);
+      int home = this->white ? 1 : 6;
+      if (from / 8 == home && !(occupied & bit(to + forward))) {
+        add(from, to + forward, codes[Pawn], ChessMove::DoublePush);
+      }
+    }
+    for (uint64_t targets = TABLES.pawn[side][from] & their; targets; targets &= targets - 1) {
+      addPawn(from, lowest(targets));
+    }
+    if (this->enPassant >= 0 && (TABLES.pawn[side][from] & bit(this->enPassant))) {
+      add(from, this->enPassant, codes[Pawn], ChessMove::EnPassant | ChessMove::Capture);
+      moves[n - 1].captured = theirCodes[Pawn];
+    }
+  }
+
+  // pieces
+  for (int type = Knight; type <= King; type++) {
+    for (uint64_t bits = this->position.pieces[codes[type] - 1] & fromMask; bits; bits &= bits - 1) {
+      int from = lowest(bits);
+      uint64_t targets;
+      switch (type) {
+      case Knight:
+        targets = TABLES.knight[from];
+        break;
+      case Bishop:
+        targets = bishopAttacks(from, occupied);
+        break;
+      case Rook:
+        targets = rookAttacks(from, occupied);
+        break;
+      case Queen:
+        targets = bishopAttacks(from, occupied) | rookAttacks(from, occupied);
+        break;
+      default:
+        targets = TABLES.king[from];
+        break;
+      }
+      for (targets &= ~own; targets; targets &= targets - 1) {
+        add(from, lowest(targets), codes[type], 0);
+      }
+    }
+  }
+
+  // castling, the king may not start on, pass or end on an attacked square
+  const int base = this->white ? 0 : 56;
+  const uint8_t kingside = this->white ? WhiteKingside : BlackKingside;
+  const uint8_t queenside = this->white ? WhiteQueenside : BlackQueenside;
+  if ((fromMask & bit(base + 4)) && (this->castling & (kingside | queenside)) &&
+      (this->position.pieces[codes[King] - 1] & bit(base + 4)) && !this->attacked(base + 4, !this->white)) {
+    uint64_t rooks = this->position.pieces[codes[Rook] - 1];
+    if ((this->castling & kingside) && (rooks & bit(base + 7)) &&
+        !(occupied & (bit(base + 5) | bit(base + 6))) && !this->attacked(base + 5, !this->white) &&
+        !this->attacked(base + 6, !this->white)) {
+      add(base + 4, base + 6, codes[King], ChessMove::Castle);
+    }
+    if ((this->castling & queenside) && (rooks & bit(base)) &&
+        !(occupied & (bit(base + 1) | bit(base + 2) | bit(base + 3))) && !this->attacked(base + 3, !this->white) &&
+        !this->attacked(base + 2, !this->white)) {
+      add(base + 4, base + 2, codes[King], ChessMove::Castle);
+    }
+  }
+  return n;
+}
+
+ChessMoveTracker ChessMoveTracker::after(const ChessMove &move) const {
+  ChessMoveTracker next = *this;
+  auto &pieces = next.position.pieces;
+  pieces[move.piece - 1] ^= bit(move.from) | bit(move.to);
+  if (move.flags & ChessMove::EnPassant) {
+    pieces[move.captured - 1] ^= bit(this->white ? move.to - 8 : move.to + 8);
+  } else if (move.captured != Piece::Empty) {
+    pieces[move.captured - 1] ^= bit(move.to);
+  }
+  if (move.promotion != Piece::Empty) {
+    pieces[move.piece - 1] ^= bit(move.to);
+    pieces[move.promotion - 1] ^= bit(move.to);
+  }
+  if (move.flags & ChessMove::Castle) {
+    uint8_t rook = PIECE_CODES[this->white ? 0 : 1][Rook];
+    if (move.to > move.from) {
+      pieces[rook - 1] ^= bit(move.to + 1) | bit(move.to - 1);
+    } else {
+      pieces[rook - 1] ^= bit(move.to - 2) | bit(move.to + 1);
+    }
+  }
+  uint64_t occupied = 0;
+  for (size_t i = 0; i < 12; i++) {
+    occupied |= pieces[i];
+  }
+  next.position.occupied = occupied;
+
+  next.castling &= ~(castlingLost(move.from) | castlingLost(move.to));
+  next.enPassant = (move.flags & ChessMove::DoublePush) ? (move.from + move.to) / 2 : -1;
+  bool pawn = move.piece == Piece::WhitePawn || move.piece == Piece::BlackPawn;
+  next.halfmoves = (pawn || move.captured != Piece::Empty) ? 0 : this->halfmoves + 1;
+  next.fullmoves = this->white ? this->fullmoves : this->fullmoves + 1;
+  next.white = !this->white;
+  return next;
+}
+
+bool ChessMoveTracker::legal(void) const {
+  // the side that just moved is the one not to move
+  uint64_t king = this->position.pieces[PIECE_CODES[this->white ? 1 : 0][King] - 1];
+  // positions set up without a king cannot be in check
+  return !king || !this->attacked(lowest(king), this->white);
+}
+
+bool ChessMoveTracker::update(const BoardState &board, ChessMove *move) {
+  uint64_t changed = this->position.diff(board);
+  if (changed == 0) {
+    return false;
+  }
+
+  if (board == INITIAL_POSITION) {
+    this->reset();
+    return false;
+  }
+
+  // the moving piece leaves a changed square of the side to move and lands
+  // on another changed square
+  ChessMove moves[LEGAL_MOVES_MAX];
+  auto n = this->generate(changed & this->position.occupied, moves);
+  for (size_t i = 0; i < n; i++) {
+    if (!(changed & bit(moves[i].to))) {
+      continue;
+    }
+    auto next = this->after(moves[i]);
+    if (next.position == board && next.legal()) {
+      *this = next;
+      if (move) {
+        *move = moves[i];
+      }
+      return true;
+    }
+  }
+  return false;
+}
+
+size_t ChessMoveTracker::legalMoves(ChessMove *moves) const {
+  ChessMove pseudo[LEGAL_MOVES_MAX];
+  auto n = this->generate(~0ull, pseudo);
+  size_t count = 0;
+  for (size_t i = 0; i < n; i++) {
+    if (this->after(pseudo[i]).legal()) {
+      moves[count++] = pseudo[i];
+    }
+  }
+  return count;
+}
+
+const BoardState &ChessMoveTracker::board(void) const { return this->position; }
+
+bool ChessMoveTracker::whiteToMove(void) const { return this->white; }
+
+uint8_t ChessMoveTracker::castlingRights(void) const { return this->castling; }
+
+std::string ChessMoveTracker::fen(void) const {
+  static const char PIECE_LETTERS[] = "0qkbpnRPrBNQK";
+  std::string text;
+  for (int rank = 7; rank >= 0; rank--) {
+    int empty = 0;
+    for (int file = 0; file < 8; file++) {
+      auto piece = this->position.pieceAt(rank * 8 + file);
+      if (piece == Piece::Empty) {
+        empty++;
+        continue;
+      }
+      if (empty > 0) {
+        text += static_cast<char>('0' + empty);
+        empty = 0;
+      }
+      text += PIECE_LETTERS[piece];
+    }
+    if (empty > 0) {
+      text += static_cast<char>('0' + empty);
+    }
+    if (rank > 0) {
+      text += '/';
+    }
+  }
+
+  text += this->white ? " w " : " b ";
+  if (this->castling == 0) {
+    text += '-';
+  } else {
+    text += (this->castling & WhiteKingside) ? "K" : "";
+    text += (this->castling & WhiteQueenside) ? "Q" : "";
+    text += (this->castling & BlackKingside) ? "k" : "";
+    text += (this->castling & BlackQueenside) ? "q" : "";
+  }
+  text += ' ';
+  text += this->enPassant >= 0 ? squareName(this->enPassant) : "-";
+  text += ' ' + std::to_string(this->halfmoves) + ' ' + std::to_string(this->fullmoves);
+  return text;
+}
+
+std::vector<ChessMove> ChessMoveTracker::replay(const std::vector<std::string> &file) {
+  std::vector<ChessMove> moves;
+  ChessMoveTracker tracker;
+  bool first = true;
+  for (auto &fen : file) {
+    BoardState board;
+    if (!BoardState::fromFen(fen.c_str(), board)) {
+      continue;
+    }
+    ChessMove move;
+    if (tracker.update(board, &move)) {
+      moves.push_back(move);
+    } else if (first && board != tracker.board()) {
+      // the recording does not start at the initial position
+      tracker.reset(board, true);
+    }
+    first = false;
+  }
+  return moves;
+}
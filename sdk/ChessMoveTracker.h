@@ -0,0 +1,151 @@
+#ifndef CHESS_MOVE_TRACKER_HEADER_GUARD
+#define CHESS_MOVE_TRACKER_HEADER_GUARD
+
+#include "ChessBoard.h"
+#include <string>
+#include <vector>
+
+/**
+A legal move, as inferred by a ChessMoveTracker
+*/
+struct ChessMove {
+  enum Flags : uint8_t {
+    Capture = 1,
+    DoublePush = 2,
+    EnPassant = 4,
+    Castle = 8,
+    Promotion = 16,
+  };
+
+  // squares, 0 is a1, 7 is h1 and 63 is h8; the king's squares for castling
+  uint8_t from;
+  uint8_t to;
+
+  // piece codes of the board protocol, see BoardState::Piece
+  uint8_t piece;
+
+  // captured piece, BoardState::Empty if none
+  uint8_t captured;
+
+  // piece the pawn was promoted to, BoardState::Empty if none
+  uint8_t promotion;
+
+  // combination of Flags
+  uint8_t flags;
+
+  /**
+  returns the move in long algebraic notation as used by UCI, e.g. e2e4,
+  e1g1 or e7e8q
+  */
+  std::string uci() const;
+};
+
+// most pseudo-legal moves of a position
+constexpr size_t LEGAL_MOVES_MAX = 256;
+
+/**
+Turns a sequence of board positions into legal moves.
+
+The tracker keeps the game state the board cannot report: side to move,
+castling rights, en passant square and move counters. For each new position
+it generates the moves of the side to move from the squares that changed,
+with bitboard attack tables, and accepts the one legal move whose result
+matches the position exactly. Positions no single legal move leads to, e.g.
+while a piece is lifted or slides across the board, are ignored until the
+board settles. A position equal to the initial setup starts a new game.
+*/
+class ChessMoveTracker {
+public:
+  enum Castling : uint8_t {
+    WhiteKingside = 1,
+    WhiteQueenside = 2,
+    BlackKingside = 4,
+    BlackQueenside = 8,
+  };
+
+private:
+  BoardState position;
+
+  bool white;
+
+  // combination of Castling
+  uint8_t castling;
+
+  // square a pawn can capture en passant on, -1 if none
+  int enPassant;
+
+  unsigned halfmoves;
+  unsigned fullmoves;
+
+  // pseudo-legal moves of the side to move from the squares in fromMask
+  size_t generate(uint64_t fromMask, ChessMove *moves) const;
+
+  // the game after a pseudo-legal move
+  ChessMoveTracker after(const ChessMove &move) const;
+
+  // false if the side that just moved left its king in check
+  bool legal(void) const;
+
+  // true if square is attacked by the given side
+  bool attacked(int square, bool byWhite) const;
+
+public:
+  /**
+  start tracking from the initial position, white to move
+  */
+  ChessMoveTracker();
+
+  /**
+  start a new game from the initial position
+  */
+  void reset(void);
+
+  /**
+  continue from an arbitrary position, castling rights are derived from the
+  kings and rooks on their initial squares
+  */
+  void reset(const BoardState &board, bool whiteToMove);
+
+  /**
+  feed the next position of the board
+  Returns true if a legal move leads to it, the move is written to move if it
+  is not null
+  */
+  bool update(const BoardState &board, ChessMove *move = nullptr);
+
+  /**
+  write the legal moves of the side to move to moves, which must hold
+  LEGAL_MOVES_MAX entries
+  Returns the number of moves
+  */
+  size_t legalMoves(ChessMove *moves) const;
+
+  /**
+  returns the current position
+  */
+  const BoardState &board(void) const;
+
+  /**
+  returns true if white is to move
+  */
+  bool whiteToMove(void) const;
+
+  /**
+  returns the castling rights, a combination of Castling
+  */
+  uint8_t castlingRights(void) const;
+
+  /**
+  returns the full FEN of the current position
+  */
+  std::string fen(void) const;
+
+  /**
+  infer the moves of a file returned by ChessLink::getFile
+  the first position is taken as the start of the game, white to move
+  Returns the moves in order
+  */
+  static std::vector<ChessMove> replay(const std::vector<std::string> &file);
+};
+
+#endif // CHESS_MOVE_TRACKER_HEADER_GUARD
@@ -0,0 +1,180 @@
+#include "ChessReactor.h"
+#include <chrono>
+#include <cstdint>
+
+#ifdef __linux__
+#include <cerrno>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+#ifdef __linux__
+// epoll tokens of the eventfd and of the watched descriptor
+constexpr uint64_t WAKE_TOKEN = ~0ull;
+constexpr uint64_t WATCH_TOKEN = ~1ull;
+
+// events returned by one epoll_wait
+constexpr int MAX_EVENTS = 64;
+#endif
+
+ChessReactor::ChessReactor() {
+  this->watchFd = -1;
+  this->wakePending = false;
+#ifdef __linux__
+  this->epollFd = epoll_create1(EPOLL_CLOEXEC);
+  this->wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if (this->epollFd >= 0 && this->wakeFd >= 0) {
+    epoll_event ev = {};
+    ev.events = EPOLLIN;
+    ev.data.u64 = WAKE_TOKEN;
+    if (epoll_ctl(this->epollFd, EPOLL_CTL_ADD, this->wakeFd, &ev) != 0) {
+      close(this->epollFd);
+      this->epollFd = -1;
+    }
+  } else if (this->epollFd >= 0) {
+    close(this->epollFd);
+    this->epollFd = -1;
+  }
+#endif
+}
+
+ChessReactor::~ChessReactor() {
+#ifdef __linux__
+  if (this->epollFd >= 0) {
+    close(this->epollFd);
+  }
+  if (this->wakeFd >= 0) {
+    close(this->wakeFd);
+  }
+#endif
+}
+
+bool ChessReactor::watch(int fd) {
+  if (fd == this->watchFd) {
+    return fd >= 0;
+  }
+#ifdef __linux__
+  if (this->epollFd < 0) {
+    this->watchFd = -1;
+    return false;
+  }
+  if (this->watchFd >= 0) {
+    // the descriptor may already be closed, in which case the kernel has
+    // removed it from the interest list
+    epoll_ctl(this->epollFd, EPOLL_CTL_DEL, this->watchFd, nullptr);
+    this->watchFd = -1;
+  }
+  if (fd < 0) {
+    return false;
+  }
+  epoll_event ev = {};
+  ev.events = EPOLLIN;
+  ev.data.u64 = WATCH_TOKEN;
+  if (epoll_ctl(this->epollFd, EPOLL_CTL_ADD, fd, &ev) != 0) {
+    return false;
+  }
+  this->watchFd = fd;
+  return true;
+#else
+  this->watchFd = -1;
+  return false;
+#endif
+}
+
+int ChessReactor::watched(void) const { return this->watchFd; }
+
+bool ChessReactor::add(int fd, uint64_t token) {
+#ifdef __linux__
+  if (this->epollFd < 0 || fd < 0) {
+    return false;
+  }
+  epoll_event ev = {};
+  ev.events = EPOLLIN;
+  ev.data.u64 = token;
+  return epoll_ctl(this->epollFd, EPOLL_CTL_ADD, fd, &ev) == 0;
+#else
+  (void)fd;
+  (void)token;
+  return false;
+#endif
+}
+
+void ChessReactor::remove(int fd) {
+#ifdef __linux__
+  if (this->epollFd >= 0 && fd >= 0) {
+    epoll_ctl(this->epollFd, EPOLL_CTL_DEL, fd, nullptr);
+  }
+#else
+  (void)fd;
+#endif
+}
+
+unsigned ChessReactor::wait(int timeoutMs) { return this->poll(timeoutMs, nullptr); }
+
+unsigned ChessReactor::wait(int timeoutMs, vector<uint64_t> &ready) {
+  ready.clear();
+  return this->poll(timeoutMs, &ready);
+}
+
+unsigned ChessReactor::poll(int timeoutMs, vector<uint64_t> *ready) {
+  unsigned res = None;
+#ifdef __linux__
+  if (this->epollFd >= 0) {
+    epoll_event events[MAX_EVENTS];
+    int n;
+    do {
+      n = epoll_wait(this->epollFd, events, MAX_EVENTS, timeoutMs);
+    } while (n < 0 && errno == EINTR);
+
+    for (int i = 0; i < n; i++) {
+      auto token = events[i].data.u64;
+      if (token == WAKE_TOKEN) {
+        uint64_t value;
+        while (read(this->wakeFd, &value, sizeof(value)) > 0) {
+        }
+        res |= Woken;
+      } else {
+        // errors and hangups are reported as readable, so that the following
+        // read fails and the device gets disconnected
+        res |= Readable;
+        if (token != WATCH_TOKEN && ready) {
+          ready->push_back(token);
+        }
+      }
+    }
+    return res;
+  }
+#else
+  (void)ready;
+#endif
+  {
+    unique_lock<mutex> lock(this->wakeMutex);
+    if (timeoutMs < 0) {
+      this->wakeCV.wait(lock, [this] { return this->wakePending; });
+    } else {
+      this->wakeCV.wait_for(lock, chrono::milliseconds(timeoutMs), [this] { return this->wakePending; });
+    }
+    if (this->wakePending) {
+      this->wakePending = false;
+      res |= Woken;
+    }
+  }
+  return res;
+}
+
+void ChessReactor::wake(void) {
+#ifdef __linux__
+  if (this->epollFd >= 0) {
+    uint64_t value = 1;
+    auto r = ::write(this->wakeFd, &value, sizeof(value));
+    (void)r;
+    return;
+  }
+#endif
+  lock_guard<mutex> lock(this->wakeMutex);
+  this->wakePending = true;
+  this->wakeCV.notify_all();
+}
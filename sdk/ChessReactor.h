@@ -0,0 +1,102 @@
+#ifndef CHESS_REACTOR_HEADER_GUARD
+#define CHESS_REACTOR_HEADER_GUARD
+
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+/**
+Event loop for the read thread of a ChessLink.
+
+On Linux the reactor blocks in epoll on the watched device descriptor and on
+an eventfd, so the read thread only wakes up when a report is ready, when
+wake() is called (shutdown, connect, new commands) or when the timeout
+expires. On other platforms, or when no descriptor is watched, it falls back
+to a condition variable that is signalled by wake().
+
+Besides the one watched descriptor, a reactor can wait on any number of
+descriptors added with a token, e.g. the boards of a ChessLinkHub thread.
+*/
+class ChessReactor {
+private:
+#ifdef __linux__
+  // epoll instance
+  int epollFd;
+
+  // eventfd used by wake()
+  int wakeFd;
+#endif
+
+  // currently watched descriptor, -1 if none
+  int watchFd;
+
+  // wait for events, collects the tokens of ready added descriptors if ready
+  // is set
+  unsigned poll(int timeoutMs, std::vector<uint64_t> *ready);
+
+  // fallback wake state
+  std::mutex wakeMutex;
+  std::condition_variable wakeCV;
+  bool wakePending;
+
+public:
+  ChessReactor();
+  ~ChessReactor();
+
+  ChessReactor(const ChessReactor &) = delete;
+  ChessReactor &operator=(const ChessReactor &) = delete;
+
+  // wait() result flags
+  enum Event : unsigned {
+    // wait timed out
+    None = 0,
+    // the watched descriptor is readable
+    Readable = 1,
+    // wake() was called
+    Woken = 2,
+  };
+
+  /**
+  watch a descriptor for readability, -1 stops watching
+  Returns true if the descriptor can be waited on, false otherwise
+  */
+  bool watch(int fd);
+
+  /**
+  returns the watched descriptor, -1 if none
+  */
+  int watched(void) const;
+
+  /**
+  block until the watched descriptor is readable, wake() is called or
+  timeoutMs elapses; a negative timeout waits forever
+  Returns a combination of Event flags
+  */
+  unsigned wait(int timeoutMs);
+
+  /**
+  watch a descriptor for readability in addition to the watched one, its
+  events are reported with token, which must not be ~0 or ~1
+  Returns true if the descriptor can be waited on, false otherwise
+  */
+  bool add(int fd, uint64_t token);
+
+  /**
+  stop watching a descriptor added with add
+  */
+  void remove(int fd);
+
+  /**
+  same as wait, ready receives the tokens of the added descriptors that are
+  readable, Readable is set if any descriptor is
+  */
+  unsigned wait(int timeoutMs, std::vector<uint64_t> &ready);
+
+  /**
+  wake up a thread blocked in wait(), safe to call from any thread
+  */
+  void wake(void);
+};
+
+#endif // CHESS_REACTOR_HEADER_GUARD
@@ -0,0 +1,528 @@
+#include "ChessUring.h"
+
+#ifdef CHESS_IO_URING
+
+#include <algorithm>
+#include <cerrno>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+// how long a write may take before it is cancelled, millisecond, the same
+// bound ChessHidrawConnect waits for a node to accept a report
+constexpr int URING_WRITE_TIMEOUT = 1000;
+
+// the kind of operation is kept in the low bits of its user data, the rest
+// is the channel it belongs to, if any
+enum : uint64_t {
+  OP_IGNORE = 0,
+  OP_POLL_IN = 1,
+  OP_POLL_OUT = 2,
+  OP_WRITE = 3,
+  OP_TIMEOUT = 4,
+  OP_WAKE = 5,
+  OP_HOTPLUG = 6,
+  OP_MASK = 7,
+};
+
+// steady clock time in microseconds, the clock ChessLink timestamps with
+static uint64_t steadyMicros(chrono::steady_clock::time_point time) {
+  return chrono::duration_cast<chrono::microseconds>(time.time_since_epoch()).count();
+}
+
+struct ChessUringLoop::Link {
+  // the device is only used while the ChessLink is locked, which owns it
+  weak_ptr<ChessLink> chesslink;
+  ChessUringConnect *device;
+
+  // open node, nullptr if not connected
+  Channel *channel;
+
+  // set by any thread when commands were queued
+  atomic_bool queued;
+
+  // when the head of the queue may be sent, and when ChessLink::service
+  // wants to run again, steady microseconds
+  chrono::steady_clock::time_point writeDue;
+  uint64_t serviceAt;
+
+  Link() {
+    this->device = nullptr;
+    this->channel = nullptr;
+    this->queued = false;
+    this->writeDue = chrono::steady_clock::time_point::max();
+    this->serviceAt = 0;
+  }
+};
+
+struct ChessUringLoop::Channel {
+  shared_ptr<Link> link;
+
+  int fd;
+
+  // operations in the ring, a multishot poll counts until its last completion
+  unsigned inFlight;
+
+  // set once the link stopped using the node
+  bool released;
+
+  // the command being written, and whether it already waited for POLLOUT
+  bool writing;
+  bool retried;
+  ChessCommand command;
+  __kernel_timespec writeTimeout;
+};
+
+static uint64_t tag(void *channel, uint64_t op) { return reinterpret_cast<uint64_t>(channel) | op; }
+
+ChessUringLoop::ChessUringLoop() {
+  this->ready = false;
+  this->stopping = false;
+  this->wakeFd = -1;
+  this->wakeValue = 0;
+  this->waitCount = 0;
+  this->completionCount = 0;
+  this->reportCount = 0;
+  this->writeCount = 0;
+}
+
+ChessUringLoop::~ChessUringLoop() {
+  this->stopping = true;
+  if (this->loopThread.joinable()) {
+    if (this->loopThread.get_id() == this_thread::get_id()) {
+      // the loop thread released the last reference, it stops right after
+      this->loopThread.detach();
+    } else {
+      this->wake();
+      this->loopThread.join();
+    }
+  }
+  // tearing down the ring cancels what is still in flight
+  if (this->ready) {
+    io_uring_queue_exit(&this->ring);
+  }
+  for (auto channel : this->channels) {
+    if (channel->writing) {
+      ChessUringConnect::completeWrite(channel->command, -1);
+    }
+    close(channel->fd);
+    delete channel;
+  }
+  if (this->wakeFd >= 0) {
+    close(this->wakeFd);
+  }
+}
+
+shared_ptr<ChessUringLoop> ChessUringLoop::create(unsigned entries) {
+  shared_ptr<ChessUringLoop> loop(new ChessUringLoop());
+  if (io_uring_queue_init(entries, &loop->ring, 0) < 0) {
+    return nullptr;
+  }
+  loop->ready = true;
+  loop->wakeFd = eventfd(0, EFD_CLOEXEC);
+  if (loop->wakeFd < 0) {
+    return nullptr;
+  }
+  loop->armWake();
+  if (loop->hotplug.open()) {
+    loop->armHotplug();
+  }
+
+  // the thread only holds the loop while it runs an iteration, the loop goes
+  // away with the last ChessLink and handle of the application
+  weak_ptr<ChessUringLoop> weak = loop;
+  loop->loopThread = thread([weak] {
+    for (;;) {
+      auto self = weak.lock();
+      if (!self || self->stopping) {
+        return;
+      }
+      self->iterate();
+    }
+  });
+  return loop;
+}
+
+ChessUringStats ChessUringLoop::getStats(void) {
+  return {this->waitCount, this->completionCount, this->reportCount, this->writeCount};
+}
+
+void ChessUringLoop::post(function<void(void)> task) {
+  {
+    lock_guard<mutex> lock(this->taskMutex);
+    this->tasks.push_back(move(task));
+  }
+  this->wake();
+}
+
+void ChessUringLoop::wake(void) {
+  if (this_thread::get_id() != this->loopThread.get_id()) {
+    eventfd_write(this->wakeFd, 1);
+  }
+}
+
+void ChessUringLoop::reserve(unsigned n) {
+  if (io_uring_sq_space_left(&this->ring) < n) {
+    io_uring_submit(&this->ring);
+  }
+}
+
+void ChessUringLoop::armWake(void) {
+  this->reserve(1);
+  auto sqe = io_uring_get_sqe(&this->ring);
+  io_uring_prep_read(sqe, this->wakeFd, &this->wakeValue, sizeof(this->wakeValue), 0);
+  io_uring_sqe_set_data64(sqe, OP_WAKE);
+}
+
+void ChessUringLoop::armHotplug(void) {
+  this->reserve(1);
+  auto sqe = io_uring_get_sqe(&this->ring);
+  io_uring_prep_poll_add(sqe, this->hotplug.descriptor(), POLLIN);
+  io_uring_sqe_set_data64(sqe, OP_HOTPLUG);
+}
+
+void ChessUringLoop::armPoll(Channel *channel) {
+  this->reserve(1);
+  auto sqe = io_uring_get_sqe(&this->ring);
+  io_uring_prep_poll_multishot(sqe, channel->fd, POLLIN);
+  io_uring_sqe_set_data64(sqe, tag(channel, OP_POLL_IN));
+  channel->inFlight++;
+}
+
+void ChessUringLoop::submitWrite(Channel *channel, bool retry) {
+  this->reserve(3);
+  if (retry) {
+    auto sqe = io_uring_get_sqe(&this->ring);
+    io_uring_prep_poll_add(sqe, channel->fd, POLLOUT);
+    io_uring_sqe_set_flags(sqe, IOSQE_IO_LINK);
+    io_uring_sqe_set_data64(sqe, tag(channel, OP_POLL_OUT));
+    channel->inFlight++;
+  }
+  // hidraw writes block until the device took the report, run them on a
+  // kernel worker right away instead of trying inline first
+  auto sqe = io_uring_get_sqe(&this->ring);
+  auto &data = channel->command.data;
+  io_uring_prep_write(sqe, channel->fd, data.data(), static_cast<unsigned>(data.size()), 0);
+  io_uring_sqe_set_flags(sqe, IOSQE_IO_LINK | IOSQE_ASYNC);
+  io_uring_sqe_set_data64(sqe, tag(channel, OP_WRITE));
+
+  channel->writeTimeout.tv_sec = URING_WRITE_TIMEOUT / 1000;
+  channel->writeTimeout.tv_nsec = (URING_WRITE_TIMEOUT % 1000) * 1000000LL;
+  sqe = io_uring_get_sqe(&this->ring);
+  io_uring_prep_link_timeout(sqe, &channel->writeTimeout, 0);
+  io_uring_sqe_set_data64(sqe, tag(channel, OP_TIMEOUT));
+  channel->inFlight += 2;
+}
+
+void ChessUringLoop::flush(Link &link, chrono::steady_clock::time_point now) {
+  link.writeDue = chrono::steady_clock::time_point::max();
+  auto channel = link.channel;
+  if (channel ? channel->writing : link.device->connectStatus.load()) {
+    // the write in flight or the attach of the node sets queued again
+    return;
+  }
+  ChessCommand cmd;
+  while (link.device->nextWrite(now, cmd, link.writeDue)) {
+    if (!channel) {
+      // like a transport that is not connected
+      ChessUringConnect::completeWrite(cmd, 0);
+      continue;
+    }
+    channel->command = move(cmd);
+    channel->writing = true;
+    channel->retried = false;
+    this->submitWrite(channel, false);
+    return;
+  }
+}
+
+void ChessUringLoop::drain(Channel *channel, int events) {
+  auto chesslink = channel->link->chesslink.lock();
+  if (!chesslink) {
+    return;
+  }
+  unsigned char readBuf[256];
+  while (!channel->released) {
+    auto n = ::read(channel->fd, readBuf, sizeof(readBuf));
+    if (n > 0) {
+      this->reportCount++;
+      chesslink->receive(readBuf, static_cast<int>(n), steadyMicros(chrono::steady_clock::now()));
+      continue;
+    }
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if ((n == 0 || errno == EAGAIN) && !(events & (POLLERR | POLLHUP | POLLNVAL))) {
+      return;
+    }
+    // the board is gone, receive disconnects the device
+    chesslink->receive(readBuf, -1, steadyMicros(chrono::steady_clock::now()));
+    this->release(channel);
+    return;
+  }
+}
+
+void ChessUringLoop::attach(shared_ptr<Link> link, int fd) {
+  this->post([this, link, fd] {
+    if (link->channel) {
+      this->release(link->channel);
+    }
+    auto channel = new Channel();
+    channel->link = link;
+    channel->fd = fd;
+    channel->inFlight = 0;
+    channel->released = false;
+    channel->writing = false;
+    channel->retried = false;
+    this->channels.push_back(channel);
+    link->channel = channel;
+    this->armPoll(channel);
+    // commands may have been waiting for the node
+    link->queued = true;
+  });
+}
+
+void ChessUringLoop::detach(shared_ptr<Link> link, int fd) {
+  this->post([this, link, fd] {
+    if (link->channel && link->channel->fd == fd) {
+      this->release(link->channel);
+    }
+  });
+}
+
+void ChessUringLoop::release(Channel *channel) {
+  if (channel->released) {
+    return;
+  }
+  channel->released = true;
+  if (channel->link->channel == channel) {
+    channel->link->channel = nullptr;
+  }
+  if (channel->inFlight == 0) {
+    this->destroy(channel);
+    return;
+  }
+  // the node is closed once the cancelled operations completed, so that its
+  // descriptor number cannot be reused while the ring still refers to it
+  this->reserve(3);
+  for (auto op : {OP_POLL_IN, OP_POLL_OUT, OP_WRITE}) {
+    auto sqe = io_uring_get_sqe(&this->ring);
+    io_uring_prep_cancel64(sqe, tag(channel, op), 0);
+    io_uring_sqe_set_data64(sqe, OP_IGNORE);
+  }
+}
+
+void ChessUringLoop::destroy(Channel *channel) {
+  close(channel->fd);
+  this->channels.erase(find(this->channels.begin(), this->channels.end(), channel));
+  delete channel;
+}
+
+void ChessUringLoop::complete(uint64_t data, int res, unsigned flags) {
+  auto op = data & OP_MASK;
+  auto channel = reinterpret_cast<Channel *>(data & ~static_cast<uint64_t>(OP_MASK));
+  switch (op) {
+  case OP_WAKE:
+    this->armWake();
+    return;
+  case OP_HOTPLUG:
+    if (this->hotplug.added(ChessHidConnect::isBoard)) {
+      auto now = steadyMicros(chrono::steady_clock::now());
+      for (auto &link : this->links) {
+        if (auto chesslink = link->chesslink.lock()) {
+          chesslink->plugged(now);
+          link->serviceAt = 0;
+        }
+      }
+    }
+    this->armHotplug();
+    return;
+  case OP_IGNORE:
+    return;
+  }
+
+  bool more = flags & IORING_CQE_F_MORE;
+  if (!more) {
+    channel->inFlight--;
+  }
+  switch (op) {
+  case OP_POLL_IN:
+    if (channel->released) {
+      break;
+    }
+    if (res >= 0) {
+      this->drain(channel, res);
+    } else if (res != -ECANCELED) {
+      this->drain(channel, POLLERR);
+    }
+    // a multishot poll ends e.g. when the completion queue overflowed, or
+    // right away where the kernel does not support it
+    if (!more && !channel->released) {
+      this->armPoll(channel);
+    }
+    break;
+  case OP_WRITE:
+    if (res == -EAGAIN && !channel->retried && !channel->released) {
+      channel->retried = true;
+      this->submitWrite(channel, true);
+      break;
+    }
+    channel->writing = false;
+    this->writeCount++;
+    // cancelled by its timeout or by a disconnect
+    ChessUringConnect::completeWrite(channel->command, res >= 0 ? res : -1);
+    channel->link->queued = true;
+    break;
+  }
+
+  if (channel->released && channel->inFlight == 0) {
+    this->destroy(channel);
+  }
+}
+
+void ChessUringLoop::iterate(void) {
+  vector<function<void(void)>> pending;
+  {
+    lock_guard<mutex> lock(this->taskMutex);
+    pending.swap(this->tasks);
+  }
+  for (auto &task : pending) {
+    task();
+  }
+
+  auto now = chrono::steady_clock::now();
+  auto micros = steadyMicros(now);
+  bool monitored = this->hotplug.descriptor() >= 0;
+  auto deadline = chrono::steady_clock::time_point::max();
+  for (size_t i = 0; i < this->links.size();) {
+    auto link = this->links[i];
+    auto chesslink = link->chesslink.lock();
+    if (!chesslink) {
+      if (link->channel) {
+        this->release(link->channel);
+      }
+      this->links[i] = this->links.back();
+      this->links.pop_back();
+      continue;
+    }
+
+    // debounce and reconnect timers
+    if (micros >= link->serviceAt) {
+      link->serviceAt = micros + static_cast<uint64_t>(chesslink->service(micros, monitored)) * 1000;
+    }
+    if (link->queued.exchange(false) || now >= link->writeDue) {
+      this->flush(*link, now);
+    }
+    deadline = min(deadline, link->writeDue);
+    deadline = min(deadline, chrono::steady_clock::time_point(chrono::microseconds(link->serviceAt)));
+    i++;
+  }
+
+  // everything armed above goes to the kernel with the wait
+  io_uring_cqe *cqe;
+  __kernel_timespec ts;
+  __kernel_timespec *timeout = nullptr;
+  if (deadline != chrono::steady_clock::time_point::max()) {
+    auto wait = chrono::duration_cast<chrono::nanoseconds>(max(deadline - now, chrono::steady_clock::duration::zero()));
+    ts.tv_sec = wait.count() / 1000000000;
+    ts.tv_nsec = wait.count() % 1000000000;
+    timeout = &ts;
+  }
+  this->waitCount++;
+  io_uring_submit_and_wait_timeout(&this->ring, &cqe, 1, timeout, nullptr);
+
+  unsigned head;
+  unsigned count = 0;
+  io_uring_for_each_cqe(&this->ring, head, cqe) {
+    count++;
+    this->complete(io_uring_cqe_get_data64(cqe), cqe->res, cqe->flags);
+  }
+  io_uring_cq_advance(&this->ring, count);
+  this->completionCount += count;
+}
+
+ChessUringConnect::ChessUringConnect(shared_ptr<ChessUringLoop> loop, string path) {
+  this->connectStatus = false;
+  this->loop = loop;
+  this->link = make_shared<ChessUringLoop::Link>();
+  this->link->device = this;
+  this->path = path;
+  this->fd = -1;
+}
+
+ChessUringConnect::~ChessUringConnect() {
+  this->stopWriter();
+  if (this->connectStatus) {
+    this->disconnect();
+  }
+}
+
+void ChessUringConnect::b_queued(void) {
+  this->link->queued = true;
+  this->loop->wake();
+}
+
+void ChessUringConnect::b_wake(void) {
+  auto link = this->link;
+  this->loop->post([link] { link->serviceAt = 0; });
+}
+
+bool ChessUringConnect::b_connect(void) {
+  if (this->connectStatus) {
+    return true;
+  }
+
+  auto path = this->path;
+  if (path.empty()) {
+    auto find_hid_vec = ChessHidrawConnect::listDevice();
+    if (find_hid_vec.empty()) {
+      return false;
+    }
+    path = find_hid_vec[0];
+  }
+
+  this->fd = open(path.c_str(), O_RDWR | O_NONBLOCK | O_CLOEXEC);
+  if (this->fd < 0) {
+    return false;
+  }
+  this->loop->attach(this->link, this->fd);
+  this->connectStatus = true;
+  return true;
+}
+
+void ChessUringConnect::b_disconnect() {
+  // the loop closes the node once nothing is in flight on it
+  if (this->fd >= 0) {
+    this->loop->detach(this->link, this->fd);
+  }
+  this->connectStatus = false;
+  this->fd = -1;
+}
+
+int ChessUringConnect::b_read(unsigned char *data, size_t length) {
+  (void)data;
+  (void)length;
+  return 0;
+}
+
+int ChessUringConnect::b_write(const unsigned char *data, size_t length) {
+  (void)data;
+  (void)length;
+  return 0;
+}
+
+shared_ptr<ChessLink> ChessLink::fromUringLoop(shared_ptr<ChessUringLoop> loop, string path) {
+  if (!loop) {
+    return nullptr;
+  }
+  auto device = new ChessUringConnect(loop, path);
+  auto link = device->link;
+  shared_ptr<ChessLink> r(new ChessLink(device));
+  link->chesslink = r;
+  auto driver = loop.get();
+  loop->post([driver, link] { driver->links.push_back(link); });
+  return r;
+}
+
+#endif // CHESS_IO_URING
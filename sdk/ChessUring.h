@@ -0,0 +1,190 @@
+#ifndef CHESS_URING_HEADER_GUARD
+#define CHESS_URING_HEADER_GUARD
+
+#ifdef CHESS_IO_URING
+
+#include "EasyLink.h"
+#include <liburing.h>
+
+// counters of a ChessUringLoop
+struct ChessUringStats {
+  // times the loop entered the kernel to submit and wait
+  uint64_t waits;
+
+  // completions handled
+  uint64_t completions;
+
+  // reports read from the boards
+  uint64_t reports;
+
+  // commands written to the boards
+  uint64_t writes;
+};
+
+/**
+Event loop that drives the hidraw nodes of any number of boards from one
+io_uring and one thread, see ChessLink::fromUringLoop.
+
+hidraw cannot read without blocking, an io_uring read of a node would be
+handed to a kernel worker thread, so every connected board keeps a multishot
+poll for POLLIN outstanding in the ring instead and the loop reads the
+reports that are ready itself. Writes to hidraw block for the USB transfer,
+they are submitted to the ring to run asynchronously, each linked to a
+timeout of one second. The commands the boards' ChessLinks post are
+taken from their queues as their pacing allows, one in flight per board, and
+all writes that are due go to the kernel in one submission. The loop sleeps
+in the ring until a completion, the next pacing or debounce deadline, or a
+wake-up by another thread, and watches the hotplug monitor from the ring as
+well to reconnect absent boards.
+*/
+class ChessUringLoop {
+private:
+  ChessUringLoop();
+
+  // per board state, owned by the loop thread unless noted
+  struct Link;
+
+  // an open node and the operations in flight on it
+  struct Channel;
+
+  io_uring ring;
+
+  // false if the ring could not be set up
+  bool ready;
+
+  thread loopThread;
+
+  atomic_bool stopping;
+
+  // eventfd that wakes the loop, read from the ring into wakeValue
+  int wakeFd;
+  uint64_t wakeValue;
+
+  // tells the loop when a board may have been plugged in
+  ChessHotplug hotplug;
+
+  // work handed to the loop thread by other threads
+  mutex taskMutex;
+  vector<function<void(void)>> tasks;
+
+  // links driven by the loop
+  vector<shared_ptr<Link>> links;
+
+  // open nodes, including released ones with operations in flight
+  vector<Channel *> channels;
+
+  // counters, written by the loop thread
+  atomic<uint64_t> waitCount;
+  atomic<uint64_t> completionCount;
+  atomic<uint64_t> reportCount;
+  atomic<uint64_t> writeCount;
+
+  // run a task on the loop thread
+  void post(function<void(void)> task);
+
+  // wake the loop from another thread
+  void wake(void);
+
+  // make room for n submission entries, which are then linked in one
+  // submission
+  void reserve(unsigned n);
+
+  // arm the poll of a channel
+  void armPoll(Channel *channel);
+
+  // read the reports that are ready on a channel, events is the poll result
+  void drain(Channel *channel, int events);
+
+  // arm the wake-up and hotplug watches
+  void armWake(void);
+  void armHotplug(void);
+
+  // send the next command of a link if one is due at now
+  void flush(Link &link, chrono::steady_clock::time_point now);
+
+  // submit the command of a channel, behind a poll for POLLOUT if retry
+  void submitWrite(Channel *channel, bool retry);
+
+  // stop using a channel, its node is closed once nothing is in flight
+  void release(Channel *channel);
+  void destroy(Channel *channel);
+
+  // handle one completion
+  void complete(uint64_t data, int res, unsigned flags);
+
+  // one iteration of the loop thread
+  void iterate(void);
+
+  // give the loop a link and the node of a connected board
+  void attach(shared_ptr<Link> link, int fd);
+  void detach(shared_ptr<Link> link, int fd);
+
+  friend class ChessUringConnect;
+  friend class ChessLink;
+
+public:
+  ~ChessUringLoop();
+
+  ChessUringLoop(const ChessUringLoop &) = delete;
+  ChessUringLoop &operator=(const ChessUringLoop &) = delete;
+
+  /**
+  set up a ring with room for entries submissions and start the loop thread
+  Returns the loop, nullptr if io_uring is not available
+  */
+  static shared_ptr<ChessUringLoop> create(unsigned entries = 256);
+
+  /**
+  returns the counters of the loop
+  */
+  ChessUringStats getStats(void);
+};
+
+/**
+Transport of a board driven by a ChessUringLoop. It only opens and hands the
+hidraw node to the loop, which does all reads and writes, so a ChessLink on
+it needs neither a read thread nor a writer thread.
+*/
+class ChessUringConnect : public ChessHardConnect {
+private:
+  friend class ChessUringLoop;
+  friend class ChessLink;
+
+  shared_ptr<ChessUringLoop> loop;
+
+  // the loop's state of this board
+  shared_ptr<ChessUringLoop::Link> link;
+
+  // node to open, empty to search for the board on every connect
+  string path;
+
+  // node handed to the loop, -1 if not connected
+  int fd;
+
+protected:
+  // overload, wakes the loop
+  void b_queued(void);
+
+public:
+  ChessUringConnect(shared_ptr<ChessUringLoop> loop, string path = "");
+  ~ChessUringConnect();
+
+  // overload
+  bool b_connect(void);
+
+  // overload
+  void b_disconnect(void);
+
+  // overload, the loop delivers the reports, always 0
+  int b_read(unsigned char *data, size_t length);
+
+  // overload, writes are sent by the loop, always 0
+  int b_write(const unsigned char *data, size_t length);
+
+  // overload, wakes the loop, which runs ChessLink::service right away
+  void b_wake(void);
+};
+
+#endif // CHESS_IO_URING
+
+#endif // CHESS_URING_HEADER_GUARD
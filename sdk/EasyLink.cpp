@@ -1,65 +1,300 @@
 #include "EasyLink.h"
 
+#ifdef __linux__
+#include <algorithm>
+#include <cerrno>
+#include <dirent.h>
+#include <fcntl.h>
+#include <fstream>
+#include <poll.h>
+#include <unistd.h>
+#endif
+
 // device pid, vid , usage_page
 constexpr unsigned short DEVICE_VID = 0x2d80;
 const array<unsigned short, 7> DEVICE_PIDS = {0x8000, 0x8100, 0x8200, 0x8300,
                                               0x8400, 0x8500, 0x8600};
 constexpr unsigned short DEVICE_USAGE_PAGE = 0xFF00;
 
-// hid write time interval,millisecond
+// default hid write time interval, millisecond
 constexpr unsigned int WRITE_INTERVAL = 200;
 
-// default chess data
-constexpr unsigned char CHESS_PIECES[] = {
-    '0', 'q', 'k', 'b', 'p', 'n', 'R', 'P', 'r', 'B', 'N', 'Q', 'K',
-};
+// maximum number of commands waiting for the writer thread
+constexpr size_t WRITE_QUEUE_CAPACITY = 64;
+
+// led command, only the newest pending led frame is worth sending
+constexpr unsigned char LED_OPCODE = 0x0a;
+
+// query commands and the opcodes of their responses; the original SDK took
+// any report that was neither a position nor a battery level as the answer,
+// so the version and file count response opcodes are not confirmed and their
+// queries accept any report no other query waits for, see ChessRequests
+constexpr unsigned char VERSION_OPCODE = 0x27;
+constexpr unsigned char VERSION_RESPONSE = 0x28;
+constexpr unsigned char BATTERY_OPCODE = 0x29;
+constexpr unsigned char BATTERY_RESPONSE = 0x2A;
+constexpr unsigned char FILE_COUNT_OPCODE = 0x31;
+constexpr unsigned char FILE_COUNT_RESPONSE = 0x32;
+
+// how long the blocking queries wait for an answer once the command is sent,
+// millisecond
+constexpr unsigned int RESPONSE_TIMEOUT = 1000;
+
+// hid read timeout for transports that cannot be polled, millisecond
+constexpr int HID_READ_TIMEOUT = 100;
+
+// how long the read thread blocks without events before it rechecks whether
+// the ChessLink is still referenced, millisecond
+constexpr int READ_IDLE_INTERVAL = 500;
+
+// reconnect retry interval while the board is absent, millisecond
+constexpr int RECONNECT_INTERVAL = 10;
+
+// steady clock time in microseconds, the timestamp of realtime positions
+static uint64_t steadyMicros() {
+  return chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+ChessPacing::ChessPacing(unsigned int interval, unsigned int burst) {
+  this->interval = interval;
+  this->burst = burst > 0 ? burst : 1;
+  this->tokens = this->burst;
+  this->refillTime = chrono::steady_clock::now();
+}
+
+chrono::steady_clock::time_point ChessPacing::take(chrono::steady_clock::time_point now) {
+  if (this->interval == 0) {
+    return now;
+  }
+  auto interval = chrono::duration<double, milli>(this->interval);
+  this->tokens = min<double>(this->burst, this->tokens + (now - this->refillTime) / interval);
+  this->refillTime = now;
+  if (this->tokens >= 1) {
+    this->tokens -= 1;
+    return now;
+  }
+  return now + chrono::ceil<chrono::steady_clock::duration>((1 - this->tokens) * interval);
+}
 
-ChessHardConnect::ChessHardConnect() { this->connectStatus = false; }
+ChessHardConnect::ChessHardConnect() {
+  this->connectStatus = false;
+  this->connectCount = 0;
+  this->writeStop = false;
+  this->coalescedCount = 0;
+  this->defaultPacing = ChessPacing(WRITE_INTERVAL, 1);
+}
 
-ChessHardConnect::~ChessHardConnect() {}
+ChessHardConnect::~ChessHardConnect() { this->stopWriter(); }
 
 bool inline ChessHardConnect::getConnectStatus(void) {
   return this->connectStatus;
 }
 
-int ChessHardConnect::write(const unsigned char *data, size_t length) {
+// resolved handle for commands that never reach the queue
+static WriteHandle rejectedWrite() {
+  promise<int> p;
+  p.set_value(-1);
+  return p.get_future().share();
+}
+
+WriteHandle ChessHardConnect::post(const unsigned char *data, size_t length, WriteCallback callback) {
+  {
+    mutex_lock lock(this->queueMutex);
+    if (!this->writeStop && length > 0) {
+      if (data[0] == LED_OPCODE) {
+        // last writer wins, update the pending frame in place
+        for (auto &cmd : this->queue) {
+          if (cmd.data[0] == LED_OPCODE) {
+            cmd.data.assign(data, data + length);
+            if (callback) {
+              cmd.callbacks.push_back(move(callback));
+            }
+            this->coalescedCount++;
+            return cmd.handle;
+          }
+        }
+      }
+
+      if (this->queue.size() < WRITE_QUEUE_CAPACITY) {
+        this->queue.emplace_back();
+        auto &cmd = this->queue.back();
+        cmd.data.assign(data, data + length);
+        cmd.handle = cmd.done.get_future().share();
+        if (callback) {
+          cmd.callbacks.push_back(move(callback));
+        }
+        this->b_queued();
+        return cmd.handle;
+      }
+    }
+  }
+
+  if (callback) {
+    callback(-1);
+  }
+  return rejectedWrite();
+}
+
+// complete a command and run its callbacks
+static void finish(ChessCommand &cmd, int res) {
+  cmd.done.set_value(res);
+  for (auto &callback : cmd.callbacks) {
+    callback(res);
+  }
+}
+
+void ChessHardConnect::completeWrite(ChessCommand &cmd, int res) { finish(cmd, res); }
+
+void ChessHardConnect::b_queued(void) {
+  if (!this->writeThread.joinable()) {
+    this->writeThread = thread(&ChessHardConnect::writeLoop, this);
+  }
+  this->queueCV.notify_all();
+}
+
+bool ChessHardConnect::popDue(chrono::steady_clock::time_point now, ChessCommand &cmd,
+                              chrono::steady_clock::time_point &due) {
+  if (this->queue.empty()) {
+    due = chrono::steady_clock::time_point::max();
+    return false;
+  }
+  due = this->pacingFor(this->queue.front().data[0]).take(now);
+  if (due > now) {
+    return false;
+  }
+  cmd = move(this->queue.front());
+  this->queue.pop_front();
+  return true;
+}
 
-  lock_guard<mutex> lock(this->writeMutex);
-  lock_guard<mutex> lock1(this->connectMutex);
+bool ChessHardConnect::nextWrite(chrono::steady_clock::time_point now, ChessCommand &cmd,
+                                 chrono::steady_clock::time_point &due) {
+  lock_guard<mutex> lock(this->queueMutex);
+  if (this->writeStop) {
+    due = chrono::steady_clock::time_point::max();
+    return false;
+  }
+  return this->popDue(now, cmd, due);
+}
 
-  auto t = std::chrono::duration_cast<std::chrono::milliseconds>(
-               chrono::steady_clock::now() - this->writeTime)
-               .count();
-  if (t < WRITE_INTERVAL) {
-    this_thread::sleep_for(chrono::milliseconds(WRITE_INTERVAL - t));
+void ChessHardConnect::sendWrite(ChessCommand &cmd) {
+  int res;
+  {
+    shared_lock<shared_mutex> connect_lock(this->connectMutex);
+    res = this->b_write(cmd.data.data(), cmd.data.size());
   }
-  auto res = this->b_write(data, length);
-  this->writeTime = chrono::steady_clock::now();
 
   // write data
   {
 #ifdef _DEBUG_FLAG
-    spdlog::debug("Write Length: {1}, Write Data: {0:n:X:p}",
-                  spdlog::to_hex(vector<unsigned char>(data, data + length)),
-                  res);
+    spdlog::debug("Write Length: {1}, Write Data: {0:n:X:p}", spdlog::to_hex(cmd.data), res);
 #endif
   }
-  return res;
+  finish(cmd, res);
+}
+
+uint64_t ChessHardConnect::getCoalescedWrites(void) { return this->coalescedCount; }
+
+int ChessHardConnect::write(const unsigned char *data, size_t length) {
+  return this->post(data, length).get();
+}
+
+void ChessHardConnect::writeLoop(void) {
+  mutex_lock lock(this->queueMutex);
+  while (true) {
+    this->queueCV.wait(lock, [this] { return this->writeStop || !this->queue.empty(); });
+    if (this->writeStop) {
+      break;
+    }
+
+    // pace writes here, so that neither the caller nor the read path waits;
+    // re-evaluated on every wakeup since posts and setPacing change the head
+    // or its bucket
+    ChessCommand cmd;
+    chrono::steady_clock::time_point due;
+    if (!this->popDue(chrono::steady_clock::now(), cmd, due)) {
+      this->queueCV.wait_until(lock, due);
+      continue;
+    }
+    lock.unlock();
+    this->sendWrite(cmd);
+    lock.lock();
+  }
+
+  // fail whatever is still queued
+  auto dropped = move(this->queue);
+  this->queue.clear();
+  lock.unlock();
+  for (auto &cmd : dropped) {
+    finish(cmd, -1);
+  }
+}
+
+ChessPacing &ChessHardConnect::pacingFor(unsigned char opcode) {
+  return this->hasPacing[opcode] ? this->pacing[opcode] : this->defaultPacing;
+}
+
+void ChessHardConnect::setPacing(unsigned char opcode, unsigned int intervalMs, unsigned int burst) {
+  lock_guard<mutex> lock(this->queueMutex);
+  this->pacing[opcode] = ChessPacing(intervalMs, burst);
+  this->hasPacing[opcode] = true;
+  this->queueCV.notify_all();
+}
+
+void ChessHardConnect::setDefaultPacing(unsigned int intervalMs, unsigned int burst) {
+  lock_guard<mutex> lock(this->queueMutex);
+  this->defaultPacing = ChessPacing(intervalMs, burst);
+  this->queueCV.notify_all();
+}
+
+void ChessHardConnect::clearPacing(unsigned char opcode) {
+  lock_guard<mutex> lock(this->queueMutex);
+  this->hasPacing[opcode] = false;
+  this->queueCV.notify_all();
+}
+
+void ChessHardConnect::stopWriter(void) {
+  {
+    lock_guard<mutex> lock(this->queueMutex);
+    this->writeStop = true;
+    this->queueCV.notify_all();
+  }
+  if (this->writeThread.joinable()) {
+    this->writeThread.join();
+  }
+
+  // commands of transports that write without the thread are still queued
+  deque<ChessCommand> dropped;
+  {
+    lock_guard<mutex> lock(this->queueMutex);
+    dropped.swap(this->queue);
+  }
+  for (auto &cmd : dropped) {
+    finish(cmd, -1);
+  }
 }
 
 int ChessHardConnect::read(unsigned char *data, size_t length) {
-  lock_guard<mutex> lock(this->connectMutex);
+  shared_lock<shared_mutex> lock(this->connectMutex);
   return this->b_read(data, length);
 }
 
+int ChessHardConnect::b_fd(void) { return -1; }
+
+void ChessHardConnect::b_wake(void) {}
+
 bool ChessHardConnect::connect() {
-  lock_guard<mutex> lock(this->connectMutex);
-  return this->b_connect();
+  lock_guard<shared_mutex> lock(this->connectMutex);
+  auto was_connected = this->connectStatus.load();
+  auto res = this->b_connect();
+  if (res && !was_connected) {
+    this->connectCount++;
+  }
+  return res;
 }
 
 void ChessHardConnect::disconnect() {
-  lock_guard<mutex> lock(this->connectMutex);
-  lock_guard<mutex> lock1(this->writeMutex);
+  lock_guard<shared_mutex> lock(this->connectMutex);
   this->b_disconnect();
 }
 
@@ -69,12 +304,15 @@ ChessHidManager::~ChessHidManager() { hid_exit(); }
 unique_ptr<ChessHidManager> ChessHidConnect::HidManager =
     unique_ptr<ChessHidManager>();
 
-ChessHidConnect::ChessHidConnect() {
+ChessHidConnect::ChessHidConnect(string path, string serial) {
   this->connectStatus = false;
   this->handle = nullptr;
+  this->path = path;
+  this->serial = serial;
 }
 
 ChessHidConnect::~ChessHidConnect() {
+  this->stopWriter();
   if (this->connectStatus) {
     this->disconnect();
   }
@@ -83,20 +321,80 @@ ChessHidConnect::~ChessHidConnect() {
   }
 }
 
-vector<string> ChessHidConnect::listDevice(void) {
-  vector<string> res_vec;
-  auto base_list = hid_enumerate(DEVICE_VID, 0);
-  auto l = base_list;
-  while (l != nullptr) {
-    for (auto pid = DEVICE_PIDS.begin(); pid != DEVICE_PIDS.end(); pid++) {
-      if ((l->product_id & 0xFF00) == *pid &&
-          l->usage_page == DEVICE_USAGE_PAGE) {
-        res_vec.push_back(l->path);
-      }
+bool ChessHidConnect::isBoard(uint16_t vendorId, uint16_t productId) {
+  if (vendorId != DEVICE_VID) {
+    return false;
+  }
+  for (auto pid : DEVICE_PIDS) {
+    if ((productId & 0xFF00) == pid) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// UTF-8 of a string reported by hidapi, empty for nullptr
+static string utf8Of(const wchar_t *text) {
+  string res;
+  for (; text && *text; text++) {
+    auto c = static_cast<uint32_t>(*text);
+    if (c < 0x80) {
+      res += static_cast<char>(c);
+    } else if (c < 0x800) {
+      res += static_cast<char>(0xC0 | (c >> 6));
+      res += static_cast<char>(0x80 | (c & 0x3F));
+    } else if (c < 0x10000) {
+      res += static_cast<char>(0xE0 | (c >> 12));
+      res += static_cast<char>(0x80 | ((c >> 6) & 0x3F));
+      res += static_cast<char>(0x80 | (c & 0x3F));
+    } else {
+      res += static_cast<char>(0xF0 | (c >> 18));
+      res += static_cast<char>(0x80 | ((c >> 12) & 0x3F));
+      res += static_cast<char>(0x80 | ((c >> 6) & 0x3F));
+      res += static_cast<char>(0x80 | (c & 0x3F));
+    }
+  }
+  return res;
+}
+
+vector<ChessHidDevice> ChessHidConnect::boards(const vector<ChessHidInfo> &devices) {
+  vector<ChessHidDevice> res_vec;
+  for (auto &device : devices) {
+    if (ChessHidConnect::isBoard(device.vendorId, device.productId) && device.usagePage == DEVICE_USAGE_PAGE) {
+      res_vec.push_back({device.path, device.productId, device.serial, device.interfaceNumber});
+    }
+  }
+  return res_vec;
+}
+
+string ChessHidConnect::select(const vector<ChessHidDevice> &boards, const string &path, const string &serial) {
+  if (!path.empty()) {
+    return path;
+  }
+  for (auto &board : boards) {
+    if (serial.empty() || board.serial == serial) {
+      return board.path;
     }
-    l = l->next;
+  }
+  return "";
+}
+
+vector<ChessHidDevice> ChessHidConnect::enumerate(void) {
+  vector<ChessHidInfo> devices;
+  auto base_list = hid_enumerate(DEVICE_VID, 0);
+  for (auto l = base_list; l != nullptr; l = l->next) {
+    devices.push_back({l->path, l->vendor_id, l->product_id, l->usage_page, utf8Of(l->serial_number),
+                       l->interface_number});
   }
   hid_free_enumeration(base_list);
+  return ChessHidConnect::boards(devices);
+}
+
+vector<string> ChessHidConnect::listDevice(void) {
+  vector<string> res_vec;
+  for (auto &device : ChessHidConnect::enumerate()) {
+    res_vec.push_back(device.path);
+  }
   return res_vec;
 }
 
@@ -106,19 +404,23 @@ bool ChessHidConnect::b_connect(void) {
     return this->getConnectStatus();
   }
 
-  auto find_hid_vec = ChessHidConnect::listDevice();
   if (this->handle && this->connectStatus) {
     return this->connectStatus;
   }
 
-  if (find_hid_vec.size() >= 1) {
-    auto o_handle = hid_open_path(find_hid_vec[0].c_str());
-    this->handle = o_handle ? o_handle : nullptr;
-    this->connectStatus = handle ? true : false;
-    return this->connectStatus;
-  } else {
-    return false;
+  // a path is opened as given, there is no need to enumerate for it
+  auto path = this->path;
+  if (path.empty()) {
+    path = ChessHidConnect::select(ChessHidConnect::enumerate(), "", this->serial);
+    if (path.empty()) {
+      return false;
+    }
   }
+
+  auto o_handle = hid_open_path(path.c_str());
+  this->handle = o_handle ? o_handle : nullptr;
+  this->connectStatus = handle ? true : false;
+  return this->connectStatus;
 }
 
 void ChessHidConnect::b_disconnect() {
@@ -131,7 +433,7 @@ void ChessHidConnect::b_disconnect() {
 
 int ChessHidConnect::b_read(unsigned char *data, size_t length) {
   if (this->connectStatus && this->handle) {
-    return hid_read_timeout(this->handle, data, length, 100);
+    return hid_read_timeout(this->handle, data, length, HID_READ_TIMEOUT);
   }
   return 0;
 }
@@ -147,6 +449,276 @@ int ChessHidConnect::b_write(const unsigned char *data, size_t length) {
   return 0;
 }
 
+#ifdef __linux__
+// hid device attributes of a hidraw node in sysfs
+constexpr char HIDRAW_CLASS[] = "/sys/class/hidraw/";
+
+// how long a hidraw write waits for the device to accept a report,
+// millisecond
+constexpr int HIDRAW_WRITE_TIMEOUT = 1000;
+
+// vendor and product id from the HID_ID=<bus>:<vendor>:<product> line of a
+// hid device's uevent
+static bool readHidId(const string &uevent, uint16_t &vendorId, uint16_t &productId) {
+  ifstream in(uevent);
+  string line;
+  while (getline(in, line)) {
+    unsigned bus, vendor, product;
+    if (sscanf(line.c_str(), "HID_ID=%x:%x:%x", &bus, &vendor, &product) == 3) {
+      vendorId = static_cast<uint16_t>(vendor);
+      productId = static_cast<uint16_t>(product);
+      return true;
+    }
+  }
+  return false;
+}
+
+// first usage page of a report descriptor, as hidapi reports it, -1 if none
+static int readUsagePage(const string &report_descriptor) {
+  ifstream in(report_descriptor, ios::binary);
+  vector<unsigned char> d((istreambuf_iterator<char>(in)), istreambuf_iterator<char>());
+  size_t i = 0;
+  while (i < d.size()) {
+    if (d[i] == 0xFE) {
+      // long item, its data size follows
+      i += 3 + (i + 1 < d.size() ? d[i + 1] : 0);
+      continue;
+    }
+    size_t size = (d[i] & 0x03) == 3 ? 4 : d[i] & 0x03;
+    if ((d[i] & 0xFC) == 0x04 && i + size < d.size()) {
+      int page = 0;
+      for (size_t k = size; k > 0; k--) {
+        page = (page << 8) | d[i + k];
+      }
+      return page;
+    }
+    i += 1 + size;
+  }
+  return -1;
+}
+
+ChessHidrawConnect::ChessHidrawConnect(string path) {
+  this->connectStatus = false;
+  this->path = path;
+  this->fd = -1;
+}
+
+ChessHidrawConnect::~ChessHidrawConnect() {
+  this->stopWriter();
+  if (this->connectStatus) {
+    this->disconnect();
+  }
+}
+
+vector<string> ChessHidrawConnect::listDevice(void) {
+  vector<string> res_vec;
+  auto dir = opendir(HIDRAW_CLASS);
+  if (dir == nullptr) {
+    return res_vec;
+  }
+  while (auto entry = readdir(dir)) {
+    string name = entry->d_name;
+    if (name.compare(0, 6, "hidraw") != 0) {
+      continue;
+    }
+    auto device = HIDRAW_CLASS + name + "/device/";
+    uint16_t vendorId, productId;
+    if (readHidId(device + "uevent", vendorId, productId) && ChessHidConnect::isBoard(vendorId, productId) &&
+        readUsagePage(device + "report_descriptor") == DEVICE_USAGE_PAGE) {
+      res_vec.push_back("/dev/" + name);
+    }
+  }
+  closedir(dir);
+  sort(res_vec.begin(), res_vec.end());
+  return res_vec;
+}
+
+bool ChessHidrawConnect::b_connect(void) {
+  if (this->getConnectStatus()) {
+    return true;
+  }
+
+  auto path = this->path;
+  if (path.empty()) {
+    auto find_hid_vec = ChessHidrawConnect::listDevice();
+    if (find_hid_vec.empty()) {
+      return false;
+    }
+    path = find_hid_vec[0];
+  }
+
+  int fd = open(path.c_str(), O_RDWR | O_NONBLOCK | O_CLOEXEC);
+  this->fd = fd;
+  this->connectStatus = fd >= 0;
+  return this->connectStatus;
+}
+
+void ChessHidrawConnect::b_disconnect() {
+  int fd = this->fd.exchange(-1);
+  if (fd >= 0) {
+    close(fd);
+  }
+  this->connectStatus = false;
+}
+
+int ChessHidrawConnect::b_read(unsigned char *data, size_t length) {
+  int fd = this->fd;
+  if (!this->connectStatus || fd < 0) {
+    return 0;
+  }
+  ssize_t n;
+  do {
+    n = ::read(fd, data, length);
+  } while (n < 0 && errno == EINTR);
+  if (n > 0) {
+    return static_cast<int>(n);
+  }
+  if (n == 0 || errno == EAGAIN) {
+    // the reactor also reports hangups as readable, tell them apart from a
+    // spurious wake-up
+    pollfd p = {fd, POLLIN, 0};
+    if (poll(&p, 1, 0) == 1 && (p.revents & (POLLERR | POLLHUP | POLLNVAL))) {
+      return -1;
+    }
+    return 0;
+  }
+  return -1;
+}
+
+int ChessHidrawConnect::b_write(const unsigned char *data, size_t length) {
+  if (length == 0) {
+    return 0;
+  }
+  int fd = this->fd;
+  if (!this->connectStatus || fd < 0) {
+    return 0;
+  }
+  for (;;) {
+    auto n = ::write(fd, data, length);
+    if (n >= 0) {
+      return static_cast<int>(n);
+    }
+    if (errno == EAGAIN) {
+      pollfd p = {fd, POLLOUT, 0};
+      if (poll(&p, 1, HIDRAW_WRITE_TIMEOUT) == 1 && !(p.revents & (POLLERR | POLLHUP | POLLNVAL))) {
+        continue;
+      }
+      return -1;
+    }
+    if (errno != EINTR) {
+      return -1;
+    }
+  }
+}
+
+int ChessHidrawConnect::b_fd(void) { return this->connectStatus ? this->fd.load() : -1; }
+#endif
+
+ChessRequests::ChessRequests() {
+  this->nextId = 0;
+  this->matchedCount = 0;
+  this->fallbackCount = 0;
+  this->unmatchedCount = 0;
+}
+
+void ChessRequests::allowFallback(unsigned char opcode) {
+  lock_guard<mutex> lock(this->pendingMutex);
+  this->fallback.set(opcode);
+}
+
+void ChessRequests::resolve(Pending &request, const Response &response) {
+  request.done.set_value(response);
+  if (request.callback) {
+    request.callback(response);
+  }
+}
+
+uint64_t ChessRequests::add(unsigned char opcode, ResponseHandle *handle, ResponseCallback callback) {
+  lock_guard<mutex> lock(this->pendingMutex);
+  auto &queue = this->pending[opcode];
+  queue.emplace_back();
+  auto &request = queue.back();
+  request.id = this->nextId++;
+  request.callback = move(callback);
+  if (handle) {
+    *handle = request.done.get_future().share();
+  }
+  return request.id;
+}
+
+bool ChessRequests::complete(const unsigned char *data, size_t length, bool fallback) {
+  Pending request;
+  {
+    lock_guard<mutex> lock(this->pendingMutex);
+    deque<Pending> *queue = &this->pending[data[0]];
+    if (!queue->empty()) {
+      this->matchedCount++;
+    } else {
+      // the oldest request of all opcodes that allow a fallback
+      queue = nullptr;
+      for (size_t opcode = 0; fallback && opcode < this->pending.size(); opcode++) {
+        auto &candidate = this->pending[opcode];
+        if (this->fallback[opcode] && !candidate.empty() && (!queue || candidate.front().id < queue->front().id)) {
+          queue = &candidate;
+        }
+      }
+      if (!queue) {
+        this->unmatchedCount++;
+#ifdef _DEBUG_FLAG
+        spdlog::debug("Unmatched report: {0:n:X:p}", spdlog::to_hex(vector<unsigned char>(data, data + length)));
+#endif
+        return false;
+      }
+      this->fallbackCount++;
+#ifdef _DEBUG_FLAG
+      spdlog::debug("Report {0:X} answers a query by fallback", data[0]);
+#endif
+    }
+    request = move(queue->front());
+    queue->pop_front();
+  }
+  resolve(request, Response(data, data + length));
+  return true;
+}
+
+void ChessRequests::cancel(unsigned char opcode, uint64_t id) {
+  Pending request;
+  {
+    lock_guard<mutex> lock(this->pendingMutex);
+    auto &queue = this->pending[opcode];
+    auto it = queue.begin();
+    while (it != queue.end() && it->id != id) {
+      it++;
+    }
+    if (it == queue.end()) {
+      return;
+    }
+    request = move(*it);
+    queue.erase(it);
+  }
+  resolve(request, Response());
+}
+
+void ChessRequests::cancelAll(void) {
+  vector<Pending> cancelled;
+  {
+    lock_guard<mutex> lock(this->pendingMutex);
+    for (auto &queue : this->pending) {
+      for (auto &request : queue) {
+        cancelled.push_back(move(request));
+      }
+      queue.clear();
+    }
+  }
+  for (auto &request : cancelled) {
+    resolve(request, Response());
+  }
+}
+
+ChessRequestStats ChessRequests::stats(void) const {
+  return {this->matchedCount.load(), this->fallbackCount.load(), this->unmatchedCount.load()};
+}
+
 ChessLink::ChessLink(ChessHardConnect *chess_connect) {
 
   this->reconnected = false;
@@ -155,19 +727,39 @@ ChessLink::ChessLink(ChessHardConnect *chess_connect) {
 
   this->fileTransfer = false;
 
+  this->activePositions = 0;
+
+  this->fileTimeoutMs = 120000;
+
+  this->readWakeups = 0;
+
   this->mode = 1;
 
+  this->requests.allowFallback(VERSION_RESPONSE);
+  this->requests.allowFallback(FILE_COUNT_RESPONSE);
+
   this->device = unique_ptr<ChessHardConnect>(chess_connect);
 
   this->rCallback = nullptr;
 
+  this->bCallback = nullptr;
+
+  this->sCallback = nullptr;
+
+  this->eCallback = nullptr;
+
+  this->hasLastState = false;
+
+  this->mCallback = nullptr;
+
   this->ledStatus = {bitset<8>(0), bitset<8>(0), bitset<8>(0), bitset<8>(0),
                      bitset<8>(0), bitset<8>(0), bitset<8>(0), bitset<8>(0)};
 }
 
 ChessLink::~ChessLink() { this->disconnect(); }
 
-bool ChessLink::setLedInternal() {
+WriteHandle ChessLink::setLedInternal(WriteCallback callback) {
+  lock_guard<mutex> lock(this->ledMutex);
   unsigned char buf[] = {
       0x0a,
       0x08,
@@ -180,8 +772,23 @@ bool ChessLink::setLedInternal() {
       static_cast<unsigned char>(this->ledStatus[6].to_ulong()),
       static_cast<unsigned char>(this->ledStatus[7].to_ulong()),
   };
-  auto r = this->device->write(buf, sizeof(buf));
-  return r ? true : false;
+  return this->device->post(buf, sizeof(buf), move(callback));
+}
+
+// true unless the handle already reports a rejected or failed write
+static bool accepted(const WriteHandle &handle) {
+  if (handle.wait_for(chrono::seconds(0)) == future_status::ready) {
+    return handle.get() > 0;
+  }
+  return true;
+}
+
+WriteHandle ChessLink::setLedAsync(array<bitset<8>, 8> status, WriteCallback callback) {
+  {
+    lock_guard<mutex> lock(this->ledMutex);
+    this->ledStatus = status;
+  }
+  return this->setLedInternal(move(callback));
 }
 
 bool ChessLink::setLed(array<bitset<8>, 8> status) {
@@ -189,7 +796,7 @@ bool ChessLink::setLed(array<bitset<8>, 8> status) {
     lock_guard<mutex> lock(this->ledMutex);
     this->ledStatus = status;
   }
-  return this->setLedInternal();
+  return accepted(this->setLedInternal());
 }
 
 bool ChessLink::setLed(bitset<8> b1, bitset<8> b2, bitset<8> b3, bitset<8> b4,
@@ -198,7 +805,7 @@ bool ChessLink::setLed(bitset<8> b1, bitset<8> b2, bitset<8> b3, bitset<8> b4,
     lock_guard<mutex> lock(this->ledMutex);
     this->ledStatus = array<bitset<8>, 8>{b1, b2, b3, b4, b5, b6, b7, b8};
   }
-  return this->setLedInternal();
+  return accepted(this->setLedInternal());
 }
 
 bool ChessLink::setLed(string s1, string s2, string s3, string s4, string s5,
@@ -214,7 +821,7 @@ bool ChessLink::setLed(string s1, string s2, string s3, string s4, string s5,
         bitset<8>(s1), bitset<8>(s2), bitset<8>(s3), bitset<8>(s4),
         bitset<8>(s5), bitset<8>(s6), bitset<8>(s7), bitset<8>(s8)};
   }
-  return this->setLedInternal();
+  return accepted(this->setLedInternal());
 }
 
 bool ChessLink::setLed(uint8_t x, uint8_t y, bool status) {
@@ -226,118 +833,380 @@ bool ChessLink::setLed(uint8_t x, uint8_t y, bool status) {
 
     this->ledStatus[x][y] = status;
   }
-  return this->setLedInternal();
+  return accepted(this->setLedInternal());
 }
 
-string ChessLink::getMcuVersion() {
-  unsigned char buf[] = {
-      0x27,
-      0x01,
-      0x01,
-  };
-  auto r = this->device->write(buf, sizeof(buf));
-  if (r > 0) {
-    auto version = this->data.read();
-    if (version.size() > 0) {
-      return string((char *)version.data() + 3, version.size() - 3);
+uint64_t ChessLink::sendQuery(const unsigned char *data, size_t length, unsigned char response,
+                             ResponseHandle *handle, WriteHandle *written, ResponseCallback callback) {
+  // register before sending, so that a fast answer cannot be missed
+  auto id = this->requests.add(response, handle, move(callback));
+  auto w = this->device->post(data, length, [this, response, id](int res) {
+    if (res <= 0) {
+      this->requests.cancel(response, id);
     }
+  });
+  if (written) {
+    *written = w;
   }
-  return "";
+  return id;
 }
 
-string ChessLink::getBleVersion() {
-  unsigned char buf[] = {
-      0x27,
-      0x01,
-      0x00,
-  };
-  auto r = this->device->write(buf, sizeof(buf));
-  if (r > 0) {
-    auto version = this->data.read();
-    if (version.size() > 0) {
-      return string((char *)version.data() + 3, version.size() - 3);
-    }
+Response ChessLink::awaitQuery(unsigned char response, uint64_t id, const ResponseHandle &handle,
+                               const WriteHandle &written) {
+  if (written.get() > 0 && handle.wait_for(chrono::milliseconds(RESPONSE_TIMEOUT)) != future_status::ready) {
+    // the board did not answer, a late answer must not complete the next query
+    this->requests.cancel(response, id);
+  }
+  return handle.get();
+}
+
+ResponseHandle ChessLink::query(const unsigned char *data, size_t length, unsigned char response,
+                               ResponseCallback callback) {
+  ResponseHandle handle;
+  this->sendQuery(data, length, response, &handle, nullptr, move(callback));
+  return handle;
+}
+
+Response ChessLink::queryWait(const unsigned char *data, size_t length, unsigned char response) {
+  ResponseHandle handle;
+  WriteHandle written;
+  auto id = this->sendQuery(data, length, response, &handle, &written);
+  return this->awaitQuery(response, id, handle, written);
+}
+
+// version string of a version response
+static string versionOf(const Response &response) {
+  if (response.size() > 3) {
+    return string((char *)response.data() + 3, response.size() - 3);
   }
   return "";
 }
 
+// single value of a battery or file count response, -1 if the query failed
+static int valueOf(const Response &response) { return response.size() > 2 ? response[2] : -1; }
+
+// query commands
+constexpr unsigned char MCU_VERSION_QUERY[] = {VERSION_OPCODE, 0x01, 0x01};
+constexpr unsigned char BLE_VERSION_QUERY[] = {VERSION_OPCODE, 0x01, 0x00};
+constexpr unsigned char BATTERY_QUERY[] = {BATTERY_OPCODE, 0x01, 0x00};
+constexpr unsigned char FILE_COUNT_QUERY[] = {FILE_COUNT_OPCODE, 0x01, 0x00};
+constexpr unsigned char FILE_DELETE[] = {0x39, 0x01, 0x00};
+
+string ChessLink::getMcuVersion() {
+  return versionOf(this->queryWait(MCU_VERSION_QUERY, sizeof(MCU_VERSION_QUERY), VERSION_RESPONSE));
+}
+
+string ChessLink::getBleVersion() {
+  return versionOf(this->queryWait(BLE_VERSION_QUERY, sizeof(BLE_VERSION_QUERY), VERSION_RESPONSE));
+}
+
 uint32_t ChessLink::getBattery() {
-  unsigned char buf[] = {
-      0x29,
-      0x01,
-      0x00,
-  };
-  auto r = this->device->write(buf, sizeof(buf));
-  if (r > 0) {
-    auto version = this->batteryData.read();
-    if (version.size() > 0) {
-      return version[2];
-    }
-  }
-  return 0;
+  auto battery = valueOf(this->queryWait(BATTERY_QUERY, sizeof(BATTERY_QUERY), BATTERY_RESPONSE));
+  return battery > 0 ? battery : 0;
 }
 
 uint32_t ChessLink::getFileCount() {
-  unsigned char buf[] = {
-      0x31,
-      0x01,
-      0x00,
+  auto count = valueOf(this->queryWait(FILE_COUNT_QUERY, sizeof(FILE_COUNT_QUERY), FILE_COUNT_RESPONSE));
+  return count > 0 ? count : 0;
+}
+
+ChessDeviceInfo ChessLink::queryDeviceInfo() {
+  ResponseHandle mcu, ble, battery, count;
+  WriteHandle mcu_w, ble_w, battery_w, count_w;
+
+  // send everything first, then collect; both versions share a response
+  // opcode and are answered in the order they were sent
+  auto mcu_id = this->sendQuery(MCU_VERSION_QUERY, sizeof(MCU_VERSION_QUERY), VERSION_RESPONSE, &mcu, &mcu_w);
+  auto ble_id = this->sendQuery(BLE_VERSION_QUERY, sizeof(BLE_VERSION_QUERY), VERSION_RESPONSE, &ble, &ble_w);
+  auto battery_id = this->sendQuery(BATTERY_QUERY, sizeof(BATTERY_QUERY), BATTERY_RESPONSE, &battery, &battery_w);
+  auto count_id = this->sendQuery(FILE_COUNT_QUERY, sizeof(FILE_COUNT_QUERY), FILE_COUNT_RESPONSE, &count, &count_w);
+
+  ChessDeviceInfo info;
+  info.mcuVersion = versionOf(this->awaitQuery(VERSION_RESPONSE, mcu_id, mcu, mcu_w));
+  info.bleVersion = versionOf(this->awaitQuery(VERSION_RESPONSE, ble_id, ble, ble_w));
+  info.battery = valueOf(this->awaitQuery(BATTERY_RESPONSE, battery_id, battery, battery_w));
+  info.fileCount = valueOf(this->awaitQuery(FILE_COUNT_RESPONSE, count_id, count, count_w));
+  return info;
+}
+
+void ChessLink::getMcuVersionAsync(function<void(string)> callback) {
+  this->query(MCU_VERSION_QUERY, sizeof(MCU_VERSION_QUERY), VERSION_RESPONSE,
+              [callback](const Response &response) { callback(versionOf(response)); });
+}
+
+void ChessLink::getBleVersionAsync(function<void(string)> callback) {
+  this->query(BLE_VERSION_QUERY, sizeof(BLE_VERSION_QUERY), VERSION_RESPONSE,
+              [callback](const Response &response) { callback(versionOf(response)); });
+}
+
+void ChessLink::getBatteryAsync(function<void(int)> callback) {
+  this->query(BATTERY_QUERY, sizeof(BATTERY_QUERY), BATTERY_RESPONSE,
+              [callback](const Response &response) { callback(valueOf(response)); });
+}
+
+void ChessLink::getFileCountAsync(function<void(int)> callback) {
+  this->query(FILE_COUNT_QUERY, sizeof(FILE_COUNT_QUERY), FILE_COUNT_RESPONSE,
+              [callback](const Response &response) { callback(valueOf(response)); });
+}
+
+void ChessLink::failFileRequests(void) {
+  deque<FileRequest> failed;
+  {
+    lock_guard<mutex> lock(this->fileMutex);
+    failed.swap(this->fileRequests);
+  }
+  for (auto &request : failed) {
+    request.onDone(-1, WriteHandle());
+  }
+}
+
+void ChessLink::startFile(FileRequest request) {
+  this->switchUploadMode();
+  this->queueFile(move(request));
+}
+
+void ChessLink::queueFile(FileRequest request) {
+  {
+    lock_guard<mutex> lock(this->fileMutex);
+    this->fileRequests.push_back(move(request));
+  }
+
+  unsigned char buf1[] = {0x33, 0x01, 0x00};
+  unsigned char buf2[] = {0x34, 0x01, 0x01};
+  auto failed = [this](int res) {
+    if (res <= 0) {
+      this->failFileRequests();
+    }
   };
-  auto r = this->device->write(buf, sizeof(buf));
-  if (r > 0) {
-    auto version = this->data.read();
-    if (version.size() > 0) {
-      return version[2];
+  this->device->post(buf1, sizeof(buf1), failed);
+  this->device->post(buf2, sizeof(buf2), failed);
+}
+
+void ChessLink::abandonFile(const void *owner) {
+  lock_guard<mutex> lock(this->fileMutex);
+  auto &queue = this->fileRequests;
+  queue.erase(remove_if(queue.begin(), queue.end(), [owner](const FileRequest &r) { return r.owner == owner; }),
+              queue.end());
+  if (this->activeFile.owner == owner) {
+    this->activeFile = {};
+    this->fileTransfer = false;
+  }
+}
+
+void ChessLink::finishFile(int positions) {
+  FileRequest request;
+  {
+    lock_guard<mutex> lock(this->fileMutex);
+    request = move(this->activeFile);
+    this->activeFile = {};
+  }
+  if (!request.onDone) {
+    return;
+  }
+  WriteHandle deleted;
+  if (positions >= 0 && request.is_delete) {
+    // file get success, delete it
+    deleted = this->device->post(FILE_DELETE, sizeof(FILE_DELETE));
+  }
+  request.onDone(positions, deleted);
+}
+
+void ChessLink::getFileAsync(FileCallback callback, bool is_delete) {
+  this->getGameFileAsync([callback](ChessGameFile file) { callback(file.fens()); }, is_delete);
+}
+
+void ChessLink::getGameFileAsync(GameFileCallback callback, bool is_delete) {
+  this->getFileCountAsync([this, callback, is_delete](int count) {
+    if (count <= 0) {
+      callback({});
+      return;
     }
+    auto file = make_shared<ChessGameFile>();
+    this->startFile({[file](const unsigned char *board) { file->add(board); },
+                     [file, callback](int positions, WriteHandle) {
+                       callback(positions > 0 ? move(*file) : ChessGameFile());
+                     },
+                     is_delete, nullptr});
+  });
+}
+
+vector<string> ChessLink::getFile(bool is_delete) { return this->getGameFile(is_delete).fens(); }
+
+ChessGameFile ChessLink::getGameFile(bool is_delete) {
+  ChessGameFile file;
+  auto positions = this->getFileStream([&file](const unsigned char *board) { file.add(board); }, is_delete);
+  if (positions <= 0) {
+    file.clear();
   }
-  return 0;
+  return file;
 }
 
-vector<string> ChessLink::getFile(bool is_delete) {
-  vector<string> file = {};
-  if (this->getFileCount() == 0) {
-    return file;
+vector<unsigned char> ChessLink::getFileEncoded(bool is_delete) {
+  ChessGameEncoder encoder;
+  auto positions = this->getFileStream([&encoder](const unsigned char *board) { encoder.add(board); }, is_delete);
+  if (positions <= 0) {
+    return {};
   }
+  return encoder.bytes();
+}
 
-  this->switchUploadMode();
+bool ChessLink::deleteFile(void) {
+  auto deleted = this->device->post(FILE_DELETE, sizeof(FILE_DELETE));
+  deleted.wait();
+  return deleted.get() > 0;
+}
+
+int ChessLink::getFileStream(FilePositionCallback onPosition, bool is_delete) {
+  if (this->getFileCount() == 0) {
+    return 0;
+  }
 
-  unsigned char buf1[] = {
-      0x33,
-      0x01,
-      0x00,
+  // completion state shared with the read thread; after a timeout the
+  // download is abandoned and late positions are no longer passed on
+  struct Transfer {
+    mutex m;
+    condition_variable cv;
+    bool done = false;
+    int positions = -1;
+    WriteHandle deleted;
   };
-  auto r1 = this->device->write(buf1, sizeof(buf1));
-
-  if (r1 > 0) {
-    unsigned char buf2[] = {
-        0x34,
-        0x01,
-        0x01,
-    };
-    auto r2 = this->device->write(buf2, sizeof(buf2));
-
-    if (r2 > 0) {
-      mutex_lock lock(this->fileMutex);
-      if (this->fileCV.wait_for(lock, chrono::seconds(120)) ==
-          cv_status::no_timeout) {
-        file = this->fileContent;
-
-        // file get success, delete it
-        if (is_delete) {
-          unsigned char buf3[] = {
-              0x39,
-              0x01,
-              0x00,
-          };
-          this->device->write(buf3, sizeof(buf3));
-        }
+  auto transfer = make_shared<Transfer>();
+
+  this->startFile({[transfer, onPosition](const unsigned char *board) {
+                     lock_guard<mutex> lock(transfer->m);
+                     if (!transfer->done) {
+                       onPosition(board);
+                     }
+                   },
+                   [transfer](int positions, WriteHandle deleted) {
+                     lock_guard<mutex> lock(transfer->m);
+                     if (!transfer->done) {
+                       transfer->positions = positions;
+                       transfer->deleted = deleted;
+                       transfer->done = true;
+                       transfer->cv.notify_all();
+                     }
+                   },
+                   is_delete, transfer.get()});
+
+  mutex_lock lock(transfer->m);
+  auto timeout = chrono::milliseconds(this->fileTimeoutMs.load());
+  bool abandoned = !transfer->cv.wait_for(lock, timeout, [&transfer] { return transfer->done; });
+  if (abandoned) {
+    transfer->done = true;
+  }
+  auto deleted = transfer->deleted;
+  auto positions = transfer->positions;
+  lock.unlock();
 
-      } else {
-        this->fileTransfer = false;
-      }
+  // the read thread locks the transfer with fileMutex held
+  if (abandoned) {
+    this->abandonFile(transfer.get());
+  }
+
+  // like the blocking getFile always did, return once the file is deleted
+  if (deleted.valid()) {
+    deleted.wait();
+  }
+  return positions;
+}
+
+struct ChessLink::GameDrain {
+  mutex m;
+  condition_variable cv;
+
+  ChessGameSink sink;
+
+  // saved files and files downloaded so far
+  size_t total = 0;
+  size_t games = 0;
+
+  // changes whenever a frame of the drain arrives
+  uint64_t progress = 0;
+
+  // delete command of the last downloaded game
+  WriteHandle deleted;
+
+  bool done = false;
+};
+
+void ChessLink::drainNext(shared_ptr<GameDrain> drain) {
+  auto game = drain->games;
+  this->queueFile({[drain, game](const unsigned char *board) {
+                     lock_guard<mutex> lock(drain->m);
+                     if (!drain->done) {
+                       drain->progress++;
+                       if (drain->sink.onPosition) {
+                         drain->sink.onPosition(game, board);
+                       }
+                     }
+                   },
+                   [this, drain, game](int positions, WriteHandle deleted) {
+                     {
+                       lock_guard<mutex> lock(drain->m);
+                       if (drain->done) {
+                         return;
+                       }
+                       drain->progress++;
+                       if (positions < 0) {
+                         drain->done = true;
+                       } else {
+                         if (drain->sink.onGame) {
+                           drain->sink.onGame(game, positions);
+                         }
+                         drain->games++;
+                         drain->deleted = deleted;
+                         drain->done = drain->games == drain->total;
+                       }
+                       drain->cv.notify_all();
+                       if (drain->done) {
+                         return;
+                       }
+                     }
+                     // the delete of this game is already queued, the request
+                     // for the next one follows it without waiting
+                     this->drainNext(drain);
+                   },
+                   true, drain.get()});
+}
+
+int ChessLink::drainAllGames(ChessGameSink sink) {
+  auto count = this->getFileCount();
+  if (count == 0) {
+    return 0;
+  }
+
+  auto drain = make_shared<GameDrain>();
+  drain->sink = move(sink);
+  drain->total = count;
+
+  this->switchUploadMode();
+  this->drainNext(drain);
+
+  // the drain fails if the board stays silent as long as a single getFile
+  // may take
+  mutex_lock lock(drain->m);
+  auto timeout = chrono::milliseconds(this->fileTimeoutMs.load());
+  bool abandoned = false;
+  while (!drain->done) {
+    auto seen = drain->progress;
+    if (!drain->cv.wait_for(lock, timeout, [&drain, seen] { return drain->done || drain->progress != seen; })) {
+      drain->done = true;
+      abandoned = true;
     }
   }
-  return file;
+  auto deleted = drain->deleted;
+  auto games = drain->games;
+  lock.unlock();
+
+  if (abandoned) {
+    this->abandonFile(drain.get());
+  }
+
+  if (deleted.valid()) {
+    deleted.wait();
+  }
+  return static_cast<int>(games);
 }
 
 bool ChessLink::connect() {
@@ -345,33 +1214,75 @@ bool ChessLink::connect() {
   spdlog::set_level(spdlog::level::debug);
 #endif
   this->reconnected = true;
-  return this->device->connect();
+  auto res = this->device->connect();
+  this->wake();
+  return res;
 }
 
 void ChessLink::disconnect() {
   this->reconnected = false;
   this->device->disconnect();
+  this->filter.reset();
+  this->debounce.reset();
+  this->requests.cancelAll();
+  this->failFileRequests();
+  this->wake();
 }
 
-bool ChessLink::beep(unsigned short frequency, unsigned short duration) {
+void ChessLink::wake() {
+  if (this->reactor) {
+    this->reactor->wake();
+  }
+  this->device->b_wake();
+}
+
+uint64_t ChessLink::getReadWakeups() { return this->readWakeups; }
+
+ChessFrameStats ChessLink::getFrameStats() { return this->decoder.stats(); }
+
+ChessRequestStats ChessLink::getRequestStats() { return this->requests.stats(); }
+
+void ChessLink::setDuplicateSuppression(bool enabled, uint32_t heartbeatMs) {
+  this->filter.configure(enabled, heartbeatMs);
+}
+
+ChessBoardFilterStats ChessLink::getBoardStats() { return this->filter.stats(); }
+
+void ChessLink::setDebounce(uint32_t windowMs, uint32_t frames) {
+  this->debounce.configure(windowMs, frames);
+  this->wake();
+}
+
+void ChessLink::setFileTimeout(uint32_t timeoutMs) { this->fileTimeoutMs = timeoutMs; }
+
+ChessDebounceStats ChessLink::getDebounceStats() { return this->debounce.stats(); }
+
+WriteHandle ChessLink::beepAsync(unsigned short frequency, unsigned short duration, WriteCallback callback) {
   unsigned char buf[] = {0x0b,
                          0x04,
                          static_cast<unsigned char>(frequency >> 8),
                          static_cast<unsigned char>(frequency & 0xff),
                          static_cast<unsigned char>(duration >> 8),
                          static_cast<unsigned char>(duration & 0xff)};
-  auto r = this->device->write(buf, sizeof(buf));
-  return r ? true : false;
+  return this->device->post(buf, sizeof(buf), move(callback));
+}
+
+bool ChessLink::beep(unsigned short frequency, unsigned short duration) {
+  return accepted(this->beepAsync(frequency, duration));
 }
 
 bool ChessLink::switchMode(unsigned char mode) {
+  // queued, so that the read thread can restore the mode after a reconnect
+  // without waiting for the write pacing
   unsigned char buf[] = {0x21, 0x01, mode};
-  auto r = this->device->write(buf, sizeof(buf));
-  return r ? true : false;
+  return accepted(this->device->post(buf, sizeof(buf)));
 }
 
 bool ChessLink::switchRealTimeMode() {
   this->mode = 0;
+  // deliver the current position right away
+  this->filter.reset();
+  this->debounce.reset();
   if (this->device->getConnectStatus()) {
     return this->switchMode(0x00);
   } else {
@@ -388,6 +1299,29 @@ bool ChessLink::switchUploadMode() {
   }
 }
 
+void ChessLink::setBoardCallback(BoardCallback callback) { this->bCallback = callback; }
+
+void ChessLink::setBoardStateCallback(BoardStateCallback callback) { this->sCallback = callback; }
+
+void ChessLink::setSquareEventCallback(SquareEventCallback callback) { this->eCallback = callback; }
+
+void ChessLink::setMoveCallback(MoveCallback callback) { this->mCallback = callback; }
+
+void ChessLink::resetMoveTracker(void) {
+  lock_guard<mutex> lock(this->trackerMutex);
+  this->tracker.reset();
+}
+
+void ChessLink::resetMoveTracker(const BoardState &board, bool whiteToMove) {
+  lock_guard<mutex> lock(this->trackerMutex);
+  this->tracker.reset(board, whiteToMove);
+}
+
+string ChessLink::getTrackedFen(void) {
+  lock_guard<mutex> lock(this->trackerMutex);
+  return this->tracker.fen();
+}
+
 void ChessLink::setRealTimeCallback(RealTimeCallback callback) {
   if (callback) {
     this->rCallback = callback;
@@ -396,130 +1330,247 @@ void ChessLink::setRealTimeCallback(RealTimeCallback callback) {
   }
 }
 
-string ChessLink::toFen(unsigned char *data, size_t length) {
-  if (length <= 32) {
-    return "";
-  }
-  string fen = "";
-  int empty = 0;
-  for (int i = 0; i < 8; i++) {
-    for (int j = 7; j >= 0; j--) {
-      char piece =
-          j % 2 == 0
-              ? CHESS_PIECES[data[(i * 8 + j) / 2 + 2] & 0x0f]
-              : CHESS_PIECES
-                    [data[static_cast<int>(floor((i * 8 + j) / 2 + 2))] >> 4];
-      if (piece == '0')
-        empty++;
-      else {
-        if (empty > 0) {
-          fen += to_string(empty);
-          empty = 0;
+void ChessLink::dispatch(const unsigned char *readBuf, size_t real_size, uint64_t timestamp) {
+  // get data success
+  {
+#ifdef _DEBUG_FLAG
+    spdlog::debug("Read Length: {1}, Read Data: {0:n:X:p}",
+                  spdlog::to_hex(vector<unsigned char>(readBuf, readBuf + real_size)), real_size);
+#endif
+  }
+
+  if (readBuf[0] == 0x37 && readBuf[1] == 0x01 && readBuf[2] == 0xbe) {
+    // start get file, a download whose end marker never came has failed
+    this->finishFile(-1);
+    lock_guard<mutex> lock(this->fileMutex);
+    if (!this->fileRequests.empty()) {
+      this->activeFile = move(this->fileRequests.front());
+      this->fileRequests.pop_front();
+    }
+    this->activePositions = 0;
+    this->fileTransfer = true;
+  }
+
+  if (readBuf[0] == 0x37 && readBuf[1] == 0x01 && readBuf[2] == 0xed) {
+    // get file end
+    this->fileTransfer = false;
+    this->finishFile(this->activePositions);
+  }
+
+  if (readBuf[0] == 0x37) {
+    // file transfer markers are not an answer to a query
+    return;
+  }
+
+  // Processed separately according to the type of data received
+  if (readBuf[0] == 0x01) {
+    if (this->fileTransfer) {
+      // if file transfer mode is true, hand the position on as it arrives
+      this->activePositions++;
+      lock_guard<mutex> lock(this->fileMutex);
+      if (this->activeFile.onPosition) {
+        this->activeFile.onPosition(readBuf + 2);
+      }
+
+    } else {
+      // chessboard piece layout data in Real Time Mode, positions that are
+      // not stable yet or did not change are dropped before any formatting
+      if (this->debounce.accept(readBuf + 2, timestamp) && this->filter.accept(readBuf + 2, timestamp)) {
+        this->deliverBoard(readBuf + 2, timestamp);
+      }
+    }
+
+  } else {
+    if (readBuf[0] == BATTERY_RESPONSE && readBuf[2] == 0) {
+      // The new hardware will report the battery level information
+      // in real time, reports without a level are not an answer
+      return;
+    }
+    // Normal response information processing, reports that answer no
+    // pending query are counted as unmatched; battery levels the board
+    // reports on its own never answer another query
+    this->requests.complete(readBuf, real_size, readBuf[0] != BATTERY_RESPONSE);
+  }
+}
+
+void ChessLink::deliverBoard(const unsigned char *packed, uint64_t timestamp) {
+  auto board_callback = this->bCallback;
+  if (board_callback) {
+    board_callback(packed, timestamp);
+  }
+  auto state_callback = this->sCallback;
+  auto event_callback = this->eCallback;
+  auto move_callback = this->mCallback;
+  if (state_callback || event_callback || move_callback) {
+    auto state = BoardState::fromPacked(packed);
+    if (state_callback) {
+      state_callback(state, timestamp);
+    }
+    if (move_callback) {
+      ChessMove move;
+      bool moved;
+      {
+        lock_guard<mutex> lock(this->trackerMutex);
+        moved = this->tracker.update(state, &move);
+      }
+      if (moved) {
+        move_callback(move, timestamp);
+      }
+    }
+    if (event_callback) {
+      if (this->hasLastState) {
+        ChessSquareEvent events[SQUARE_EVENTS_MAX];
+        auto count = this->lastState.events(state, timestamp, events);
+        if (count > 0) {
+          event_callback(events, count);
         }
       }
-      if (piece != '0')
-        fen += piece;
+      this->lastState = state;
     }
-    if (empty > 0)
-      fen += to_string(empty);
-    if (i < 7)
-      fen += "/";
-    empty = 0;
+    // a callback set later must not diff against an old position
+    this->hasLastState = event_callback != nullptr;
+  } else {
+    this->hasLastState = false;
+  }
+  if (this->rCallback) {
+    char fen[BOARD_FEN_MAX];
+    auto n = ChessBoardDecoder::fen(packed, fen);
+    this->rCallback(string(fen, n));
   }
-  return fen;
 }
 
-shared_ptr<ChessLink> ChessLink::fromHidConnect() {
-  ChessHardConnect *c = new ChessHidConnect();
+int ChessLink::settleBoard(uint64_t now) {
+  unsigned char packed[PACKED_BOARD_SIZE];
+  if (this->debounce.expire(now, packed) && !this->fileTransfer && this->filter.accept(packed, now)) {
+    this->deliverBoard(packed, now);
+  }
+  auto remaining = this->debounce.remaining(now);
+  if (remaining >= static_cast<uint64_t>(READ_IDLE_INTERVAL) * 1000) {
+    return READ_IDLE_INTERVAL;
+  }
+  // round up, so that the window has elapsed when the wait times out
+  return static_cast<int>((remaining + 999) / 1000);
+}
+
+void ChessLink::receive(const unsigned char *data, int res, uint64_t timestamp) {
+  if (res >= 1) {
+    this->decoder.feed(data, res, [this, timestamp](const unsigned char *frame, size_t length) {
+      this->dispatch(frame, length, timestamp);
+    });
+  } else if (res < 0) {
+    // some thing wrong, The device may be disconnected
+    this->device->disconnect();
+    this->decoder.reset();
+    this->filter.reset();
+    this->debounce.reset();
+    this->requests.cancelAll();
+    this->failFileRequests();
+    this->finishFile(-1);
+  }
+}
+
+int ChessLink::service(uint64_t now, bool monitored) {
+  if (this->device->connectStatus) {
+    return this->settleBoard(now);
+  }
+
+  this->finishFile(-1);
+  if (!this->reconnected) {
+    return READ_IDLE_INTERVAL;
+  }
+
+  // with a hotplug monitor, only enumerate the devices after a matching one
+  // was added; without one, poll
+  if (this->reconnect.attempt(now, monitored)) {
+    // not ChessLink::connect, which wakes the driving thread
+    if (this->device->connect()) {
+      this->reconnect.connected();
+      if (this->mode == 0) {
+        this->switchRealTimeMode();
+      }
+      if (this->mode == 1) {
+        this->switchUploadMode();
+      }
+      return 0;
+    }
+  }
+  return this->reconnect.retrying(now, monitored) ? RECONNECT_INTERVAL : READ_IDLE_INTERVAL;
+}
+
+void ChessLink::plugged(uint64_t now) { this->reconnect.plugged(now); }
+
+shared_ptr<ChessLink> ChessLink::fromHidConnect() { return ChessLink::fromConnect(new ChessHidConnect()); }
+
+shared_ptr<ChessLink> ChessLink::fromHidPath(string path) { return ChessLink::fromConnect(new ChessHidConnect(path)); }
+
+shared_ptr<ChessLink> ChessLink::fromHidSerial(string serial) {
+  return ChessLink::fromConnect(new ChessHidConnect("", serial));
+}
+
+shared_ptr<ChessLink> ChessLink::fromHidrawConnect(string path) {
+#ifdef __linux__
+  return ChessLink::fromConnect(new ChessHidrawConnect(path));
+#else
+  return path.empty() ? ChessLink::fromHidConnect() : ChessLink::fromHidPath(path);
+#endif
+}
+
+shared_ptr<ChessLink> ChessLink::fromConnect(ChessHardConnect *c) {
   shared_ptr<ChessLink> r(new ChessLink(c));
+  r->reactor.reset(new ChessReactor());
 
   thread readThread = thread(
       [](shared_ptr<ChessLink> chesslink) {
         unsigned char readBuf[256];
+        unsigned int watchedConnect = 0;
         while (chesslink->threadMode && chesslink.use_count() >= 2) {
+          chesslink->readWakeups++;
           if (chesslink->device->connectStatus) {
-            int res = chesslink->device->read(readBuf, sizeof(readBuf));
-            if (res >= 1) {
-
-              unsigned int real_size = readBuf[1] + 2;
-
-              // get data success
-              {
-#ifdef _DEBUG_FLAG
-                spdlog::debug("Read Length: {1}, Read Data: {0:n:X:p}",
-                              spdlog::to_hex(vector<unsigned char>(
-                                  readBuf, readBuf + real_size)),
-                              real_size);
-#endif
-              }
-
-              if (readBuf[0] == 0x37 && readBuf[1] == 0x01 &&
-                  readBuf[2] == 0xbe) {
-                // start get file
-                lock_guard<mutex> lock(chesslink->fileMutex);
-                chesslink->fileTransfer = true;
-                chesslink->fileContent.clear();
-              }
+            // a reopened device may reuse the previous descriptor number,
+            // which the kernel has already dropped from the epoll set
+            if (watchedConnect != chesslink->device->connectCount) {
+              watchedConnect = chesslink->device->connectCount;
+              chesslink->reactor->watch(-1);
+            }
 
-              if (readBuf[0] == 0x37 && readBuf[1] == 0x01 &&
-                  readBuf[2] == 0xed) {
-                // get file end
-                chesslink->fileTransfer = false;
-                chesslink->fileCV.notify_all();
-              }
+            // deliver a realtime position whose debounce window elapsed, the
+            // reactor times out when the next one will
+            int timeout = chesslink->service(steadyMicros(), false);
 
-              // Processed separately according to the type of data received
-              if (readBuf[0] == 0x01) {
-                if (chesslink->fileTransfer) {
-                  // if file transfer mode is true
-                  lock_guard<mutex> lock(chesslink->fileMutex);
-                  chesslink->fileContent.push_back(
-                      ChessLink::toFen(readBuf, real_size));
-
-                } else {
-                  // chessboard piece layout data in Real Time Mode
-                  if (chesslink->rCallback) {
-                    chesslink->rCallback(ChessLink::toFen(readBuf, real_size));
-                  }
-                }
-
-              } else {
-                if (readBuf[0] == 0x2A) {
-                  // battery status
-                  // The new hardware will report the battery level information
-                  // in real time, so the battery level information is
-                  // additionally processed
-                  if (readBuf[2] != 0) {
-                    chesslink->batteryData.write(
-                        vector<unsigned char>(readBuf, readBuf + res));
-                  }
-
-                } else {
-                  // Normal response information processing
-                  chesslink->data.write(
-                      vector<unsigned char>(readBuf, readBuf + res));
-                }
+            // block in the reactor until a report is ready when the transport
+            // can be polled, otherwise block inside the transport's read
+            if (chesslink->reactor->watch(chesslink->device->b_fd())) {
+              auto events = chesslink->reactor->wait(timeout);
+              if (!(events & ChessReactor::Readable)) {
+                continue;
               }
+            }
 
-            } else if (res == 0) {
-              // no data, sleep for a while
-              this_thread::sleep_for(chrono::milliseconds(10));
-            } else if (res < 0) {
-              // some thing wrong, The device may be disconnected
-              chesslink->device->disconnect();
+            int res = chesslink->device->read(readBuf, sizeof(readBuf));
+            chesslink->receive(readBuf, res, steadyMicros());
+          } else if (chesslink->reconnected) {
+            bool monitored =
+                chesslink->hotplug.open() && chesslink->reactor->watch(chesslink->hotplug.descriptor());
+            int timeout = chesslink->service(steadyMicros(), monitored);
+            if (chesslink->device->connectStatus) {
+              chesslink->reactor->watch(-1);
+              chesslink->hotplug.close();
+              continue;
             }
-          } else {
-            if (chesslink->reconnected) {
-              if (chesslink->connect()) {
-                if (chesslink->mode == 0) {
-                  chesslink->switchRealTimeMode();
-                }
-                if (chesslink->mode == 1) {
-                  chesslink->switchUploadMode();
-                }
-              }
+            auto events = chesslink->reactor->wait(timeout);
+            if (monitored && (events & ChessReactor::Readable) && chesslink->hotplug.added(ChessHidConnect::isBoard)) {
+              chesslink->plugged(steadyMicros());
+            }
+            if (events & ChessReactor::Woken) {
+              // e.g. connect() was called, try right away
+              chesslink->reconnect.wake();
             }
-            this_thread::sleep_for(chrono::milliseconds(10));
+          } else {
+            chesslink->service(steadyMicros(), false);
+            chesslink->reactor->watch(-1);
+            chesslink->hotplug.close();
+            // nothing to do until connect() or shutdown wakes us up
+            chesslink->reactor->wait(READ_IDLE_INTERVAL);
           }
         }
         return;
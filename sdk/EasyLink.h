@@ -1,8 +1,17 @@
+#ifndef CHESS_EASY_LINK_HEADER_GUARD
+#define CHESS_EASY_LINK_HEADER_GUARD
+
 #ifdef _DEBUG_FLAG
 #include "spdlog/fmt/bin_to_hex.h"
 #include "spdlog/spdlog.h"
 #endif
 #include "../thirdparty/hidapi/hidapi/hidapi.h"
+#include "ChessBoard.h"
+#include "ChessFrameDecoder.h"
+#include "ChessGameCodec.h"
+#include "ChessHotplug.h"
+#include "ChessMoveTracker.h"
+#include "ChessReactor.h"
 #include <array>
 #include <atomic>
 #include <bitset>
@@ -10,11 +19,15 @@
 #include <cmath>
 #include <condition_variable>
 #include <cstdint>
+#include <deque>
+#include <functional>
+#include <future>
 #include <iostream>
 #include <memory>
 #include <mutex>
 #include <numeric>
 #include <ostream>
+#include <shared_mutex>
 #include <stdint.h>
 #include <string>
 #include <thread>
@@ -26,16 +39,129 @@ using mutex_lock = unique_lock<mutex>;
 
 using RealTimeCallback = void (*)(const string);
 
+// receives the packed position of a realtime frame, PACKED_BOARD_SIZE bytes
+// that are only valid during the call, and the steady clock time in
+// microseconds at which the frame was read
+using BoardCallback = void (*)(const uint8_t *board, uint64_t timestamp);
+
+// receives the position of a realtime frame as bitboards and the steady clock
+// time in microseconds at which the frame was read
+using BoardStateCallback = void (*)(const BoardState &state, uint64_t timestamp);
+
+// receives the pieces lifted and placed since the previous realtime frame,
+// the events are only valid during the call
+using SquareEventCallback = void (*)(const ChessSquareEvent *events, size_t count);
+
+// receives every legal move inferred from the realtime positions and the
+// steady clock time in microseconds of the frame that completed it
+using MoveCallback = void (*)(const ChessMove &move, uint64_t timestamp);
+
+// completion handle of a queued write, resolves to the result of b_write,
+// or -1 if the command was rejected or dropped
+using WriteHandle = shared_future<int>;
+
+// called with the same result as the WriteHandle once a write completes
+using WriteCallback = function<void(int)>;
+
+// one queued outgoing command
+struct ChessCommand {
+  vector<unsigned char> data;
+  promise<int> done;
+
+  // handle of done, shared by every post coalesced into this command
+  WriteHandle handle;
+
+  // completion callbacks of every post coalesced into this command
+  vector<WriteCallback> callbacks;
+};
+
+// token bucket that paces one or more command opcodes
+struct ChessPacing {
+  // milliseconds per token, 0 disables pacing
+  unsigned int interval;
+
+  // bucket size, the number of commands that may go out back to back
+  unsigned int burst;
+
+  // available tokens
+  double tokens;
+
+  // time of the last refill
+  chrono::steady_clock::time_point refillTime;
+
+  ChessPacing(unsigned int interval = 0, unsigned int burst = 1);
+
+  /**
+  take a token if one is available at now
+  Returns now if a token was taken, otherwise the time at which the next token
+  becomes available
+  */
+  chrono::steady_clock::time_point take(chrono::steady_clock::time_point now);
+};
+
 class ChessHardConnect {
 private:
-  // connect mutex
-  mutex connectMutex;
+  // connect mutex, shared by read and write, exclusive for connect and
+  // disconnect
+  shared_mutex connectMutex;
+
+  // write queue mutex
+  mutex queueMutex;
+
+  // signals the writer thread about new commands and shutdown
+  condition_variable queueCV;
+
+  // commands waiting for the writer thread, bounded by WRITE_QUEUE_CAPACITY
+  deque<ChessCommand> queue;
+
+  // writer thread, started by the first post
+  thread writeThread;
+
+  // writer thread stop flag
+  bool writeStop;
+
+  // number of queued commands that were superseded before being sent
+  atomic<uint64_t> coalescedCount;
+
+  // pacing shared by all opcodes without their own entry
+  ChessPacing defaultPacing;
+
+  // per-opcode pacing, used where hasPacing is set
+  array<ChessPacing, 256> pacing;
+  bitset<256> hasPacing;
+
+  // pacing bucket for an opcode, requires queueMutex
+  ChessPacing &pacingFor(unsigned char opcode);
+
+  // writer thread body, drains the queue at the device's pacing rate
+  void writeLoop(void);
+
+  // pop the head of the queue if its pacing allows sending it at now,
+  // otherwise set due; requires queueMutex
+  bool popDue(chrono::steady_clock::time_point now, ChessCommand &cmd, chrono::steady_clock::time_point &due);
+
+protected:
+  /**
+  called with the queue locked whenever a command was queued, must not block
+  by default it starts or wakes the writer thread; a transport that writes
+  from its own event loop overrides it to wake that loop, which then takes
+  the commands with nextWrite
+  */
+  virtual void b_queued(void);
+
+  /**
+  take the next queued command if its pacing allows sending it at now
+  Returns true if cmd was taken, otherwise due is set to when the head of the
+  queue may be sent, time_point::max() if the queue is empty
+  */
+  bool nextWrite(chrono::steady_clock::time_point now, ChessCommand &cmd, chrono::steady_clock::time_point &due);
 
-  // write mutex
-  mutex writeMutex;
+  // complete a command taken with nextWrite and run its callbacks
+  static void completeWrite(ChessCommand &cmd, int res);
 
-  // write time pint;
-  std::chrono::steady_clock::time_point writeTime;
+  // write a command taken with nextWrite on the calling thread with b_write,
+  // then complete it
+  void sendWrite(ChessCommand &cmd);
 
 public:
   ChessHardConnect();
@@ -44,18 +170,78 @@ public:
   // The connection state of the physical chessboard, default is false
   atomic_bool connectStatus;
 
+  // incremented on every successful connect, lets pollers notice a reopened
+  // descriptor that happens to reuse the previous number
+  atomic_uint connectCount;
+
   // base write data
   virtual int b_write(const unsigned char *data, size_t length) = 0;
 
   // base read data
   virtual int b_read(unsigned char *data, size_t length) = 0;
 
-  // write data, based on b_write;
+  /**
+  queue data for the writer thread, based on b_write; never blocks
+  A LED frame (0x0a) overwrites the LED frame that is still waiting in the
+  queue, if any, and shares its handle, so the board always shows the newest
+  state; all other commands keep FIFO order
+  callback, if set, runs on the writer thread once the data has been written
+  or dropped, or right away if the command is rejected
+  Returns a handle that completes once the data has been written
+  */
+  WriteHandle post(const unsigned char *data, size_t length, WriteCallback callback = nullptr);
+
+  // write data and wait until it has been sent, based on post;
   int write(const unsigned char *data, size_t length);
 
+  /**
+  returns the number of LED frames that were superseded by a newer frame
+  before they were sent
+  */
+  uint64_t getCoalescedWrites(void);
+
+  /**
+  pace an opcode with its own token bucket, independent of other opcodes
+  intervalMs is the time per token, 0 disables pacing for the opcode
+  burst is the number of commands that may be sent back to back, at least 1
+  */
+  void setPacing(unsigned char opcode, unsigned int intervalMs, unsigned int burst);
+
+  /**
+  set the token bucket shared by all opcodes without their own pacing,
+  by default one command every 200 ms
+  */
+  void setDefaultPacing(unsigned int intervalMs, unsigned int burst);
+
+  /**
+  remove the pacing of an opcode, it falls back to the default pacing
+  */
+  void clearPacing(unsigned char opcode);
+
+  /**
+  stop the writer thread and fail all queued commands
+  must be called by subclasses before their transport is torn down
+  */
+  void stopWriter(void);
+
   // read data, based on b_read;
   int read(unsigned char *data, size_t length);
 
+  /**
+  base pollable descriptor of the open device
+  Returns -1 if the transport cannot be polled, in which case b_read blocks
+  for its own timeout instead
+  */
+  virtual int b_fd(void);
+
+  /**
+  called by ChessLink after connect, disconnect or a change of its timers,
+  when the thread that drives the link has to look at the device again
+  by default it does nothing, ChessLink wakes its own read thread; a transport
+  driven by a shared event loop overrides it to wake that loop
+  */
+  virtual void b_wake(void);
+
   /**
   connect to physics chess
   Returns true if the connection is successful; otherwise returns false
@@ -91,6 +277,30 @@ public:
   ~ChessHidManager();
 };
 
+// a board found by ChessHidConnect::enumerate
+struct ChessHidDevice {
+  // hidapi path of the device, see ChessLink::fromHidPath
+  string path;
+
+  uint16_t productId;
+
+  // USB serial number, empty if the board reports none
+  string serial;
+
+  // USB interface of the board's HID device, -1 if unknown
+  int interfaceNumber;
+};
+
+// a HID device as hid_enumerate reports it, for ChessHidConnect::boards
+struct ChessHidInfo {
+  string path;
+  uint16_t vendorId;
+  uint16_t productId;
+  uint16_t usagePage;
+  string serial;
+  int interfaceNumber;
+};
+
 class ChessHidConnect : public ChessHardConnect {
 private:
   static unique_ptr<ChessHidManager> HidManager;
@@ -98,8 +308,16 @@ private:
   // hid device handle
   hid_device *handle;
 
+  // device to open, both empty to open the first board found
+  string path;
+  string serial;
+
 public:
-  ChessHidConnect();
+  /**
+  path opens that device, serial the board with that serial number wherever
+  it is plugged in; with neither the first board found is opened
+  */
+  ChessHidConnect(string path = "", string serial = "");
   ~ChessHidConnect();
 
   // overload
@@ -118,32 +336,220 @@ public:
   list all device
   */
   static vector<string> listDevice(void);
+
+  /**
+  list all boards with their path, product id, serial number and interface
+  */
+  static vector<ChessHidDevice> enumerate(void);
+
+  /**
+  returns true if a HID device with these ids may be the board, its usage page
+  is only known once it is enumerated
+  */
+  static bool isBoard(uint16_t vendorId, uint16_t productId);
+
+  /**
+  keep the boards among the devices hid_enumerate reported, in their order
+  Returns the boards found
+  */
+  static vector<ChessHidDevice> boards(const vector<ChessHidInfo> &devices);
+
+  /**
+  pick the device to open: path if it is set, which is opened as given, else
+  the first board with that serial number, else the first board
+  Returns its path, empty if no board matches
+  */
+  static string select(const vector<ChessHidDevice> &boards, const string &path, const string &serial);
 };
 
-template <class T> class channel {
-  T buffer;
-  mutex buffer_mutex;
-  condition_variable read_cond;
+#ifdef __linux__
+/**
+Linux transport that talks to the board's /dev/hidrawN node directly instead
+of through hidapi. The node is opened non-blocking and its descriptor is
+waited on by the read thread's reactor, so every report costs one wake-up and
+one read, and no read has to time out.
+*/
+class ChessHidrawConnect : public ChessHardConnect {
+private:
+  // node to open, empty to search for the board on every connect
+  string path;
+
+  // open node, -1 if not connected; b_fd reads it from other threads
+  atomic<int> fd;
 
 public:
-  void write(T data) {
-    mutex_lock lock(buffer_mutex);
-    buffer = data;
-    read_cond.notify_all();
-  }
-
-  T read() {
-    mutex_lock lock(buffer_mutex);
-    read_cond.wait_for(lock, chrono::milliseconds(1000));
-    T item = buffer;
-    return item;
-  }
+  ChessHidrawConnect(string path = "");
+  ~ChessHidrawConnect();
+
+  // overload
+  bool b_connect(void);
+
+  // overload
+  void b_disconnect(void);
+
+  // overload
+  int b_read(unsigned char *data, size_t length);
+
+  // overload
+  int b_write(const unsigned char *data, size_t length);
+
+  // overload
+  int b_fd(void);
+
+  /**
+  list the hidraw nodes of all boards, found through sysfs
+  */
+  static vector<string> listDevice(void);
+};
+#endif
+
+// report received in response to a query, empty if the query failed
+using Response = vector<unsigned char>;
+
+// completion handle of a query
+using ResponseHandle = shared_future<Response>;
+
+// called on the read thread with the response of a query
+using ResponseCallback = function<void(const Response &)>;
+
+// counters of a ChessRequests table
+struct ChessRequestStats {
+  // reports that completed a request waiting for their opcode
+  uint64_t matched;
+
+  // reports that completed a request waiting for another opcode, see
+  // ChessRequests::allowFallback
+  uint64_t fallbacks;
+
+  // reports that completed no request
+  uint64_t unmatched;
+};
+
+/**
+Table of queries waiting for their response, keyed by response opcode.
+The board answers the queries of one opcode in the order they were sent, so
+every response completes the oldest query waiting for its opcode.
+Where the response opcode of a query is not known for certain, a report that
+no request waits for completes the oldest of those queries instead, like the
+single response slot of the original SDK did.
+*/
+class ChessRequests {
+private:
+  struct Pending {
+    uint64_t id;
+    promise<Response> done;
+    ResponseCallback callback;
+  };
+
+  mutex pendingMutex;
+
+  array<deque<Pending>, 256> pending;
+
+  // response opcodes whose requests also take reports of other opcodes
+  bitset<256> fallback;
+
+  uint64_t nextId;
+
+  atomic<uint64_t> matchedCount;
+  atomic<uint64_t> fallbackCount;
+  atomic<uint64_t> unmatchedCount;
+
+  // complete a request outside of pendingMutex
+  static void resolve(Pending &request, const Response &response);
+
+public:
+  ChessRequests();
+
+  /**
+  let the requests waiting for a response opcode be completed by a report
+  that no request waits for, oldest request first
+  */
+  void allowFallback(unsigned char opcode);
+
+  /**
+  register a request waiting for a response opcode
+  handle, if set, receives the completion handle, callback is called on
+  completion
+  Returns the id of the request
+  */
+  uint64_t add(unsigned char opcode, ResponseHandle *handle, ResponseCallback callback = nullptr);
+
+  /**
+  complete the oldest request waiting for the opcode of a report, or if there
+  is none and fallback is set, the oldest request that allows a fallback
+  Returns true if a request was completed, false otherwise
+  */
+  bool complete(const unsigned char *data, size_t length, bool fallback = true);
+
+  /**
+  fail a request with an empty response, if it has not completed yet
+  */
+  void cancel(unsigned char opcode, uint64_t id);
+
+  /**
+  fail all pending requests, e.g. when the board disconnects
+  */
+  void cancelAll(void);
+
+  /**
+  returns the counters
+  */
+  ChessRequestStats stats(void) const;
+};
+
+// called on an SDK thread with the positions of a game file, empty on failure
+using FileCallback = function<void(vector<string>)>;
+
+// called on an SDK thread with the raw positions of a game file, empty on
+// failure
+using GameFileCallback = function<void(ChessGameFile)>;
+
+// called on the read thread with each position of a game file as it arrives,
+// PACKED_BOARD_SIZE bytes that are only valid during the call
+using FilePositionCallback = function<void(const unsigned char *board)>;
+
+// receives the games downloaded by ChessLink::drainAllGames on the read
+// thread, games are numbered from 0 in the order they are downloaded
+struct ChessGameSink {
+  // a position of a game, PACKED_BOARD_SIZE bytes only valid during the call
+  function<void(size_t game, const unsigned char *board)> onPosition;
+
+  // a game was downloaded completely, optional
+  function<void(size_t game, size_t positions)> onGame;
 };
 
+// board information gathered by ChessLink::queryDeviceInfo
+struct ChessDeviceInfo {
+  // empty if the query failed
+  string mcuVersion;
+  string bleVersion;
+
+  // battery level 0-100, -1 if the query failed
+  int battery;
+
+  // number of stored game files, -1 if the query failed
+  int fileCount;
+};
+
+#ifdef CHESS_IO_URING
+class ChessUringLoop;
+#endif
+
 class ChessLink {
 private:
+  // drives links created by ChessLinkHub::attach
+  friend class ChessLinkHub;
+
+#ifdef CHESS_IO_URING
+  // drives links created by fromUringLoop
+  friend class ChessUringLoop;
+#endif
+
   ChessLink(ChessHardConnect *chess_connect);
 
+  // create a ChessLink on a transport and start its read thread
+  static shared_ptr<ChessLink> fromConnect(ChessHardConnect *chess_connect);
+
   // chess board mode
   // 0 is Real Time Mode
   // 1 is Upload Mode
@@ -163,14 +569,56 @@ private:
   // the status of file transfer mode
   atomic_bool fileTransfer;
 
-  // the file content
-  vector<string> fileContent;
-
-  // file transfer mutex
+  // file transfer mutex, guards fileRequests and activeFile
   mutex fileMutex;
 
-  // file transfer condition variable
-  condition_variable fileCV;
+  // a game file download
+  struct FileRequest {
+    // called for every position of the file
+    FilePositionCallback onPosition;
+
+    // called once the transfer ended, with the number of positions or -1 if
+    // it failed, and the handle of the delete command if one was sent
+    function<void(int, WriteHandle)> onDone;
+
+    bool is_delete;
+
+    // the call waiting for the download, for abandonFile; nullptr if the
+    // download is never abandoned
+    const void *owner;
+  };
+
+  // downloads waiting for their transfer, started in order
+  deque<FileRequest> fileRequests;
+
+  // download whose transfer is running, and its positions so far, which are
+  // only counted by the read thread
+  FileRequest activeFile;
+  int activePositions;
+
+  // how long getFileStream and drainAllGames wait for the board, millisecond
+  atomic<uint32_t> fileTimeoutMs;
+
+  // queue a download and request the next file from the board
+  void startFile(FileRequest request);
+
+  // same as startFile for a board that is already in upload mode
+  void queueFile(FileRequest request);
+
+  // state of a drainAllGames call and the download of its next game
+  struct GameDrain;
+  void drainNext(shared_ptr<GameDrain> drain);
+
+  // complete the running download, positions is -1 if it failed
+  void finishFile(int positions);
+
+  // fail all downloads that have not started yet
+  void failFileRequests(void);
+
+  // drop the downloads of a call that stopped waiting for them, whether
+  // queued or running, so that their upload is neither handed to the next
+  // download nor deleted
+  void abandonFile(const void *owner);
 
   /**
   switch mode
@@ -186,8 +634,26 @@ private:
   // The callback function for receiving data in the Real Time Mode
   RealTimeCallback rCallback;
 
-  // change real data to fen
-  static string toFen(unsigned char *, size_t length);
+  // The callback function for receiving raw positions in the Real Time Mode
+  BoardCallback bCallback;
+
+  // The callback function for receiving bitboard positions in the Real Time Mode
+  BoardStateCallback sCallback;
+
+  // The callback function for receiving lift and place events in the Real Time Mode
+  SquareEventCallback eCallback;
+
+  // previous realtime position the events are derived from, only used by the
+  // read thread
+  BoardState lastState;
+  bool hasLastState;
+
+  // The callback function for receiving moves in the Real Time Mode
+  MoveCallback mCallback;
+
+  // game state of the realtime positions
+  ChessMoveTracker tracker;
+  mutex trackerMutex;
 
   // led status
   array<bitset<8>, 8> ledStatus;
@@ -196,13 +662,73 @@ private:
   mutex ledMutex;
 
   // set led status internal
-  bool setLedInternal();
+  WriteHandle setLedInternal(WriteCallback callback = nullptr);
+
+  // event loop of the read thread, only created for links that have one
+  unique_ptr<ChessReactor> reactor;
+
+  // wake the thread that drives the link, see ChessHardConnect::b_wake
+  void wake(void);
+
+  // tells the read thread when a board may have been plugged in, open while
+  // the board is absent
+  ChessHotplug hotplug;
+
+  // reconnect schedule while the board is absent
+  ChessReconnect reconnect;
 
-  // data channl
-  channel<vector<unsigned char>> data;
+  // handle the result of a device read, res bytes of data, negative if the
+  // device failed
+  void receive(const unsigned char *data, int res, uint64_t timestamp);
 
-  // battery data channl
-  channel<vector<unsigned char>> batteryData;
+  // timers of the thread that drives the link: settles the debounce while
+  // connected, otherwise reconnects; monitored tells whether a hotplug
+  // monitor reports added boards through plugged, if not every call tries
+  // to connect
+  // Returns the milliseconds until it wants to run again
+  int service(uint64_t now, bool monitored);
+
+  // a board may have been plugged in, retry connecting for a while
+  void plugged(uint64_t now);
+
+  // number of times the read thread woke up
+  atomic<uint64_t> readWakeups;
+
+  // splits and reassembles the reports read from the board into messages
+  ChessFrameDecoder decoder;
+
+  // drops repeated realtime positions
+  ChessBoardFilter filter;
+
+  // holds back realtime positions until they are stable
+  ChessBoardDebounce debounce;
+
+  // hand a realtime position on to the callbacks
+  void deliverBoard(const unsigned char *packed, uint64_t timestamp);
+
+  // deliver the pending realtime position if its debounce window elapsed by
+  // now; returns the milliseconds the read thread may wait for the next one
+  int settleBoard(uint64_t now);
+
+  // handle one message received by the read thread at timestamp
+  void dispatch(const unsigned char *data, size_t length, uint64_t timestamp);
+
+  // queries waiting for their response
+  ChessRequests requests;
+
+  // send and register a query, see query; written receives the write handle
+  uint64_t sendQuery(const unsigned char *data, size_t length, unsigned char response, ResponseHandle *handle,
+                     WriteHandle *written, ResponseCallback callback = nullptr);
+
+  // wait for a query sent by sendQuery, bounded by RESPONSE_TIMEOUT once its
+  // command has been written
+  Response awaitQuery(unsigned char response, uint64_t id, const ResponseHandle &handle, const WriteHandle &written);
+
+  /**
+  send a query and wait for its response, bounded by RESPONSE_TIMEOUT
+  Returns the response report, empty on failure
+  */
+  Response queryWait(const unsigned char *data, size_t length, unsigned char response);
 
 public:
   ~ChessLink();
@@ -236,16 +762,75 @@ public:
   */
   void setRealTimeCallback(RealTimeCallback callback);
 
+  /**
+  set callback for receiving raw positions in the Real Time Mode
+  the callback gets the packed board without any string formatting or
+  allocation, ChessBoardDecoder can expand it into 64 pieces
+  */
+  void setBoardCallback(BoardCallback callback);
+
+  /**
+  set callback for receiving positions as bitboards in the Real Time Mode
+  the position is decoded once per frame and only if a callback is set
+  */
+  void setBoardStateCallback(BoardStateCallback callback);
+
+  /**
+  set callback for receiving square events in the Real Time Mode
+  every realtime frame that differs from the previous one yields a lift event
+  for each piece that left a square and a place event for each piece that
+  arrived on one; the first frame only sets the starting position
+  */
+  void setSquareEventCallback(SquareEventCallback callback);
+
+  /**
+  set callback for receiving moves in the Real Time Mode
+  the realtime positions are tracked as a game starting from the initial
+  position, see ChessMoveTracker; positions only reachable by an illegal move
+  are ignored until the board matches the game again
+  */
+  void setMoveCallback(MoveCallback callback);
+
+  /**
+  start tracking a new game, from the initial position or from the current
+  position on the board with the given side to move
+  */
+  void resetMoveTracker(void);
+  void resetMoveTracker(const BoardState &board, bool whiteToMove);
+
+  /**
+  returns the full FEN of the tracked game, including side to move, castling
+  rights and en passant square
+  */
+  string getTrackedFen(void);
+
   /**
   Control the buzzer to sound
   frequency is sound frequency, 1-65535
   duration is duration of sound, millisecond
-  Returns true if success, false otherwise
+  The command is queued and this call does not wait for it to be sent
+  Returns true if the command was queued, false otherwise
   */
   bool beep(const uint16_t frequency = 1000, const uint16_t duration = 200);
 
+  /**
+  Control the buzzer to sound, like beep
+  callback, if set, is called on the writer thread once the command was sent
+  Returns a handle that completes once the command has been sent
+  */
+  WriteHandle beepAsync(const uint16_t frequency = 1000, const uint16_t duration = 200,
+                        WriteCallback callback = nullptr);
+
+  /**
+  Control led light, like setLed
+  callback, if set, is called on the writer thread once the command was sent
+  Returns a handle that completes once the command has been sent
+  */
+  WriteHandle setLedAsync(const array<bitset<8>, 8>, WriteCallback callback = nullptr);
+
   /**
   Control led light
+  All setLed overloads queue the command and do not wait for it to be sent
   example:
   setLed({
         bitset<8>("10000000"), //
@@ -300,6 +885,65 @@ public:
    */
   bool setLed(uint8_t x, uint8_t y, bool status);
 
+  /**
+  returns how many times the read thread has woken up, for measuring idle
+  wakeups per second
+  */
+  uint64_t getReadWakeups();
+
+  /**
+  send a query without waiting for it
+  response is the opcode of the expected answer, callback, if set, is called
+  on the read thread with the answer
+  pending queries fail with an empty response when the command cannot be sent
+  or the board disconnects
+  Returns a handle that completes as soon as the answer arrives
+  */
+  ResponseHandle query(const unsigned char *data, size_t length, unsigned char response,
+                       ResponseCallback callback = nullptr);
+
+  /**
+  returns the counters of the frame decoder: messages delivered, bytes
+  skipped to resync and malformed messages dropped
+  */
+  ChessFrameStats getFrameStats();
+
+  /**
+  returns the counters of the query responses: reports that answered a query
+  by their opcode, that answered a query by fallback and that answered none
+  */
+  ChessRequestStats getRequestStats();
+
+  /**
+  enable or disable dropping realtime positions that repeat the last
+  delivered one, which is enabled by default
+  heartbeatMs, if not 0, delivers an unchanged position anyway once every
+  heartbeatMs milliseconds
+  */
+  void setDuplicateSuppression(bool enabled, uint32_t heartbeatMs = 0);
+
+  /**
+  returns the number of realtime positions delivered to the callbacks and
+  dropped as duplicates
+  */
+  ChessBoardFilterStats getBoardStats();
+
+  /**
+  hold back realtime positions until they are stable, i.e. reported
+  unchanged for windowMs milliseconds or in frames consecutive frames,
+  whichever comes first, so that the positions a sliding piece passes
+  through are not delivered
+  0 turns a criterion off, 0 for both turns the debounce off, which is the
+  default
+  */
+  void setDebounce(uint32_t windowMs, uint32_t frames = 0);
+
+  /**
+  returns the number of frames the debounce absorbed and the number of
+  positions that became stable
+  */
+  ChessDebounceStats getDebounceStats();
+
   /**
   query ble version
   */
@@ -320,6 +964,13 @@ public:
   */
   uint32_t getFileCount();
 
+  /**
+  query mcu version, ble version, battery state and saved file count at once
+  all queries are sent back to back and the answers are gathered as they
+  arrive, so this takes about one round trip instead of four
+  */
+  ChessDeviceInfo queryDeviceInfo();
+
   /**
   start to get saved file, return list of fen
   this method will call switchUploadMode, chess board mode will change to upload
@@ -331,8 +982,115 @@ public:
   */
   vector<string> getFile(bool is_delete = true);
 
+  /**
+  get the next saved file as received, without building FENs
+  the read thread only copies each position into the file, FENs are built by
+  ChessGameFile when asked for
+  is_delete works as for getFile
+  Returns the positions, empty if there is no file or the transfer failed
+  */
+  ChessGameFile getGameFile(bool is_delete = true);
+
+  /**
+  get the next saved file position by position
+  onPosition is called on the read thread with each position as its frame
+  arrives, nothing is buffered; this call returns once the transfer ended
+  is_delete works as for getFile
+  Returns the number of positions, 0 if there is no file, -1 if the transfer
+  failed
+  */
+  int getFileStream(FilePositionCallback onPosition, bool is_delete = true);
+
+  /**
+  get the next saved file in the binary form of ChessGameEncoder, encoded
+  from the position frames as they arrive
+  is_delete works as for getFile
+  Returns the encoded game, empty if there is no file or the transfer failed
+  */
+  vector<unsigned char> getFileEncoded(bool is_delete = true);
+
+  /**
+  delete the saved file that getFile would return next, e.g. once a file
+  fetched with is_delete false has been stored
+  Returns once the command was written, true if it succeeded
+  */
+  bool deleteFile(void);
+
+  /**
+  download and delete every saved file in one upload mode session
+  the games are streamed to sink as their frames arrive; the board is
+  switched to upload mode and the file count queried once, and the delete of
+  each game is sent together with the request for the next one
+  Returns the number of games downloaded completely, fewer than were saved if
+  a transfer failed
+  */
+  int drainAllGames(ChessGameSink sink);
+
+  /**
+  set how long getFile, getFileStream and drainAllGames wait for the board
+  before the transfer fails, by default 120000 milliseconds
+  */
+  void setFileTimeout(uint32_t timeoutMs);
+
+  /**
+  Non-blocking variants of the queries above. The callback is called on an
+  SDK thread as soon as the answer arrives, with an empty string or -1 if the
+  query failed. Callbacks must not call the blocking methods of the same
+  ChessLink, since they run on the threads those methods wait for.
+  */
+  void getMcuVersionAsync(function<void(string)> callback);
+  void getBleVersionAsync(function<void(string)> callback);
+  void getBatteryAsync(function<void(int)> callback);
+  void getFileCountAsync(function<void(int)> callback);
+
+  /**
+  Non-blocking variant of getFile, the callback is called on the read thread
+  once the transfer has finished, with an empty list if there is no file or
+  the transfer failed
+  */
+  void getFileAsync(FileCallback callback, bool is_delete = true);
+
+  /**
+  Non-blocking variant of getGameFile, the callback is called on the read
+  thread once the transfer has finished, with an empty file if there is no
+  file or the transfer failed
+  */
+  void getGameFileAsync(GameFileCallback callback, bool is_delete = true);
+
   /**
   Create ChessLink from HID connect mode
   */
   static shared_ptr<ChessLink> fromHidConnect(void);
+
+  /**
+  Create ChessLink on one board, path is the path of a ChessHidDevice
+  returned by ChessHidConnect::enumerate
+  */
+  static shared_ptr<ChessLink> fromHidPath(string path);
+
+  /**
+  Create ChessLink on the board with a serial number, which is looked up on
+  every connect, so that the link follows the board to another port
+  */
+  static shared_ptr<ChessLink> fromHidSerial(string serial);
+
+  /**
+  Create ChessLink that reads and writes the board's hidraw node directly,
+  see ChessHidrawConnect; on other platforms than Linux this is
+  fromHidConnect, or fromHidPath if path is set
+  path is the node to open, empty to open the first board found
+  */
+  static shared_ptr<ChessLink> fromHidrawConnect(string path = "");
+
+#ifdef CHESS_IO_URING
+  /**
+  Create ChessLink on a board driven by loop, see ChessUringLoop
+  path is the board's hidraw node, empty to open the first board found
+  whenever it connects; the link has no threads of its own, its callbacks run
+  on the loop thread
+  */
+  static shared_ptr<ChessLink> fromUringLoop(shared_ptr<ChessUringLoop> loop, string path = "");
+#endif
 };
+
+#endif // CHESS_EASY_LINK_HEADER_GUARD
@@ -10,6 +10,37 @@ mutex initMutex;
 // realtime callback
 cl_realtimeCallback rCallback = nullptr;
 
+// raw realtime board callback
+cl_boardCallback bCallback = nullptr;
+
+// square event callback
+cl_squareEventCallback eCallback = nullptr;
+
+// move callback
+cl_moveCallback mCallback = nullptr;
+
+// game files deleted so far, a file handle opened before the last deletion
+// no longer refers to the next game file; changed from any caller's thread
+atomic<size_t> fileDeletions(0);
+
+// game file retrieved by cl_file_open
+struct cl_file {
+  string content;
+  size_t deletions;
+};
+
+// join the FENs of a game file with ';'
+static string joinFile(const vector<string> &file) {
+  string tmp;
+  for (const auto &i : file) {
+    if (!tmp.empty()) {
+      tmp += ";";
+    }
+    tmp += i;
+  }
+  return tmp;
+}
+
 size_t cl_version(char *version) {
   if (version) {
     strncpy(version, CL_VERSION.c_str(), CL_VERSION.length());
@@ -27,6 +58,55 @@ int cl_connect() {
   return bChessLink->connect();
 }
 
+int cl_connect_hidraw() {
+  lock_guard<mutex> lock(initMutex);
+
+  if (bChessLink == nullptr) {
+    bChessLink = ChessLink::fromHidrawConnect();
+  }
+
+  return bChessLink->connect();
+}
+
+int cl_list_boards(cl_hid_device *boards, size_t len) {
+  auto devices = ChessHidConnect::enumerate();
+  for (size_t i = 0; boards && i < devices.size() && i < len; i++) {
+    auto &device = devices[i];
+    memset(&boards[i], 0, sizeof(cl_hid_device));
+    strncpy(boards[i].path, device.path.c_str(), sizeof(boards[i].path) - 1);
+    boards[i].product_id = device.productId;
+    strncpy(boards[i].serial, device.serial.c_str(), sizeof(boards[i].serial) - 1);
+    boards[i].interface_number = device.interfaceNumber;
+  }
+  return static_cast<int>(devices.size());
+}
+
+int cl_connect_path(const char *path) {
+  if (path == nullptr || *path == '\0') {
+    return false;
+  }
+  lock_guard<mutex> lock(initMutex);
+
+  if (bChessLink == nullptr) {
+    bChessLink = ChessLink::fromHidPath(path);
+  }
+
+  return bChessLink->connect();
+}
+
+int cl_connect_serial(const char *serial) {
+  if (serial == nullptr || *serial == '\0') {
+    return false;
+  }
+  lock_guard<mutex> lock(initMutex);
+
+  if (bChessLink == nullptr) {
+    bChessLink = ChessLink::fromHidSerial(serial);
+  }
+
+  return bChessLink->connect();
+}
+
 void cl_disconnect() {
   lock_guard<mutex> lock(initMutex);
 
@@ -65,6 +145,125 @@ void cl_set_readtime_callback(cl_realtimeCallback callback) {
   }
 }
 
+void cl_set_board_callback(cl_boardCallback callback) {
+  if (bChessLink == nullptr) {
+    return;
+  }
+  bCallback = callback;
+  if (bCallback == nullptr) {
+    bChessLink->setBoardCallback(nullptr);
+  } else {
+    bChessLink->setBoardCallback([](const uint8_t *board, uint64_t timestamp) {
+      if (bCallback) {
+        bCallback(board, timestamp);
+      }
+    });
+  }
+}
+
+void cl_set_square_event_callback(cl_squareEventCallback callback) {
+  if (bChessLink == nullptr) {
+    return;
+  }
+  eCallback = callback;
+  if (eCallback == nullptr) {
+    bChessLink->setSquareEventCallback(nullptr);
+  } else {
+    bChessLink->setSquareEventCallback([](const ChessSquareEvent *events, size_t count) {
+      auto callback = eCallback;
+      if (callback) {
+        cl_square_event converted[SQUARE_EVENTS_MAX];
+        for (size_t i = 0; i < count; i++) {
+          converted[i] = {events[i].square, events[i].piece, events[i].type, events[i].timestamp};
+        }
+        callback(converted, count);
+      }
+    });
+  }
+}
+
+void cl_set_move_callback(cl_moveCallback callback) {
+  if (bChessLink == nullptr) {
+    return;
+  }
+  mCallback = callback;
+  if (mCallback == nullptr) {
+    bChessLink->setMoveCallback(nullptr);
+  } else {
+    bChessLink->setMoveCallback([](const ChessMove &move, uint64_t timestamp) {
+      auto callback = mCallback;
+      if (callback) {
+        cl_move converted = {move.from, move.to, move.piece, move.captured, move.promotion, move.flags, {}, timestamp};
+        auto uci = move.uci();
+        strncpy(converted.uci, uci.c_str(), sizeof(converted.uci) - 1);
+        callback(&converted);
+      }
+    });
+  }
+}
+
+int cl_reset_moves() {
+  if (bChessLink == nullptr) {
+    return false;
+  }
+  bChessLink->resetMoveTracker();
+  return true;
+}
+
+int cl_get_tracked_fen(char *fen, size_t len) {
+  if (bChessLink == nullptr || fen == nullptr) {
+    return -1;
+  }
+  auto tracked = bChessLink->getTrackedFen();
+  if (tracked.size() >= len) {
+    return -2;
+  }
+  strncpy(fen, tracked.c_str(), len);
+  return static_cast<int>(tracked.size());
+}
+
+void cl_unpack_board(const unsigned char *board, char *squares) {
+  if (board && squares) {
+    ChessBoardDecoder::unpack(board, squares);
+  }
+}
+
+int cl_set_duplicate_suppression(int enabled, unsigned int heartbeatMs) {
+  if (bChessLink == nullptr) {
+    return false;
+  }
+  bChessLink->setDuplicateSuppression(enabled != 0, heartbeatMs);
+  return true;
+}
+
+int cl_board_stats(unsigned long long *delivered, unsigned long long *suppressed) {
+  if (bChessLink == nullptr || delivered == nullptr || suppressed == nullptr) {
+    return false;
+  }
+  auto stats = bChessLink->getBoardStats();
+  *delivered = stats.delivered;
+  *suppressed = stats.suppressed;
+  return true;
+}
+
+int cl_set_debounce(unsigned int windowMs, unsigned int frames) {
+  if (bChessLink == nullptr) {
+    return false;
+  }
+  bChessLink->setDebounce(windowMs, frames);
+  return true;
+}
+
+int cl_debounce_stats(unsigned long long *absorbed, unsigned long long *settled) {
+  if (bChessLink == nullptr || absorbed == nullptr || settled == nullptr) {
+    return false;
+  }
+  auto stats = bChessLink->getDebounceStats();
+  *absorbed = stats.absorbed;
+  *settled = stats.settled;
+  return true;
+}
+
 int cl_beep(unsigned short frequencyHz, unsigned short durationMs) {
   if (bChessLink == nullptr) {
     return false;
@@ -72,6 +271,26 @@ int cl_beep(unsigned short frequencyHz, unsigned short durationMs) {
   return bChessLink->beep(frequencyHz, durationMs);
 }
 
+int cl_set_pacing(int opcode, unsigned int intervalMs, unsigned int burst) {
+  if (bChessLink == nullptr || opcode < -1 || opcode > 0xff) {
+    return false;
+  }
+  if (opcode == -1) {
+    bChessLink->device->setDefaultPacing(intervalMs, burst);
+  } else {
+    bChessLink->device->setPacing(static_cast<unsigned char>(opcode), intervalMs, burst);
+  }
+  return true;
+}
+
+int cl_clear_pacing(int opcode) {
+  if (bChessLink == nullptr || opcode < 0 || opcode > 0xff) {
+    return false;
+  }
+  bChessLink->device->clearPacing(static_cast<unsigned char>(opcode));
+  return true;
+}
+
 int cl_led(const char *leds[8]) {
   if (bChessLink == nullptr) {
     return false;
@@ -126,6 +345,31 @@ int cl_get_file_count() {
   return bChessLink->getFileCount();
 }
 
+int cl_query_device_info(cl_device_info *info) {
+  if (bChessLink == nullptr || info == nullptr) {
+    return false;
+  }
+  const auto i = bChessLink->queryDeviceInfo();
+  info->mcu_version_len = min(i.mcuVersion.length(), sizeof(info->mcu_version));
+  strncpy(info->mcu_version, i.mcuVersion.c_str(), info->mcu_version_len);
+  info->ble_version_len = min(i.bleVersion.length(), sizeof(info->ble_version));
+  strncpy(info->ble_version, i.bleVersion.c_str(), info->ble_version_len);
+  info->battery = i.battery;
+  info->file_count = i.fileCount;
+  return info->mcu_version_len > 0 || info->ble_version_len > 0 || info->battery >= 0 || info->file_count >= 0;
+}
+
+int cl_request_stats(unsigned long long *matched, unsigned long long *fallbacks, unsigned long long *unmatched) {
+  if (bChessLink == nullptr || matched == nullptr || fallbacks == nullptr || unmatched == nullptr) {
+    return false;
+  }
+  auto stats = bChessLink->getRequestStats();
+  *matched = stats.matched;
+  *fallbacks = stats.fallbacks;
+  *unmatched = stats.unmatched;
+  return true;
+}
+
 int cl_get_file_and_should_delete(char *game_data, size_t len, bool is_delete_file) {
   if (bChessLink == nullptr) {
     return -1;
@@ -133,15 +377,10 @@ int cl_get_file_and_should_delete(char *game_data, size_t len, bool is_delete_fi
 
   const auto file = bChessLink->getFile(is_delete_file);
   if (!file.empty()) {
-    string tmp;
-    for (const auto &i : file) {
-      if (tmp.empty()) {
-        tmp += i;
-      } else {
-        tmp += ";";
-        tmp += i;
-      }
+    if (is_delete_file) {
+      fileDeletions++;
     }
+    auto tmp = joinFile(file);
     if (tmp.size() < len) {
       strncpy(game_data, tmp.c_str(), tmp.size());
       return static_cast<int>(tmp.size());
@@ -155,10 +394,158 @@ int cl_get_file_and_should_delete(char *game_data, size_t len, bool is_delete_fi
 
 int cl_get_file(char *game_data, size_t len) { return cl_get_file_and_should_delete(game_data, len, true); }
 
+int cl_game_moves(const char *game_data, char *moves, size_t len) {
+  if (game_data == nullptr || moves == nullptr) {
+    return -1;
+  }
+  vector<string> file;
+  for (const char *start = game_data;;) {
+    const char *end = strchr(start, ';');
+    if (end == nullptr) {
+      file.emplace_back(start);
+      break;
+    }
+    file.emplace_back(start, end);
+    start = end + 1;
+  }
+
+  string tmp;
+  for (const auto &move : ChessMoveTracker::replay(file)) {
+    if (!tmp.empty()) {
+      tmp += " ";
+    }
+    tmp += move.uci();
+  }
+  if (tmp.size() >= len) {
+    return -2;
+  }
+  strncpy(moves, tmp.c_str(), len);
+  return static_cast<int>(tmp.size());
+}
+
 int cl_get_file_and_delete(char *game_data, size_t len) { return cl_get_file_and_should_delete(game_data, len, true); }
 
 int cl_get_file_and_keep(char *game_data, size_t len) { return cl_get_file_and_should_delete(game_data, len, false); }
 
+int cl_get_file_stream(cl_filePositionCallback callback, int delete_file) {
+  if (bChessLink == nullptr || callback == nullptr) {
+    return -1;
+  }
+  size_t index = 0;
+  auto positions = bChessLink->getFileStream(
+      [callback, &index](const unsigned char *board) { callback(board, index++); }, delete_file != 0);
+  if (positions > 0 && delete_file != 0) {
+    fileDeletions++;
+  }
+  return positions;
+}
+
+int cl_get_file_encoded(unsigned char *data, size_t len, int delete_file) {
+  if (bChessLink == nullptr || data == nullptr) {
+    return -1;
+  }
+  // kept until it is known to fit, then deleted
+  const auto file = bChessLink->getFileEncoded(false);
+  if (file.empty()) {
+    return 0;
+  }
+  if (file.size() > len) {
+    return -2;
+  }
+  memcpy(data, file.data(), file.size());
+  if (delete_file != 0) {
+    if (!bChessLink->deleteFile()) {
+      return -1;
+    }
+    fileDeletions++;
+  }
+  return static_cast<int>(file.size());
+}
+
+int cl_decode_game(const unsigned char *data, size_t size, char *game_data, size_t len) {
+  if (data == nullptr || game_data == nullptr) {
+    return -1;
+  }
+  const auto file = ChessGameDecoder::toFen(data, size);
+  if (file.empty()) {
+    return -1;
+  }
+  auto tmp = joinFile(file);
+  if (tmp.size() >= len) {
+    return -2;
+  }
+  strncpy(game_data, tmp.c_str(), len);
+  return static_cast<int>(tmp.size());
+}
+
+int cl_drain_all_games(cl_gamePositionCallback on_position, cl_gameCallback on_game) {
+  if (bChessLink == nullptr || on_position == nullptr) {
+    return -1;
+  }
+  size_t index = 0;
+  ChessGameSink sink;
+  sink.onPosition = [on_position, &index](size_t game, const unsigned char *board) {
+    on_position(game, board, index++);
+  };
+  sink.onGame = [on_game, &index](size_t game, size_t positions) {
+    index = 0;
+    if (on_game) {
+      on_game(game, positions);
+    }
+  };
+  auto games = bChessLink->drainAllGames(move(sink));
+  fileDeletions += static_cast<size_t>(games);
+  return games;
+}
+
+cl_file *cl_file_open(size_t *size) {
+  if (size) {
+    *size = 0;
+  }
+  if (bChessLink == nullptr) {
+    return nullptr;
+  }
+  const auto file = bChessLink->getFile(false);
+  if (file.empty()) {
+    return nullptr;
+  }
+  auto handle = new cl_file{joinFile(file), fileDeletions};
+  if (size) {
+    *size = handle->content.size() + 1;
+  }
+  return handle;
+}
+
+int cl_file_read(cl_file *file, char *game_data, size_t len) {
+  if (file == nullptr || game_data == nullptr) {
+    return -1;
+  }
+  if (file->content.size() >= len) {
+    return -2;
+  }
+  memcpy(game_data, file->content.c_str(), file->content.size() + 1);
+  return static_cast<int>(file->content.size());
+}
+
+int cl_file_commit_delete(cl_file *file) {
+  if (bChessLink == nullptr || file == nullptr) {
+    return -1;
+  }
+  // claim the deletion before sending it, so that two handles of the same
+  // file cannot both delete; a failed command still invalidates the other
+  // handles, which then have to open the file again
+  auto deletions = file->deletions;
+  if (!fileDeletions.compare_exchange_strong(deletions, deletions + 1)) {
+    return -2;
+  }
+  if (!bChessLink->deleteFile()) {
+    return 0;
+  }
+  return 1;
+}
+
+void cl_file_close(cl_file *file) { delete file; }
+
 void testChess() {
   {
 
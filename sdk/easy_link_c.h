@@ -33,6 +33,73 @@ EXTERN_FLAGS size_t ABI cl_version(char *version);
  */
 EXTERN_FLAGS int ABI cl_connect();
 
+/**
+ * \brief Connect to the chess board through its Linux hidraw node, without
+ * hidapi.
+ *
+ * Works like `cl_connect()`, but reports are read from `/dev/hidrawN` as soon
+ * as they arrive instead of through hidapi's polling reads. The calling user
+ * needs read and write access to the node. On other platforms than Linux this
+ * is `cl_connect()`. The transport is chosen by the first call of any
+ * `cl_connect` function and kept afterwards.
+ *
+ * @return 0 (false) on failure, 1 (true) on success
+ */
+EXTERN_FLAGS int ABI cl_connect_hidraw();
+
+/**
+ * \brief A chess board found by `cl_list_boards()`.
+ */
+typedef struct cl_hid_device {
+  /** Path of the board's HID device, NUL-terminated, pass it to `cl_connect_path()`. */
+  char path[512];
+  /** USB product id. */
+  unsigned short product_id;
+  /** USB serial number, NUL-terminated UTF-8, empty if the board reports none. */
+  char serial[128];
+  /** USB interface number of the HID device, -1 if unknown. */
+  int interface_number;
+} cl_hid_device;
+
+/**
+ * \brief List the chess boards plugged into the computer.
+ *
+ * Does not need a connection, use it to choose the board for
+ * `cl_connect_path()` or `cl_connect_serial()` when several are plugged in.
+ *
+ * @param boards Receives up to `len` boards. May be NULL if `len` is 0.
+ * @param len Number of entries `boards` has room for.
+ * @return The number of boards found, which may be larger than `len`
+ */
+EXTERN_FLAGS int ABI cl_list_boards(cl_hid_device *boards, size_t len);
+
+/**
+ * \brief Connect to the chess board with a HID device path.
+ *
+ * Works like `cl_connect()`, but opens only the device at `path`, as listed
+ * by `cl_list_boards()`, instead of the first board found. The board and
+ * transport are chosen by the first call of any `cl_connect` function and
+ * kept afterwards.
+ *
+ * @param path Path of the board's HID device.
+ * @return 0 (false) on failure, 1 (true) on success
+ */
+EXTERN_FLAGS int ABI cl_connect_path(const char *path);
+
+/**
+ * \brief Connect to the chess board with a USB serial number.
+ *
+ * Works like `cl_connect()`, but opens only the board whose serial number
+ * is `serial`. The board is looked up again on every reconnect, so the
+ * connection follows it when it is plugged into another port. The board and
+ * transport are chosen by the first call of any `cl_connect` function and
+ * kept afterwards.
+ *
+ * @param serial Serial number of the board, as listed by `cl_list_boards()`.
+ * @return 0 (false) on failure, 1 (true) on success
+ */
+EXTERN_FLAGS int ABI cl_connect_serial(const char *serial);
+
 /**
  * \brief Disconnect from the chess board.
  */
@@ -73,6 +140,192 @@ typedef void(ABI *cl_realtimeCallback)(const char *fen, size_t len);
  */
 EXTERN_FLAGS void ABI cl_set_readtime_callback(cl_realtimeCallback callback);
 
+/**
+ * \brief Type definition for raw real-time board callback function.
+ *
+ * @param board     The packed board position, 32 bytes with one piece code
+ *                  per nibble. Only valid during the callback. Use
+ *                  `cl_unpack_board()` to expand it into 64 pieces.
+ * @param timestamp Monotonic time in microseconds at which the position was
+ *                  read from the board.
+ */
+typedef void(ABI *cl_boardCallback)(const unsigned char *board, unsigned long long timestamp);
+
+/**
+ * \brief Register a raw real-time board callback function.
+ *
+ * Unlike `cl_set_readtime_callback()`, the callback receives the position as
+ * sent by the board, without formatting it as a FEN string and without any
+ * memory allocation. Both callbacks can be registered at the same time.
+ *
+ * @param callback Callback function. Set to `NULL` pointer to disable the
+ *                 callback.
+ */
+EXTERN_FLAGS void ABI cl_set_board_callback(cl_boardCallback callback);
+
+/**
+ * \brief A piece lifted from or placed on a square.
+ */
+typedef struct cl_square_event {
+  /** Square, 0 is a1, 7 is h1 and 63 is h8. */
+  unsigned char square;
+  /** Piece code of the board: 1 q, 2 k, 3 b, 4 p, 5 n, 6 R, 7 P, 8 r, 9 B,
+      10 N, 11 Q, 12 K, using the FEN piece letters. */
+  unsigned char piece;
+  /** 0 if the piece was lifted, 1 if it was placed. */
+  unsigned char placed;
+  /** Monotonic time in microseconds at which the position was read. */
+  unsigned long long timestamp;
+} cl_square_event;
+
+/**
+ * \brief Type definition for square event callback function.
+ *
+ * @param events The events since the previous real-time position, all lifts
+ *               before all places. Only valid during the callback.
+ * @param count  Number of events.
+ */
+typedef void(ABI *cl_squareEventCallback)(const cl_square_event *events, size_t count);
+
+/**
+ * \brief Register a square event callback function.
+ *
+ * Instead of whole positions, the callback receives which pieces were lifted
+ * and placed since the previous real-time position, e.g. a lift on e2 and a
+ * place on e4 for the move e2e4. The first position after registering only
+ * sets the starting point.
+ *
+ * @param callback Callback function. Set to `NULL` pointer to disable the
+ *                 callback.
+ */
+EXTERN_FLAGS void ABI cl_set_square_event_callback(cl_squareEventCallback callback);
+
+/**
+ * \brief A move inferred from the real-time positions.
+ */
+typedef struct cl_move {
+  /** Squares the piece moved from and to, 0 is a1, 7 is h1 and 63 is h8. For
+      castling these are the king's squares. */
+  unsigned char from;
+  unsigned char to;
+  /** Piece codes as in `cl_square_event`; `captured` and `promotion` are 0 if
+      nothing was captured or promoted. */
+  unsigned char piece;
+  unsigned char captured;
+  unsigned char promotion;
+  /** Combination of 1 capture, 2 double pawn push, 4 en passant, 8 castling,
+      16 promotion. */
+  unsigned char flags;
+  /** The move in long algebraic notation as used by UCI, e.g. "e2e4" or
+      "e7e8q", NUL-terminated. */
+  char uci[6];
+  /** Monotonic time in microseconds of the position that completed the move. */
+  unsigned long long timestamp;
+} cl_move;
+
+/**
+ * \brief Type definition for move callback function.
+ *
+ * @param move The inferred move. Only valid during the callback.
+ */
+typedef void(ABI *cl_moveCallback)(const cl_move *move);
+
+/**
+ * \brief Register a move callback function.
+ *
+ * The real-time positions are tracked as a game starting from the initial
+ * position with white to move. Whenever the board reaches a position that one
+ * legal move leads to, the callback receives that move. Intermediate
+ * positions, e.g. while a piece is lifted, are ignored. Setting up the initial
+ * position starts a new game.
+ *
+ * @param callback Callback function. Set to `NULL` pointer to disable the
+ *                 callback.
+ */
+EXTERN_FLAGS void ABI cl_set_move_callback(cl_moveCallback callback);
+
+/**
+ * \brief Start tracking a new game from the initial position.
+ *
+ * @return 0 (false) on failure, 1 (true) on success
+ */
+EXTERN_FLAGS int ABI cl_reset_moves();
+
+/**
+ * \brief Get the full FEN of the tracked game.
+ *
+ * Unlike the real-time callback, the FEN includes side to move, castling
+ * rights, en passant square and move counters.
+ *
+ * @param fen Receives the FEN, NUL-terminated. 100 characters are enough.
+ * @param len Size of the provided fen parameter.
+ * @return Length of the FEN, without the terminating NUL. -1 on failure, -2
+ *         if the provided pointer is too small.
+ */
+EXTERN_FLAGS int ABI cl_get_tracked_fen(char *fen, size_t len);
+
+/**
+ * \brief Expand a packed board position into 64 piece characters.
+ *
+ * The squares are written rank 8 to rank 1 and file a to h, using the FEN
+ * piece letters and '0' for empty squares.
+ *
+ * @param board   Packed board position of 32 bytes, as passed to a
+ *                `cl_boardCallback`.
+ * @param squares Receives the 64 piece characters, not NUL-terminated.
+ */
+EXTERN_FLAGS void ABI cl_unpack_board(const unsigned char *board, char *squares);
+
+/**
+ * \brief Configure the suppression of repeated real-time positions.
+ *
+ * The board reports its position continuously, even when nothing moved. By
+ * default a position that is identical to the last delivered one is dropped
+ * before it reaches the real-time callbacks.
+ *
+ * @param enabled     1 to drop repeated positions, 0 to deliver every report.
+ * @param heartbeatMs If not 0, an unchanged position is delivered anyway
+ *                    once every `heartbeatMs` milliseconds.
+ * @return 0 (false) on failure, 1 (true) on success
+ */
+EXTERN_FLAGS int ABI cl_set_duplicate_suppression(int enabled, unsigned int heartbeatMs);
+
+/**
+ * \brief Get the counters of the real-time position stream.
+ *
+ * @param delivered  Receives the number of positions passed to the callbacks.
+ * @param suppressed Receives the number of positions dropped as duplicates.
+ * @return 0 (false) on failure, 1 (true) on success
+ */
+EXTERN_FLAGS int ABI cl_board_stats(unsigned long long *delivered, unsigned long long *suppressed);
+
+/**
+ * \brief Hold back real-time positions until they are stable.
+ *
+ * While a piece slides across the board, the board reports the intermediate
+ * positions it passes through. With a debounce, a position only reaches the
+ * real-time callbacks once it was reported unchanged for `windowMs`
+ * milliseconds or in `frames` consecutive reports, whichever comes first.
+ * The debounce is off by default.
+ *
+ * @param windowMs Time a position has to stay unchanged, 0 to not use a time
+ *                 window.
+ * @param frames   Number of consecutive reports of a position, 0 to not
+ *                 count reports. 0 for both turns the debounce off.
+ * @return 0 (false) on failure, 1 (true) on success
+ */
+EXTERN_FLAGS int ABI cl_set_debounce(unsigned int windowMs, unsigned int frames);
+
+/**
+ * \brief Get the counters of the debounce.
+ *
+ * @param absorbed Receives the number of reports of positions that changed
+ *                 again before they became stable.
+ * @param settled  Receives the number of positions that became stable.
+ * @return 0 (false) on failure, 1 (true) on success
+ */
+EXTERN_FLAGS int ABI cl_debounce_stats(unsigned long long *absorbed, unsigned long long *settled);
+
 /**
  * \brief Make a beeping sound.
  *
@@ -83,6 +336,38 @@ EXTERN_FLAGS void ABI cl_set_readtime_callback(cl_realtimeCallback callback);
  */
 EXTERN_FLAGS int ABI cl_beep(unsigned short frequencyHz, unsigned short durationMs);
 
+/**
+ * \brief Set the pacing of a command opcode.
+ *
+ * Commands are sent to the board by a background writer that paces them with
+ * token buckets. Opcodes without their own bucket share a default bucket that
+ * allows one command every 200 ms. Giving an opcode its own bucket lets it go
+ * out independently of the other commands, e.g. a batch of queries right
+ * after a LED update, as far as the firmware allows it.
+ *
+ * Known opcodes: 0x0a (LEDs), 0x0b (beep), 0x21 (mode), 0x27 (versions),
+ * 0x29 (battery), 0x31 (file count), 0x33/0x34 (file upload), 0x39 (delete
+ * file).
+ *
+ * @param opcode     First byte of the command, 0 to 255, or -1 to change the
+ *                   default bucket shared by all other opcodes.
+ * @param intervalMs Time per token, in milliseconds. 0 disables pacing.
+ * @param burst      Number of commands that may be sent back to back, at
+ *                   least 1.
+ * @return 0 (false) on failure, 1 (true) on success
+ */
+EXTERN_FLAGS int ABI cl_set_pacing(int opcode, unsigned int intervalMs, unsigned int burst);
+
+/**
+ * \brief Remove the pacing of a command opcode set with `cl_set_pacing()`.
+ *
+ * The opcode falls back to the default bucket.
+ *
+ * @param opcode First byte of the command, 0 to 255.
+ * @return 0 (false) on failure, 1 (true) on success
+ */
+EXTERN_FLAGS int ABI cl_clear_pacing(int opcode);
+
 /**
  * \brief Control the LED states of the chess board.
  *
@@ -166,6 +451,58 @@ EXTERN_FLAGS int ABI cl_get_battery();
  */
 EXTERN_FLAGS int ABI cl_get_file_count();
 
+/**
+ * \brief Board information returned by `cl_query_device_info()`.
+ */
+typedef struct cl_device_info {
+  /** MCU hardware version, not NUL-terminated. */
+  char mcu_version[100];
+  /** Length of `mcu_version`, 0 if the query failed. */
+  size_t mcu_version_len;
+  /** BLE hardware version, not NUL-terminated. */
+  char ble_version[100];
+  /** Length of `ble_version`, 0 if the query failed. */
+  size_t ble_version_len;
+  /** Battery level from 0 to 100, -1 if the query failed. */
+  int battery;
+  /** Number of stored game files, -1 if the query failed. */
+  int file_count;
+} cl_device_info;
+
+/**
+ * \brief Query the MCU version, BLE version, battery level and number of
+ * stored game files at once.
+ *
+ * All queries are sent back to back and their answers are collected as they
+ * arrive, which is much faster than calling `cl_get_mcu_version()`,
+ * `cl_get_ble_version()`, `cl_get_battery()` and `cl_get_file_count()` one
+ * after another.
+ *
+ * @param info Receives the board information. Fields of queries that failed
+ *             are set as documented in `cl_device_info`.
+ * @return 0 (false) if not connected or if every query failed, 1 (true)
+ *         otherwise
+ */
+EXTERN_FLAGS int ABI cl_query_device_info(cl_device_info *info);
+
+/**
+ * \brief Get the counters of the answers to queries.
+ *
+ * The version and file count queries also take a report of an unexpected
+ * type as their answer if no other query waits for it, as the original SDK
+ * did. Such reports are counted as `fallbacks`. Reports no query took are
+ * counted as `unmatched`.
+ *
+ * @param matched   Receives the number of reports that answered a query by
+ *                  their type.
+ * @param fallbacks Receives the number of reports that answered a query by
+ *                  fallback.
+ * @param unmatched Receives the number of reports that answered no query.
+ * @return 0 (false) on failure, 1 (true) on success
+ */
+EXTERN_FLAGS int ABI cl_request_stats(unsigned long long *matched, unsigned long long *fallbacks,
+                                      unsigned long long *unmatched);
+
 /**
  * \brief CAUTION: Retrieve the next available game file from internal storage
  * and then delete (!) the file from internal storage.
@@ -208,6 +545,23 @@ EXTERN_FLAGS int ABI cl_get_file_count();
  */
 EXTERN_FLAGS int ABI cl_get_file(char *game_data, size_t len);
 
+/**
+ * \brief Turn a game file into moves.
+ *
+ * The positions of a game file, as returned by `cl_get_file()`, are replayed
+ * from the initial position and every legal move between them is written in
+ * long algebraic notation as used by UCI, separated by spaces, e.g.
+ * "e2e4 e7e5 g1f3". Does not need a connection to the board.
+ *
+ * @param game_data The content of a game file, NUL-terminated.
+ * @param moves     Receives the moves, NUL-terminated.
+ * @param len       Size of the provided moves parameter.
+ * @return Length of the moves string, without the terminating NUL. -1 if
+ *         game_data or moves is `NULL`, -2 if the provided moves pointer is
+ *         too small.
+ */
+EXTERN_FLAGS int ABI cl_game_moves(const char *game_data, char *moves, size_t len);
+
 /**
  * \brief CAUTION: Retrieve the next available game file from internal storage
  * and then delete (!) the file from internal storage. Alias for
@@ -283,6 +637,192 @@ EXTERN_FLAGS int ABI cl_get_file_and_delete(char *game_data, size_t len);
  */
 EXTERN_FLAGS int ABI cl_get_file_and_keep(char *game_data, size_t len);
 
+/**
+ * \brief Type definition for game file position callback function.
+ *
+ * @param board The packed position, 32 bytes as for `cl_boardCallback`. Only
+ *              valid during the callback. Use `cl_unpack_board()` to expand
+ *              it into 64 pieces.
+ * @param index Index of the position in the game file, starting at 0.
+ */
+typedef void(ABI *cl_filePositionCallback)(const unsigned char *board, size_t index);
+
+/**
+ * \brief Retrieve the next available game file position by position.
+ *
+ * Unlike `cl_get_file()`, the game file is not gathered in a buffer. Each
+ * position is passed to the callback as soon as it has been received, so
+ * games of any length can be retrieved without knowing their size up front.
+ * The function returns once the transfer has ended.
+ *
+ * Calling this function will set automatically the board's mode to file
+ * upload mode.
+ *
+ * @param callback    Callback function, called on an SDK thread.
+ * @param delete_file 1 to delete the game file from internal storage once it
+ *                    has been transferred completely, 0 to keep it.
+ * @return Number of positions. 0 if there is no game file, -1 on failure.
+ */
+EXTERN_FLAGS int ABI cl_get_file_stream(cl_filePositionCallback callback, int delete_file);
+
+/**
+ * \brief Retrieve the next available game file in compact binary form.
+ *
+ * Instead of one FEN per position, the game is encoded as its first position
+ * followed by the squares that changed in each further position, about 4
+ * bytes per move instead of about 60. The encoding is built from the
+ * positions as they are received. Use `cl_decode_game()` to turn it into FENs.
+ *
+ * Format: the bytes 'C', 'L', 'G' and the version 1, the first position as 32
+ * packed bytes as for `cl_boardCallback`, then for each further position one
+ * byte with the number n of changed squares, n bytes with the squares (0 is
+ * a1, 7 is h1 and 63 is h8) and (n + 1) / 2 bytes with their new piece codes,
+ * two per byte, the first square in the low nibble.
+ *
+ * Unlike `cl_get_file()`, the game file is only deleted if it fits into the
+ * provided buffer.
+ *
+ * Calling this function will set automatically the board's mode to file
+ * upload mode.
+ *
+ * @param data        Receives the encoded game file.
+ * @param len         Size of the provided data parameter.
+ * @param delete_file 1 to delete the game file from internal storage once it
+ *                    has been stored in data, 0 to keep it.
+ * @return Number of bytes written to data. 0 if there is no game file, -1 on
+ *         failure, -2 if the provided data pointer is too small to hold the
+ *         game file, which is then kept.
+ */
+EXTERN_FLAGS int ABI cl_get_file_encoded(unsigned char *data, size_t len, int delete_file);
+
+/**
+ * \brief Turn a game file in compact binary form into FENs.
+ *
+ * The result has the same form as the content returned by `cl_get_file()`.
+ * Does not need a connection to the board.
+ *
+ * @param data      The game file, as returned by `cl_get_file_encoded()`.
+ * @param size      Number of bytes of data.
+ * @param game_data Receives the FENs of the positions separated by ';',
+ *                  NUL-terminated.
+ * @param len       Size of the provided game_data parameter.
+ * @return Length of the content string, without the terminating NUL. -1 if
+ *         data is malformed, -2 if the provided game_data pointer is too
+ *         small.
+ */
+EXTERN_FLAGS int ABI cl_decode_game(const unsigned char *data, size_t size, char *game_data, size_t len);
+
+/**
+ * \brief Type definition for the position callback of `cl_drain_all_games()`.
+ *
+ * @param game  Number of the game, starting at 0.
+ * @param board The packed position, 32 bytes as for `cl_boardCallback`. Only
+ *              valid during the callback.
+ * @param index Index of the position in the game, starting at 0.
+ */
+typedef void(ABI *cl_gamePositionCallback)(size_t game, const unsigned char *board, size_t index);
+
+/**
+ * \brief Type definition for the game callback of `cl_drain_all_games()`.
+ *
+ * @param game      Number of the game, starting at 0.
+ * @param positions Number of positions of the game.
+ */
+typedef void(ABI *cl_gameCallback)(size_t game, size_t positions);
+
+/**
+ * \brief CAUTION: Retrieve and delete (!) all game files from internal
+ * storage.
+ *
+ * All game files are downloaded in one session: the board is switched to file
+ * upload mode and the number of files is queried only once, and the deletion
+ * of each game file is sent together with the request for the next one. This
+ * is considerably faster than calling `cl_get_file()` in a loop. A game file
+ * is only deleted after it has been passed to the callbacks completely.
+ *
+ * @param on_position Called on an SDK thread with each position as soon as it
+ *                    has been received.
+ * @param on_game     Called on an SDK thread once a game file has been
+ *                    received completely. May be `NULL`.
+ * @return Number of game files retrieved, fewer than were stored if a
+ *         transfer failed. -1 if not connected.
+ */
+EXTERN_FLAGS int ABI cl_drain_all_games(cl_gamePositionCallback on_position, cl_gameCallback on_game);
+
+/**
+ * \brief Handle of a game file retrieved by `cl_file_open()`.
+ */
+typedef struct cl_file cl_file;
+
+/**
+ * \brief Retrieve the next available game file without deleting it, and
+ * report the exact buffer size needed to hold it.
+ *
+ * The game file is transferred from the board once and kept by the SDK until
+ * `cl_file_close()`. Copy it with `cl_file_read()` into a buffer of the
+ * reported size, then delete it from internal storage with
+ * `cl_file_commit_delete()` to advance to the next game file:
+ *
+ * ```
+ * size_t size;
+ * cl_file *file = cl_file_open(&size);
+ * if (file) {
+ *   char *game_data = malloc(size);
+ *   if (cl_file_read(file, game_data, size) >= 0) {
+ *     cl_file_commit_delete(file);
+ *   }
+ *   cl_file_close(file);
+ * }
+ * ```
+ *
+ * Calling this function will set automatically the board's mode to file
+ * upload mode.
+ *
+ * @param size Receives the size of the game file content as returned by
+ *             `cl_get_file()`, including the terminating NUL. 0 if no handle
+ *             is returned. May be `NULL`.
+ * @return Handle of the game file, `NULL` if not connected, if there is no
+ *         game file or if the transfer failed.
+ */
+EXTERN_FLAGS cl_file *ABI cl_file_open(size_t *size);
+
+/**
+ * \brief Copy the content of a game file retrieved by `cl_file_open()`.
+ *
+ * Can be called any number of times; the board is not involved.
+ *
+ * @param file      Handle returned by `cl_file_open()`.
+ * @param game_data Receives the FENs of the game file separated by ';',
+ *                  NUL-terminated, as for `cl_get_file()`.
+ * @param len       Size of the provided game_data parameter.
+ * @return Length of the content string, without the terminating NUL. -1 if
+ *         file or game_data is `NULL`, -2 if the provided pointer is smaller
+ *         than the size reported by `cl_file_open()`.
+ */
+EXTERN_FLAGS int ABI cl_file_read(cl_file *file, char *game_data, size_t len);
+
+/**
+ * \brief CAUTION: Delete the game file of a handle from internal storage.
+ *
+ * The board always deletes its next game file, so this is refused once any
+ * game file has been deleted since the handle was opened, e.g. by committing
+ * another handle or by `cl_get_file()`.
+ *
+ * @param file Handle returned by `cl_file_open()`.
+ * @return 1 (true) if the game file was deleted, 0 (false) if the command
+ *         could not be sent, -1 if not connected or file is `NULL`, -2 if the
+ *         handle no longer refers to the next game file.
+ */
+EXTERN_FLAGS int ABI cl_file_commit_delete(cl_file *file);
+
+/**
+ * \brief Release a handle returned by `cl_file_open()`. Does not delete the
+ * game file from internal storage.
+ *
+ * @param file Handle returned by `cl_file_open()`, may be `NULL`.
+ */
+EXTERN_FLAGS void ABI cl_file_close(cl_file *file);
+
 #ifdef __cplusplus
 }
 #endif
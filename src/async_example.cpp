@@ -0,0 +1,53 @@
+// Coroutine example: reads the board information, lights two squares and
+// prints the oldest stored game without deleting it, all from one coroutine
+// that runs on the SDK's threads.
+#include "../sdk/ChessLinkAsync.h"
+#include <cstdio>
+#include <cstdlib>
+
+static ChessTask run(ChessLinkAsync link) {
+  auto mcu = co_await link.mcuVersion();
+  auto ble = co_await link.bleVersion();
+  printf("MCU hardware version: %s\n", mcu.c_str());
+  printf("BLE hardware version: %s\n", ble.c_str());
+
+  auto battery = co_await link.battery();
+  if (battery >= 0) {
+    printf("Battery level: %d%%\n", battery);
+  } else {
+    fprintf(stderr, "[ERROR] Could not query the battery level\n");
+  }
+
+  printf("Enabling LEDs for squares d5 and e4\n");
+  array<bitset<8>, 8> leds = {bitset<8>("00000000"), bitset<8>("00000000"), bitset<8>("00000000"),
+                              bitset<8>("00010000"), bitset<8>("00001000"), bitset<8>("00000000"),
+                              bitset<8>("00000000"), bitset<8>("00000000")};
+  if (co_await link.setLedAsync(leds) <= 0) {
+    fprintf(stderr, "[ERROR] Could not enable/disable LEDs\n");
+  }
+
+  auto files = co_await link.fileCount();
+  printf("Stored game files: %d\n", files);
+  if (files > 0) {
+    auto game = co_await link.nextGameFile(false);
+    for (auto &fen : game) {
+      printf("%s\n", fen.c_str());
+    }
+  }
+}
+
+int main(void) {
+  printf("[DEBUG] Connecting to chessboard via HID ...\n");
+  auto link = ChessLink::fromHidConnect();
+  if (!link->connect()) {
+    fprintf(stderr, "[ERROR] Failed to connect to chessboard.  Exiting ...\n");
+    return EXIT_FAILURE;
+  }
+
+  // the coroutine runs on the SDK's threads, this one only waits for it
+  run(ChessLinkAsync(link)).wait();
+
+  printf("[DEBUG] Disconnecting from chessboard\n");
+  link->disconnect();
+  return EXIT_SUCCESS;
+}
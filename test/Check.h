@@ -0,0 +1,30 @@
+#ifndef CHESS_CHECK_HEADER_GUARD
+#define CHESS_CHECK_HEADER_GUARD
+
+#include <cstdio>
+
+// failed checks of the test
+inline int &checkFailures() {
+  static int failures = 0;
+  return failures;
+}
+
+// report a failed condition and carry on with the test
+#define CHECK(condition)                                                                                               \
+  do {                                                                                                                 \
+    if (!(condition)) {                                                                                                \
+      fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #condition);                                    \
+      checkFailures()++;                                                                                               \
+    }                                                                                                                  \
+  } while (0)
+
+// exit status of the test
+inline int checkResult() {
+  if (checkFailures() > 0) {
+    fprintf(stderr, "%d checks failed\n", checkFailures());
+    return 1;
+  }
+  return 0;
+}
+
+#endif // CHESS_CHECK_HEADER_GUARD
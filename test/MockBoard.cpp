@@ -0,0 +1,289 @@
+#include "MockBoard.h"
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <poll.h>
+#include <termios.h>
+#include <unistd.h>
+
+struct MockBoards::Board {
+  // pseudo terminal, the slave side is kept open so that the master never
+  // hangs up while no link has the board open
+  int master;
+  int slave;
+  string path;
+
+  // serialises the reports written to the master
+  mutex writeMutex;
+
+  // bytes of a command that is not complete yet, only used by the serving
+  // thread
+  vector<unsigned char> input;
+
+  mutex stateMutex;
+  deque<MockGame> games;
+  unsigned char battery;
+
+  array<atomic<uint64_t>, 256> commands;
+
+  Board() {
+    this->master = -1;
+    this->slave = -1;
+    this->battery = 80;
+    for (auto &count : this->commands) {
+      count = 0;
+    }
+  }
+};
+
+MockBoards::MockBoards(size_t count) {
+  this->stopping = false;
+  this->delayMicros = 0;
+  for (auto &response : this->responses) {
+    response = 0;
+  }
+  this->responses[0x27] = MOCK_VERSION_RESPONSE;
+  this->responses[0x29] = MOCK_BATTERY_RESPONSE;
+  this->responses[0x31] = MOCK_FILE_COUNT_RESPONSE;
+  if (pipe2(this->wakeFds, O_NONBLOCK | O_CLOEXEC) != 0) {
+    this->wakeFds[0] = this->wakeFds[1] = -1;
+  }
+  for (size_t i = 0; i < count; i++) {
+    auto board = unique_ptr<Board>(new Board());
+    board->master = posix_openpt(O_RDWR | O_NOCTTY | O_NONBLOCK | O_CLOEXEC);
+    if (board->master >= 0 && grantpt(board->master) == 0 && unlockpt(board->master) == 0) {
+      board->path = ptsname(board->master);
+      board->slave = open(board->path.c_str(), O_RDWR | O_NOCTTY | O_CLOEXEC);
+    }
+    if (board->slave >= 0) {
+      // pass every byte through unchanged
+      termios tio;
+      tcgetattr(board->slave, &tio);
+      cfmakeraw(&tio);
+      tcsetattr(board->slave, TCSANOW, &tio);
+    }
+    this->boards.push_back(move(board));
+  }
+  this->serveThread = thread(&MockBoards::serve, this);
+}
+
+MockBoards::~MockBoards() {
+  this->stopping = true;
+  if (this->wakeFds[1] >= 0) {
+    (void)!::write(this->wakeFds[1], "x", 1);
+  }
+  this->serveThread.join();
+  for (auto &board : this->boards) {
+    if (board->slave >= 0) {
+      close(board->slave);
+    }
+    if (board->master >= 0) {
+      close(board->master);
+    }
+  }
+  for (int fd : this->wakeFds) {
+    if (fd >= 0) {
+      close(fd);
+    }
+  }
+}
+
+size_t MockBoards::size(void) const { return this->boards.size(); }
+
+string MockBoards::path(size_t board) const { return this->boards[board]->path; }
+
+bool MockBoards::send(size_t board, const unsigned char *data, size_t length) {
+  auto &b = *this->boards[board];
+  lock_guard<mutex> lock(b.writeMutex);
+  auto deadline = chrono::steady_clock::now() + chrono::seconds(1);
+  while (length > 0) {
+    auto n = ::write(b.master, data, length);
+    if (n > 0) {
+      data += n;
+      length -= static_cast<size_t>(n);
+      continue;
+    }
+    if (n < 0 && errno != EAGAIN && errno != EINTR) {
+      return false;
+    }
+    // the link is not reading, wait for room in the terminal
+    auto left = chrono::duration_cast<chrono::milliseconds>(deadline - chrono::steady_clock::now()).count();
+    if (left <= 0) {
+      return false;
+    }
+    pollfd p = {b.master, POLLOUT, 0};
+    poll(&p, 1, static_cast<int>(left));
+  }
+  return true;
+}
+
+bool MockBoards::sendBoard(size_t board, const unsigned char *packed) {
+  auto frame = boardFrame(packed);
+  return this->send(board, frame.data(), frame.size());
+}
+
+void MockBoards::addGame(size_t board, MockGame game) {
+  auto &b = *this->boards[board];
+  lock_guard<mutex> lock(b.stateMutex);
+  b.games.push_back(move(game));
+}
+
+size_t MockBoards::games(size_t board) {
+  auto &b = *this->boards[board];
+  lock_guard<mutex> lock(b.stateMutex);
+  return b.games.size();
+}
+
+void MockBoards::setBattery(size_t board, unsigned char level) {
+  auto &b = *this->boards[board];
+  lock_guard<mutex> lock(b.stateMutex);
+  b.battery = level;
+}
+
+void MockBoards::setResponseDelay(chrono::microseconds delay) { this->delayMicros = delay.count(); }
+
+void MockBoards::setResponse(unsigned char query, unsigned char response) { this->responses[query] = response; }
+
+uint64_t MockBoards::commands(size_t board, unsigned char opcode) { return this->boards[board]->commands[opcode]; }
+
+bool MockBoards::waitCommands(size_t board, unsigned char opcode, uint64_t count, chrono::milliseconds timeout) {
+  auto deadline = chrono::steady_clock::now() + timeout;
+  while (this->commands(board, opcode) < count) {
+    if (chrono::steady_clock::now() >= deadline) {
+      return false;
+    }
+    this_thread::sleep_for(chrono::milliseconds(1));
+  }
+  return true;
+}
+
+vector<unsigned char> MockBoards::boardFrame(const unsigned char *packed) {
+  // opcode, length, the position and 4 bytes of trailer
+  vector<unsigned char> frame(2 + PACKED_BOARD_SIZE + 4, 0);
+  frame[0] = 0x01;
+  frame[1] = static_cast<unsigned char>(PACKED_BOARD_SIZE + 4);
+  memcpy(frame.data() + 2, packed, PACKED_BOARD_SIZE);
+  return frame;
+}
+
+array<unsigned char, PACKED_BOARD_SIZE> MockBoards::initialBoard(void) {
+  return {0x58, 0x23, 0x31, 0x85, 0x44, 0x44, 0x44, 0x44, 0, 0, 0, 0, 0, 0, 0, 0,
+          0,    0,    0,    0,    0,    0,    0,    0,    0x77, 0x77, 0x77, 0x77, 0xa6, 0xc9, 0x9b, 0x6a};
+}
+
+void MockBoards::reply(size_t board, vector<unsigned char> data) {
+  auto delay = this->delayMicros.load();
+  if (delay == 0) {
+    this->send(board, data.data(), data.size());
+    return;
+  }
+  lock_guard<mutex> lock(this->replyMutex);
+  this->replies.push_back({chrono::steady_clock::now() + chrono::microseconds(delay), board, move(data)});
+}
+
+void MockBoards::handle(size_t board, const unsigned char *command, size_t length) {
+  auto &b = *this->boards[board];
+  b.commands[command[0]]++;
+  unsigned char argument = length > 2 ? command[2] : 0;
+  switch (command[0]) {
+  case 0x27: {
+    // version query, 1 for the MCU and 0 for the BLE version
+    string version = argument ? MOCK_MCU_VERSION : MOCK_BLE_VERSION;
+    vector<unsigned char> data = {this->responses[0x27], static_cast<unsigned char>(version.size() + 1), argument};
+    data.insert(data.end(), version.begin(), version.end());
+    this->reply(board, move(data));
+    break;
+  }
+  case 0x29: {
+    lock_guard<mutex> lock(b.stateMutex);
+    this->reply(board, {this->responses[0x29], 0x02, b.battery, 0x00});
+    break;
+  }
+  case 0x31: {
+    lock_guard<mutex> lock(b.stateMutex);
+    this->reply(board, {this->responses[0x31], 0x01, static_cast<unsigned char>(b.games.size())});
+    break;
+  }
+  case 0x34: {
+    // upload the oldest game between a start and an end marker
+    vector<unsigned char> data = {0x37, 0x01, 0xbe};
+    {
+      lock_guard<mutex> lock(b.stateMutex);
+      if (!b.games.empty()) {
+        for (auto &position : b.games.front()) {
+          auto frame = boardFrame(position.data());
+          data.insert(data.end(), frame.begin(), frame.end());
+        }
+      }
+    }
+    data.insert(data.end(), {0x37, 0x01, 0xed});
+    this->reply(board, move(data));
+    break;
+  }
+  case 0x39: {
+    lock_guard<mutex> lock(b.stateMutex);
+    if (!b.games.empty()) {
+      b.games.pop_front();
+    }
+    break;
+  }
+  default:
+    // mode switches, LEDs and beeps are only counted
+    break;
+  }
+}
+
+void MockBoards::serve(void) {
+  vector<pollfd> fds(this->boards.size() + 1);
+  fds[0] = {this->wakeFds[0], POLLIN, 0};
+  for (size_t i = 0; i < this->boards.size(); i++) {
+    fds[i + 1] = {this->boards[i]->master, POLLIN, 0};
+  }
+  unsigned char buf[4096];
+  while (!this->stopping) {
+    int timeout = -1;
+    vector<Reply> due;
+    {
+      lock_guard<mutex> lock(this->replyMutex);
+      auto now = chrono::steady_clock::now();
+      while (!this->replies.empty() && this->replies.front().due <= now) {
+        due.push_back(move(this->replies.front()));
+        this->replies.pop_front();
+      }
+      // answers are only queued by this thread, so the next one is known here
+      if (!this->replies.empty()) {
+        auto wait = chrono::ceil<chrono::milliseconds>(this->replies.front().due - chrono::steady_clock::now());
+        timeout = static_cast<int>(max<int64_t>(wait.count(), 0));
+      }
+    }
+    for (auto &r : due) {
+      this->send(r.board, r.data.data(), r.data.size());
+    }
+
+    if (poll(fds.data(), fds.size(), timeout) <= 0) {
+      continue;
+    }
+    if (fds[0].revents & POLLIN) {
+      while (::read(this->wakeFds[0], buf, sizeof(buf)) > 0) {
+      }
+    }
+    for (size_t i = 0; i < this->boards.size(); i++) {
+      if (!(fds[i + 1].revents & POLLIN)) {
+        continue;
+      }
+      auto &input = this->boards[i]->input;
+      ssize_t n;
+      while ((n = ::read(this->boards[i]->master, buf, sizeof(buf))) > 0) {
+        input.insert(input.end(), buf, buf + n);
+      }
+      // commands are [opcode, length, payload...]
+      size_t at = 0;
+      while (input.size() - at >= 2 && input.size() - at >= static_cast<size_t>(input[at + 1]) + 2) {
+        size_t size = static_cast<size_t>(input[at + 1]) + 2;
+        this->handle(i, input.data() + at, size);
+        at += size;
+      }
+      input.erase(input.begin(), input.begin() + at);
+    }
+  }
+}
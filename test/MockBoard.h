@@ -0,0 +1,141 @@
+#ifndef CHESS_MOCK_BOARD_HEADER_GUARD
+#define CHESS_MOCK_BOARD_HEADER_GUARD
+
+#include "EasyLink.h"
+
+// response opcodes the mock boards answer the queries with
+constexpr unsigned char MOCK_VERSION_RESPONSE = 0x28;
+constexpr unsigned char MOCK_BATTERY_RESPONSE = 0x2A;
+constexpr unsigned char MOCK_FILE_COUNT_RESPONSE = 0x32;
+
+// version strings of the mock boards
+constexpr const char *MOCK_MCU_VERSION = "MOCK_MCU_1.0";
+constexpr const char *MOCK_BLE_VERSION = "MOCK_BLE_2.0";
+
+// a game stored on a mock board, one packed position per ply
+using MockGame = vector<array<unsigned char, PACKED_BOARD_SIZE>>;
+
+/**
+Boards simulated behind pseudo terminals, for the tests and benchmarks.
+
+A ChessLink opens the terminal of a board as if it were the board's hidraw
+node, see ChessLink::fromHidrawConnect and ChessLink::fromHidPath. One thread
+answers the commands of all boards the way the firmware does: version,
+battery and file count queries, mode switches, game file uploads and
+deletes; every command is counted by opcode. Answers can be delayed to
+simulate the round trip of a real board.
+*/
+class MockBoards {
+private:
+  struct Board;
+
+  vector<unique_ptr<Board>> boards;
+
+  // answer waiting for its delay
+  struct Reply {
+    chrono::steady_clock::time_point due;
+    size_t board;
+    vector<unsigned char> data;
+  };
+
+  // answers not sent yet, in the order they are due
+  mutex replyMutex;
+  deque<Reply> replies;
+
+  atomic<int64_t> delayMicros;
+
+  // response opcode of every query opcode
+  array<atomic<unsigned char>, 256> responses;
+
+  thread serveThread;
+  atomic_bool stopping;
+
+  // pipe that wakes the serving thread
+  int wakeFds[2];
+
+  // thread body, reads the commands of all boards and answers them
+  void serve(void);
+
+  // handle one complete command of a board
+  void handle(size_t board, const unsigned char *command, size_t length);
+
+  // send an answer once the response delay elapsed
+  void reply(size_t board, vector<unsigned char> data);
+
+public:
+  /**
+  create count boards, each with its own pseudo terminal
+  */
+  explicit MockBoards(size_t count);
+  ~MockBoards();
+
+  MockBoards(const MockBoards &) = delete;
+  MockBoards &operator=(const MockBoards &) = delete;
+
+  size_t size(void) const;
+
+  /**
+  returns the path of a board's terminal, open it like a hidraw node
+  */
+  string path(size_t board) const;
+
+  /**
+  send a report to the link of a board
+  Returns false if the report could not be written within a second
+  */
+  bool send(size_t board, const unsigned char *data, size_t length);
+
+  /**
+  send a realtime position, PACKED_BOARD_SIZE bytes
+  */
+  bool sendBoard(size_t board, const unsigned char *packed);
+
+  /**
+  store a game on a board, it is uploaded before the games added after it
+  */
+  void addGame(size_t board, MockGame game);
+
+  /**
+  returns the number of games stored on a board
+  */
+  size_t games(size_t board);
+
+  /**
+  set the battery level a board reports
+  */
+  void setBattery(size_t board, unsigned char level);
+
+  /**
+  delay every answer of every board by delay
+  */
+  void setResponseDelay(chrono::microseconds delay);
+
+  /**
+  answer the queries of an opcode with another response opcode, e.g. to
+  check how a link copes with a firmware that does not use the expected ones
+  */
+  void setResponse(unsigned char query, unsigned char response);
+
+  /**
+  returns the number of commands of an opcode a board received
+  */
+  uint64_t commands(size_t board, unsigned char opcode);
+
+  /**
+  wait until a board received count commands of an opcode
+  Returns false on timeout
+  */
+  bool waitCommands(size_t board, unsigned char opcode, uint64_t count, chrono::milliseconds timeout);
+
+  /**
+  returns a realtime position frame around a packed position
+  */
+  static vector<unsigned char> boardFrame(const unsigned char *packed);
+
+  /**
+  returns the packed initial position
+  */
+  static array<unsigned char, PACKED_BOARD_SIZE> initialBoard(void);
+};
+
+#endif // CHESS_MOCK_BOARD_HEADER_GUARD
@@ -0,0 +1,72 @@
+// Coroutine layer: operations that complete before, during and after the
+// coroutine suspends, and the lifetime of the coroutine frame.
+
+#include "ChessLinkAsync.h"
+#include "Check.h"
+
+// counts the coroutine frames alive
+static atomic<int> frames(0);
+
+struct Frame {
+  Frame() { frames++; }
+  ~Frame() { frames--; }
+};
+
+// completes on the calling thread, before the coroutine suspends
+static ChessOperation<int> synchronous(int value) {
+  return ChessOperation<int>([value](function<void(int)> done) { done(value); });
+}
+
+// completes on another thread after a delay
+static ChessOperation<int> threaded(int value, int delayMs) {
+  return ChessOperation<int>([value, delayMs](function<void(int)> done) {
+    thread([value, delayMs, done]() {
+      this_thread::sleep_for(chrono::milliseconds(delayMs));
+      done(value);
+    }).detach();
+  });
+}
+
+static ChessTask sum(int count, int delayMs, atomic<int> &total) {
+  Frame frame;
+  for (int i = 0; i < count; i++) {
+    total += co_await synchronous(1);
+    total += co_await threaded(2, delayMs);
+  }
+}
+
+int main() {
+  // many synchronous completions in a row neither resume the coroutine
+  // recursively nor lose a result
+  {
+    atomic<int> total(0);
+    auto task = sum(100000, -1, total);
+    task.wait();
+    CHECK(task.done());
+    CHECK(total == 300000);
+  }
+  CHECK(frames == 0);
+
+  // completions racing the suspension
+  {
+    atomic<int> total(0);
+    auto task = sum(2000, 0, total);
+    task.wait();
+    CHECK(total == 6000);
+  }
+  CHECK(frames == 0);
+
+  // a dropped task lets the coroutine finish and free its frame by itself
+  {
+    atomic<int> total(0);
+    sum(5, 10, total);
+    auto deadline = chrono::steady_clock::now() + chrono::seconds(5);
+    while (frames > 0 && chrono::steady_clock::now() < deadline) {
+      this_thread::sleep_for(chrono::milliseconds(5));
+    }
+    CHECK(total == 15);
+  }
+  CHECK(frames == 0);
+
+  return checkResult();
+}
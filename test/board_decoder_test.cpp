@@ -0,0 +1,120 @@
+// ChessBoardDecoder::fen with every kernel the CPU supports against the
+// original ChessLink::toFen, over random and hand picked positions.
+
+#include "ChessBoard.h"
+#include "Check.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <random>
+#include <string>
+
+using namespace std;
+
+constexpr unsigned char CHESS_PIECES[] = {
+    '0', 'q', 'k', 'b', 'p', 'n', 'R', 'P', 'r', 'B', 'N', 'Q', 'K',
+};
+
+// ChessLink::toFen as it was before the decoder, data is the whole message
+static string legacyFen(unsigned char *data, size_t length) {
+  if (length <= 32) {
+    return "";
+  }
+  string fen = "";
+  int empty = 0;
+  for (int i = 0; i < 8; i++) {
+    for (int j = 7; j >= 0; j--) {
+      char piece = j % 2 == 0 ? CHESS_PIECES[data[(i * 8 + j) / 2 + 2] & 0x0f]
+                              : CHESS_PIECES[data[static_cast<int>(floor((i * 8 + j) / 2 + 2))] >> 4];
+      if (piece == '0')
+        empty++;
+      else {
+        if (empty > 0) {
+          fen += to_string(empty);
+          empty = 0;
+        }
+      }
+      if (piece != '0')
+        fen += piece;
+    }
+    if (empty > 0)
+      fen += to_string(empty);
+    if (i < 7)
+      fen += "/";
+    empty = 0;
+  }
+  return fen;
+}
+
+static const char *kernelName(ChessBoardDecoder::Kernel kernel) {
+  switch (kernel) {
+  case ChessBoardDecoder::Avx2:
+    return "avx2";
+  case ChessBoardDecoder::Ssse3:
+    return "ssse3";
+  default:
+    return "scalar";
+  }
+}
+
+int main(int argc, char **argv) {
+  long boards = argc > 1 ? strtol(argv[1], nullptr, 10) : 2000000;
+
+  vector<ChessBoardDecoder::Kernel> kernels;
+  for (auto kernel : {ChessBoardDecoder::Scalar, ChessBoardDecoder::Ssse3, ChessBoardDecoder::Avx2}) {
+    if (ChessBoardDecoder::supports(kernel)) {
+      kernels.push_back(kernel);
+    }
+  }
+  printf("kernels:");
+  for (auto kernel : kernels) {
+    printf(" %s", kernelName(kernel));
+  }
+  printf(", dispatch uses %s\n", kernelName(ChessBoardDecoder::kernel()));
+  CHECK(ChessBoardDecoder::supports(ChessBoardDecoder::kernel()));
+
+  mt19937 random(1);
+  uniform_int_distribution<int> piece(0, 12), density(0, 3);
+  unsigned char message[2 + 36] = {0x01, 0x24};
+  unsigned char *packed = message + 2;
+  for (long i = 0; i < boards; i++) {
+    // empty, full, sparse and random positions
+    switch (i < 2 ? static_cast<int>(i) : density(random) + 2) {
+    case 0:
+      fill(packed, packed + PACKED_BOARD_SIZE, 0);
+      break;
+    case 1:
+      fill(packed, packed + PACKED_BOARD_SIZE, 0xcc);
+      break;
+    case 2:
+      for (size_t b = 0; b < PACKED_BOARD_SIZE; b++) {
+        int low = piece(random) < 2 ? piece(random) : 0;
+        int high = piece(random) < 2 ? piece(random) : 0;
+        packed[b] = static_cast<unsigned char>(low | high << 4);
+      }
+      break;
+    default:
+      for (size_t b = 0; b < PACKED_BOARD_SIZE; b++) {
+        packed[b] = static_cast<unsigned char>(piece(random) | piece(random) << 4);
+      }
+      break;
+    }
+
+    auto expected = legacyFen(message, sizeof(message));
+    char fen[BOARD_FEN_MAX];
+    CHECK(ChessBoardDecoder::fen(packed, fen) == expected.size() && expected == fen);
+    char reference[64];
+    ChessBoardDecoder::unpack(ChessBoardDecoder::Scalar, packed, reference);
+    for (auto kernel : kernels) {
+      CHECK(ChessBoardDecoder::fen(kernel, packed, fen) == expected.size() && expected == fen);
+      char squares[64];
+      ChessBoardDecoder::unpack(kernel, packed, squares);
+      CHECK(equal(squares, squares + 64, reference));
+    }
+    if (checkFailures() > 0) {
+      fprintf(stderr, "board %ld: %s\n", i, expected.c_str());
+      return checkResult();
+    }
+  }
+  return checkResult();
+}
@@ -0,0 +1,114 @@
+// Duplicate suppression of realtime positions: ChessBoardFilter with explicit
+// timestamps, and a ChessLink fed repeated 0x01 frames by a mock board.
+
+#include "Check.h"
+#include "MockBoard.h"
+#include "easy_link_c.h"
+
+// microseconds
+constexpr uint64_t MS = 1000;
+
+static atomic<uint64_t> delivered;
+
+static void onBoard(const uint8_t *, uint64_t) { delivered++; }
+
+static array<unsigned char, PACKED_BOARD_SIZE> position(unsigned char marker) {
+  auto packed = MockBoards::initialBoard();
+  packed[16] = marker;
+  return packed;
+}
+
+// wait until the link has seen count realtime frames
+static bool waitFrames(ChessLink &link, uint64_t count) {
+  auto deadline = chrono::steady_clock::now() + chrono::seconds(2);
+  while (chrono::steady_clock::now() < deadline) {
+    auto stats = link.getBoardStats();
+    if (stats.delivered + stats.suppressed >= count) {
+      return true;
+    }
+    this_thread::sleep_for(chrono::milliseconds(1));
+  }
+  return false;
+}
+
+int main() {
+  auto a = position(0x01), b = position(0x10);
+
+  // repeats of the last delivered position are dropped and counted
+  {
+    ChessBoardFilter filter;
+    CHECK(filter.accept(a.data(), 0));
+    CHECK(!filter.accept(a.data(), 1 * MS));
+    CHECK(!filter.accept(a.data(), 2 * MS));
+    CHECK(filter.accept(b.data(), 3 * MS));
+    CHECK(!filter.accept(b.data(), 4 * MS));
+    CHECK(filter.accept(a.data(), 5 * MS));
+    auto stats = filter.stats();
+    CHECK(stats.delivered == 3 && stats.suppressed == 3);
+
+    // reset, e.g. after a reconnect, lets the same position through again
+    filter.reset();
+    CHECK(filter.accept(a.data(), 6 * MS));
+    CHECK(!filter.accept(a.data(), 7 * MS));
+  }
+
+  // a heartbeat passes an unchanged position once per interval, off passes
+  // everything
+  {
+    ChessBoardFilter filter;
+    filter.configure(true, 100);
+    CHECK(filter.accept(a.data(), 0));
+    CHECK(!filter.accept(a.data(), 50 * MS));
+    CHECK(filter.accept(a.data(), 100 * MS));
+    CHECK(!filter.accept(a.data(), 150 * MS));
+    CHECK(filter.accept(a.data(), 200 * MS));
+    filter.configure(false, 0);
+    CHECK(filter.accept(a.data(), 201 * MS));
+    CHECK(filter.accept(a.data(), 202 * MS));
+    auto stats = filter.stats();
+    CHECK(stats.delivered == 5 && stats.suppressed == 2);
+  }
+
+  // through a link
+  {
+    MockBoards boards(1);
+    auto link = ChessLink::fromHidrawConnect(boards.path(0));
+    link->setBoardCallback(onBoard);
+    CHECK(link->connect());
+
+    for (auto *packed : {&a, &a, &a, &a, &a, &b, &b, &b, &a, &a}) {
+      CHECK(boards.sendBoard(0, packed->data()));
+    }
+    CHECK(waitFrames(*link, 10));
+    auto stats = link->getBoardStats();
+    CHECK(stats.delivered == 3 && stats.suppressed == 7);
+    CHECK(delivered == 3);
+
+    // after a reconnect the board's position is delivered even if unchanged
+    link->disconnect();
+    CHECK(link->connect());
+    CHECK(boards.sendBoard(0, a.data()));
+    CHECK(boards.sendBoard(0, a.data()));
+    CHECK(waitFrames(*link, 12));
+    stats = link->getBoardStats();
+    CHECK(stats.delivered == 4 && stats.suppressed == 8);
+    CHECK(delivered == 4);
+
+    // with suppression off every frame is delivered
+    link->setDuplicateSuppression(false);
+    CHECK(boards.sendBoard(0, a.data()));
+    CHECK(boards.sendBoard(0, a.data()));
+    CHECK(waitFrames(*link, 14));
+    CHECK(delivered == 6);
+    link->disconnect();
+  }
+
+  // the C API needs a connection
+  {
+    unsigned long long count = 0, suppressed = 0;
+    CHECK(!cl_set_duplicate_suppression(1, 0));
+    CHECK(!cl_board_stats(&count, &suppressed));
+    CHECK(!cl_board_stats(&count, nullptr));
+  }
+  return checkResult();
+}
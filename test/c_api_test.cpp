@@ -0,0 +1,22 @@
+// Return codes of the C API functions that need no board.
+
+#include "Check.h"
+#include "easy_link_c.h"
+#include <cstring>
+
+int main() {
+  const char *game = "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR;"
+                     "rnbqkbnr/pppppppp/8/8/4P3/8/PPPP1PPP/RNBQKBNR;"
+                     "rnbqkbnr/pppp1ppp/8/4p3/4P3/8/PPPP1PPP/RNBQKBNR";
+  char moves[64];
+  CHECK(cl_game_moves(game, moves, sizeof(moves)) == 9 && strcmp(moves, "e2e4 e7e5") == 0);
+  CHECK(cl_game_moves(game, moves, 9) == -2);
+  CHECK(cl_game_moves(nullptr, moves, sizeof(moves)) == -1);
+  CHECK(cl_game_moves(game, nullptr, sizeof(moves)) == -1);
+
+  // without a connection
+  CHECK(cl_file_commit_delete(nullptr) == -1);
+  CHECK(cl_file_read(nullptr, moves, sizeof(moves)) == -1);
+
+  return checkResult();
+}
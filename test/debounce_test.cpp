@@ -0,0 +1,131 @@
+// ChessBoardDebounce with explicit timestamps, and the kernels of the packed
+// position compare it is built on.
+
+#include "ChessBoard.h"
+#include "Check.h"
+#include "easy_link_c.h"
+#include <cstdint>
+#include <cstring>
+#include <random>
+
+using namespace std;
+
+using Packed = array<unsigned char, PACKED_BOARD_SIZE>;
+
+// microseconds
+constexpr uint64_t MS = 1000;
+
+static Packed position(unsigned char marker) {
+  Packed packed = {0x58, 0x23, 0x31, 0x85, 0x44, 0x44, 0x44, 0x44};
+  packed[16] = marker;
+  return packed;
+}
+
+int main() {
+  auto a = position(0x01), b = position(0x10);
+  Packed out;
+
+  // a piece that flickers inside the window is never delivered
+  {
+    ChessBoardDebounce debounce;
+    debounce.configure(50, 0);
+    CHECK(!debounce.accept(a.data(), 0));
+    CHECK(!debounce.accept(b.data(), 10 * MS));
+    CHECK(!debounce.accept(a.data(), 20 * MS));
+    CHECK(!debounce.accept(b.data(), 30 * MS));
+    CHECK(debounce.remaining(40 * MS) == 40 * MS);
+    CHECK(!debounce.expire(79 * MS, out.data()));
+    auto stats = debounce.stats();
+    CHECK(stats.absorbed == 3 && stats.settled == 0);
+
+    // held for the window, it is delivered once by the frame that reaches it
+    CHECK(!debounce.accept(b.data(), 60 * MS));
+    CHECK(debounce.accept(b.data(), 80 * MS));
+    CHECK(!debounce.expire(200 * MS, out.data()));
+    stats = debounce.stats();
+    CHECK(stats.absorbed == 3 && stats.settled == 1);
+
+    // frames of the stable position pass, the duplicate filter drops them
+    CHECK(debounce.accept(b.data(), 90 * MS));
+    CHECK(debounce.stats().settled == 1);
+  }
+
+  // a position the board reports once settles by the timer, exactly once
+  {
+    ChessBoardDebounce debounce;
+    debounce.configure(50, 0);
+    CHECK(debounce.remaining(0) == UINT64_MAX);
+    CHECK(!debounce.accept(a.data(), 100 * MS));
+    CHECK(debounce.remaining(120 * MS) == 30 * MS);
+    CHECK(!debounce.expire(149 * MS, out.data()));
+    CHECK(debounce.expire(150 * MS, out.data()));
+    CHECK(out == a);
+    CHECK(!debounce.expire(151 * MS, out.data()));
+    CHECK(!debounce.expire(500 * MS, out.data()));
+    CHECK(debounce.remaining(500 * MS) == UINT64_MAX);
+    CHECK(debounce.stats().settled == 1);
+  }
+
+  // by frames: the third identical frame settles
+  {
+    ChessBoardDebounce debounce;
+    debounce.configure(0, 3);
+    CHECK(!debounce.accept(a.data(), 0));
+    CHECK(!debounce.accept(a.data(), 1));
+    CHECK(debounce.accept(a.data(), 2));
+    CHECK(debounce.remaining(3) == UINT64_MAX);
+    CHECK(!debounce.accept(b.data(), 3));
+    CHECK(!debounce.accept(a.data(), 4));
+    CHECK(debounce.stats().absorbed == 1);
+  }
+
+  // reset forgets the pending position, off passes everything
+  {
+    ChessBoardDebounce debounce;
+    debounce.configure(50, 0);
+    CHECK(!debounce.accept(a.data(), 0));
+    debounce.reset();
+    CHECK(debounce.remaining(10 * MS) == UINT64_MAX);
+    CHECK(!debounce.expire(100 * MS, out.data()));
+    debounce.configure(0, 0);
+    CHECK(debounce.accept(a.data(), 200 * MS));
+    CHECK(debounce.accept(b.data(), 200 * MS));
+    CHECK(debounce.stats().settled == 0);
+  }
+
+  // every compare kernel agrees with memcmp, also on unaligned positions
+  // differing in a single bit
+  {
+    mt19937 random(7);
+    unsigned char buffer[2 * PACKED_BOARD_SIZE + 2];
+    for (int round = 0; round < 20000; round++) {
+      for (auto &byte : buffer) {
+        byte = static_cast<unsigned char>(random());
+      }
+      unsigned char *x = buffer + (round & 1);
+      unsigned char *y = buffer + PACKED_BOARD_SIZE + 1 + (round >> 1 & 1);
+      if (round % 3 != 0) {
+        memcpy(y, x, PACKED_BOARD_SIZE);
+        if (round % 3 == 2) {
+          y[random() % PACKED_BOARD_SIZE] ^= static_cast<unsigned char>(1u << (random() % 8));
+        }
+      }
+      bool expected = memcmp(x, y, PACKED_BOARD_SIZE) == 0;
+      CHECK(ChessBoardDecoder::equal(x, y) == expected);
+      for (auto kernel : {ChessBoardDecoder::Scalar, ChessBoardDecoder::Ssse3, ChessBoardDecoder::Avx2}) {
+        if (ChessBoardDecoder::supports(kernel)) {
+          CHECK(ChessBoardDecoder::equal(kernel, x, y) == expected);
+        }
+      }
+    }
+  }
+
+  // the C API needs a connection
+  {
+    unsigned long long absorbed = 0, settled = 0;
+    CHECK(!cl_set_debounce(50, 0));
+    CHECK(!cl_debounce_stats(&absorbed, &settled));
+    CHECK(!cl_debounce_stats(nullptr, &settled));
+  }
+  return checkResult();
+}
@@ -0,0 +1,86 @@
+// Which HID devices are taken for boards and which board a connect opens,
+// over the records hid_enumerate would report.
+
+#include "Check.h"
+#include "EasyLink.h"
+#include "easy_link_c.h"
+
+using namespace std;
+
+// vendor and usage page of the board
+constexpr uint16_t VID = 0x2d80;
+constexpr uint16_t PAGE = 0xFF00;
+
+int main() {
+  // the product id is matched on its high byte, vendor and usage page exactly
+  {
+    CHECK(ChessHidConnect::isBoard(VID, 0x8000));
+    CHECK(ChessHidConnect::isBoard(VID, 0x8001));
+    CHECK(ChessHidConnect::isBoard(VID, 0x86FF));
+    CHECK(!ChessHidConnect::isBoard(VID, 0x8700));
+    CHECK(!ChessHidConnect::isBoard(VID, 0x7FFF));
+    CHECK(!ChessHidConnect::isBoard(VID, 0x0080));
+    CHECK(!ChessHidConnect::isBoard(0x2d81, 0x8000));
+    CHECK(!ChessHidConnect::isBoard(0x0000, 0x8000));
+
+    vector<ChessHidInfo> devices = {
+        {"keyboard", 0x046d, 0x8000, PAGE, "K1", 0},
+        {"board-a", VID, 0x8000, PAGE, "A1", 0},
+        {"board-a-mouse", VID, 0x8000, 0x0001, "A1", 1},
+        {"other-product", VID, 0x9000, PAGE, "X1", 0},
+        {"board-b", VID, 0x8602, PAGE, "", 2},
+        {"board-c", VID, 0x8100, PAGE, "C1", -1},
+    };
+    auto boards = ChessHidConnect::boards(devices);
+    CHECK(boards.size() == 3);
+    if (boards.size() == 3) {
+      CHECK(boards[0].path == "board-a" && boards[0].productId == 0x8000 && boards[0].serial == "A1" &&
+            boards[0].interfaceNumber == 0);
+      CHECK(boards[1].path == "board-b" && boards[1].productId == 0x8602 && boards[1].serial.empty() &&
+            boards[1].interfaceNumber == 2);
+      CHECK(boards[2].path == "board-c" && boards[2].serial == "C1" && boards[2].interfaceNumber == -1);
+    }
+
+    CHECK(ChessHidConnect::boards({}).empty());
+    CHECK(ChessHidConnect::boards({devices[0], devices[2], devices[3]}).empty());
+  }
+
+  // the board a connect opens
+  {
+    vector<ChessHidDevice> boards = {
+        {"board-a", 0x8000, "A1", 0},
+        {"board-b", 0x8602, "", 2},
+        {"board-c", 0x8100, "C1", 0},
+        {"board-d", 0x8100, "C1", 0},
+    };
+
+    // neither path nor serial: the first board
+    CHECK(ChessHidConnect::select(boards, "", "") == "board-a");
+    CHECK(ChessHidConnect::select({}, "", "").empty());
+
+    // a path is opened as given, whether it is listed or not, and wins over a serial
+    CHECK(ChessHidConnect::select(boards, "board-b", "") == "board-b");
+    CHECK(ChessHidConnect::select(boards, "board-d", "") == "board-d");
+    CHECK(ChessHidConnect::select(boards, "board-x", "") == "board-x");
+    CHECK(ChessHidConnect::select({}, "board-a", "") == "board-a");
+    CHECK(ChessHidConnect::select(boards, "board-d", "A1") == "board-d");
+
+    // a serial opens the first board that reports it, never one without
+    CHECK(ChessHidConnect::select(boards, "", "A1") == "board-a");
+    CHECK(ChessHidConnect::select(boards, "", "C1") == "board-c");
+    CHECK(ChessHidConnect::select(boards, "", "C").empty());
+    CHECK(ChessHidConnect::select(boards, "", "B1").empty());
+    CHECK(ChessHidConnect::select({}, "", "A1").empty());
+  }
+
+  // a path or serial that names no board plugged in is never connected
+  {
+    CHECK(!ChessLink::fromHidPath("no-such-board")->connect());
+    CHECK(!ChessLink::fromHidSerial("no-such-serial")->connect());
+    CHECK(!cl_connect_path(nullptr) && !cl_connect_path(""));
+    CHECK(!cl_connect_serial(nullptr) && !cl_connect_serial(""));
+    CHECK(cl_list_boards(nullptr, 0) == static_cast<int>(ChessHidConnect::enumerate().size()));
+  }
+
+  return checkResult();
+}
@@ -0,0 +1,76 @@
+// Game file downloads against mock boards: a download the caller stopped
+// waiting for must neither take the next upload nor delete a game.
+
+#include "Check.h"
+#include "MockBoard.h"
+
+// a game of plies positions
+static MockGame game(size_t plies) {
+  MockGame positions;
+  auto board = MockBoards::initialBoard();
+  for (size_t i = 0; i < plies; i++) {
+    board[8 + i] = 0x01;
+    positions.push_back(board);
+  }
+  return positions;
+}
+
+int main() {
+  // getFileStream
+  {
+    MockBoards boards(1);
+    boards.addGame(0, game(3));
+    auto link = ChessLink::fromHidrawConnect(boards.path(0));
+    CHECK(link->connect());
+
+    // the upload arrives after the call gave up
+    boards.setResponseDelay(chrono::milliseconds(500));
+    link->setFileTimeout(100);
+    size_t late = 0;
+    CHECK(link->getFileStream([&late](const unsigned char *) { late++; }, true) == -1);
+    CHECK(boards.waitCommands(0, 0x34, 1, chrono::seconds(2)));
+    this_thread::sleep_for(chrono::milliseconds(800));
+    CHECK(late == 0);
+    CHECK(boards.commands(0, 0x39) == 0);
+    CHECK(boards.games(0) == 1);
+
+    // the next call gets the game, and deletes it
+    boards.setResponseDelay(chrono::microseconds(0));
+    link->setFileTimeout(5000);
+    size_t positions = 0;
+    CHECK(link->getFileStream([&positions](const unsigned char *) { positions++; }, true) == 3);
+    CHECK(positions == 3);
+    CHECK(boards.waitCommands(0, 0x39, 1, chrono::seconds(1)));
+    CHECK(boards.games(0) == 0);
+    link->disconnect();
+  }
+
+  // drainAllGames
+  {
+    MockBoards boards(1);
+    boards.addGame(0, game(2));
+    boards.addGame(0, game(4));
+    auto link = ChessLink::fromHidrawConnect(boards.path(0));
+    CHECK(link->connect());
+
+    boards.setResponseDelay(chrono::milliseconds(500));
+    link->setFileTimeout(100);
+    CHECK(link->drainAllGames({}) == 0);
+    CHECK(boards.waitCommands(0, 0x34, 1, chrono::seconds(2)));
+    this_thread::sleep_for(chrono::milliseconds(800));
+    CHECK(boards.commands(0, 0x39) == 0);
+    CHECK(boards.games(0) == 2);
+
+    boards.setResponseDelay(chrono::microseconds(0));
+    link->setFileTimeout(5000);
+    vector<size_t> plies;
+    ChessGameSink sink;
+    sink.onGame = [&plies](size_t, size_t positions) { plies.push_back(positions); };
+    CHECK(link->drainAllGames(sink) == 2);
+    CHECK((plies == vector<size_t>{2, 4}));
+    CHECK(boards.waitCommands(0, 0x39, 2, chrono::seconds(1)));
+    CHECK(boards.games(0) == 0);
+    link->disconnect();
+  }
+  return checkResult();
+}
@@ -0,0 +1,134 @@
+// ChessFrameDecoder fed with random message streams cut into reports at
+// arbitrary points, with padding between messages and with garbage.
+
+#include "ChessFrameDecoder.h"
+#include "Check.h"
+#include <random>
+#include <vector>
+
+using Message = std::vector<unsigned char>;
+
+// a random message the board could send
+static Message randomMessage(std::mt19937 &random) {
+  std::uniform_int_distribution<int> byte(0, 255), kind(0, 3), piece(0, 12);
+  Message message;
+  switch (kind(random)) {
+  case 0:
+    message = {0x01, 0x24};
+    for (int i = 0; i < 32; i++) {
+      message.push_back(static_cast<unsigned char>(piece(random) | piece(random) << 4));
+    }
+    message.insert(message.end(), 4, 0);
+    break;
+  case 1:
+    message = {0x2A, 0x02, static_cast<unsigned char>(byte(random) % 101),
+               static_cast<unsigned char>(byte(random) % 2)};
+    break;
+  case 2:
+    message = {0x37, 0x01, static_cast<unsigned char>(byte(random) % 2 ? 0xbe : 0xed)};
+    break;
+  default: {
+    // any other opcode takes any length, its payload is not looked at
+    unsigned char opcode;
+    do {
+      opcode = static_cast<unsigned char>(byte(random));
+    } while (opcode == 0 || opcode == 0x01 || opcode == 0x2A || opcode == 0x37);
+    auto length = static_cast<unsigned char>(byte(random) % 64);
+    message = {opcode, length};
+    for (int i = 0; i < length; i++) {
+      message.push_back(static_cast<unsigned char>(byte(random)));
+    }
+    break;
+  }
+  }
+  return message;
+}
+
+// feed a stream in reports of random sizes, returns the messages delivered
+static std::vector<Message> feedSplit(ChessFrameDecoder &decoder, const Message &stream, std::mt19937 &random,
+                                      int maxReport) {
+  std::uniform_int_distribution<int> size(1, maxReport);
+  std::vector<Message> delivered;
+  size_t at = 0;
+  while (at < stream.size()) {
+    size_t length = std::min(stream.size() - at, static_cast<size_t>(size(random)));
+    decoder.feed(stream.data() + at, length,
+                 [&delivered](const unsigned char *data, size_t n) { delivered.emplace_back(data, data + n); });
+    at += length;
+  }
+  return delivered;
+}
+
+int main() {
+  std::mt19937 random(20240611);
+  std::uniform_int_distribution<int> count(1, 40), padding(0, 3), coin(0, 1);
+
+  // valid messages with zero padding between them come out unchanged,
+  // whatever the cuts
+  for (int round = 0; round < 3000; round++) {
+    std::vector<Message> messages;
+    Message stream;
+    for (int i = count(random); i > 0; i--) {
+      messages.push_back(randomMessage(random));
+      stream.insert(stream.end(), messages.back().begin(), messages.back().end());
+      if (coin(random)) {
+        stream.insert(stream.end(), static_cast<size_t>(padding(random)) * 8, 0);
+      }
+    }
+    ChessFrameDecoder decoder;
+    auto delivered = feedSplit(decoder, stream, random, round % 2 ? 8 : 600);
+    CHECK(delivered == messages);
+    auto stats = decoder.stats();
+    CHECK(stats.frames == messages.size() && stats.resyncs == 0 && stats.malformed == 0);
+    if (checkFailures() > 0) {
+      fprintf(stderr, "round %d\n", round);
+      return checkResult();
+    }
+  }
+
+  // garbage never overruns the buffer, and once it stopped and the decoder
+  // was reset, messages come out unchanged again
+  for (int round = 0; round < 3000; round++) {
+    std::uniform_int_distribution<int> byte(0, 255), length(1, 700);
+    Message garbage(static_cast<size_t>(length(random)));
+    for (auto &b : garbage) {
+      b = static_cast<unsigned char>(byte(random));
+    }
+    ChessFrameDecoder decoder;
+    feedSplit(decoder, garbage, random, 64);
+    decoder.reset();
+
+    std::vector<Message> messages;
+    Message stream;
+    for (int i = count(random); i > 0; i--) {
+      messages.push_back(randomMessage(random));
+      stream.insert(stream.end(), messages.back().begin(), messages.back().end());
+    }
+    CHECK(feedSplit(decoder, stream, random, 64) == messages);
+  }
+
+  // a known opcode with the wrong length is skipped byte by byte
+  {
+    ChessFrameDecoder decoder;
+    const unsigned char stream[] = {0x37, 0x2A, 0x02, 50, 0};
+    std::vector<Message> delivered;
+    decoder.feed(stream, sizeof(stream),
+                 [&delivered](const unsigned char *data, size_t n) { delivered.emplace_back(data, data + n); });
+    CHECK(delivered.size() == 1 && delivered[0] == Message({0x2A, 0x02, 50, 0}));
+    CHECK(decoder.stats().resyncs == 1);
+  }
+
+  // a position with an unknown piece code is dropped as malformed
+  {
+    ChessFrameDecoder decoder;
+    Message position = {0x01, 0x24};
+    position.insert(position.end(), 36, 0);
+    position[5] = 0xd0;
+    int delivered = 0;
+    decoder.feed(position.data(), position.size(), [&delivered](const unsigned char *, size_t) { delivered++; });
+    CHECK(delivered == 0);
+    CHECK(decoder.stats().malformed == 1);
+  }
+
+  return checkResult();
+}
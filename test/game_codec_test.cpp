@@ -0,0 +1,75 @@
+// Size of the ChessGameEncoder records for the move kinds the documentation
+// lists, and a round trip through ChessGameDecoder.
+
+#include "ChessGameCodec.h"
+#include "Check.h"
+#include <vector>
+
+using Position = std::array<unsigned char, PACKED_BOARD_SIZE>;
+
+// put a piece code on a square, 0 is a1; square s is nibble 63 - s
+static void put(Position &packed, int square, unsigned char code) {
+  int k = 63 - square;
+  auto &byte = packed[k / 2];
+  if (k % 2) {
+    byte = static_cast<unsigned char>((byte & 0x0f) | code << 4);
+  } else {
+    byte = static_cast<unsigned char>((byte & 0xf0) | code);
+  }
+}
+
+int main() {
+  const int e1 = 4, f1 = 5, g1 = 6, h1 = 7, d5 = 35, e5 = 36, d6 = 43, d7 = 51, e8 = 60;
+  const unsigned char whiteKing = 12, whiteRook = 6, whitePawn = 7, blackPawn = 4, blackKing = 2;
+
+  std::vector<Position> game;
+  Position board = {};
+  put(board, e1, whiteKing);
+  put(board, h1, whiteRook);
+  put(board, e5, whitePawn);
+  put(board, d7, blackPawn);
+  put(board, e8, blackKing);
+  game.push_back(board);
+
+  // d7d5, two squares
+  put(board, d7, 0);
+  put(board, d5, blackPawn);
+  game.push_back(board);
+
+  // e5d6 en passant, three squares
+  put(board, e5, 0);
+  put(board, d6, whitePawn);
+  put(board, d5, 0);
+  game.push_back(board);
+
+  // e8d7, two squares; then white castles kingside, four squares
+  put(board, e8, 0);
+  put(board, d7, blackKing);
+  game.push_back(board);
+  put(board, e1, 0);
+  put(board, g1, whiteKing);
+  put(board, h1, 0);
+  put(board, f1, whiteRook);
+  game.push_back(board);
+
+  ChessGameEncoder encoder;
+  std::vector<size_t> sizes;
+  for (auto &position : game) {
+    encoder.add(position.data());
+    sizes.push_back(encoder.bytes().size());
+  }
+  CHECK(sizes[0] == 4 + PACKED_BOARD_SIZE);
+  CHECK(sizes[1] - sizes[0] == 4);
+  CHECK(sizes[2] - sizes[1] == 6);
+  CHECK(sizes[3] - sizes[2] == 4);
+  CHECK(sizes[4] - sizes[3] == 7);
+
+  ChessGameDecoder decoder(encoder.bytes().data(), encoder.bytes().size());
+  Position decoded;
+  for (auto &position : game) {
+    CHECK(decoder.next(decoded.data()) && decoded == position);
+  }
+  CHECK(!decoder.next(decoded.data()) && !decoder.error());
+
+  return checkResult();
+}
@@ -0,0 +1,108 @@
+// ChessHotplug fed synthetic uevents through a socketpair, and the reconnect
+// schedule that a matching event has to make due at once.
+
+#include "ChessHotplug.h"
+#include "Check.h"
+#include "EasyLink.h"
+#include <cstring>
+#include <sys/socket.h>
+#include <unistd.h>
+
+// microseconds
+constexpr uint64_t MS = 1000;
+
+// a kernel uevent, action@devpath followed by its properties
+static string kernelEvent(const string &action, const string &subsystem, const string &hidId) {
+  string path = "/devices/pci0000:00/0000:00:14.0/usb1/1-2/1-2:1.0/0003:" + hidId.substr(5, 8) + ".0001";
+  string event = action + "@" + path + '\0';
+  event += "ACTION=" + action + '\0';
+  event += "DEVPATH=" + path + '\0';
+  event += "SUBSYSTEM=" + subsystem + '\0';
+  event += "HID_ID=" + hidId + '\0';
+  event += string("HID_NAME=Chess Board") + '\0';
+  return event;
+}
+
+// the same properties as udev rebroadcasts them, behind its binary header
+static string udevEvent(const string &action, const string &hidId) {
+  string header(40, '\0');
+  memcpy(&header[0], "libudev", 8);
+  uint32_t offset = 40;
+  memcpy(&header[16], &offset, sizeof(offset));
+  string properties = "ACTION=" + action + '\0' + "SUBSYSTEM=hid" + '\0' + "HID_ID=" + hidId + '\0';
+  return header + properties;
+}
+
+static void send(int fd, const string &event) { CHECK(::send(fd, event.data(), event.size(), 0) > 0); }
+
+int main() {
+  const string board = "0003:00002D80:00008001";
+  const string mouse = "0003:0000046D:0000C077";
+
+  int fds[2];
+  CHECK(socketpair(AF_UNIX, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0, fds) == 0);
+  ChessHotplug hotplug;
+  CHECK(hotplug.open(fds[0]));
+  CHECK(hotplug.descriptor() == fds[0]);
+  CHECK(!hotplug.added(ChessHidConnect::isBoard));
+
+  // only an added HID device with the board's ids matches
+  send(fds[1], kernelEvent("remove", "hid", board));
+  CHECK(!hotplug.added(ChessHidConnect::isBoard));
+  send(fds[1], kernelEvent("add", "hid", mouse));
+  CHECK(!hotplug.added(ChessHidConnect::isBoard));
+  send(fds[1], kernelEvent("add", "usb", board));
+  CHECK(!hotplug.added(ChessHidConnect::isBoard));
+  send(fds[1], kernelEvent("add", "hid", board));
+  CHECK(hotplug.added(ChessHidConnect::isBoard));
+  CHECK(!hotplug.added(ChessHidConnect::isBoard));
+  send(fds[1], udevEvent("add", board));
+  CHECK(hotplug.added(ChessHidConnect::isBoard));
+
+  // every pending event is consumed at once
+  send(fds[1], kernelEvent("add", "hid", board));
+  send(fds[1], kernelEvent("remove", "hid", mouse));
+  CHECK(hotplug.added(ChessHidConnect::isBoard));
+  CHECK(!hotplug.added(ChessHidConnect::isBoard));
+
+  // while the monitor is quiet an absent board is only scanned for every 5
+  // seconds, an added board makes an attempt due right away and keeps
+  // failed ones retried quickly for 2 seconds
+  {
+    ChessReconnect reconnect;
+    uint64_t now = 1000 * MS;
+    CHECK(reconnect.attempt(now, true));
+    CHECK(!reconnect.attempt(now + 10 * MS, true));
+    CHECK(!reconnect.retrying(now + 10 * MS, true));
+
+    send(fds[1], kernelEvent("add", "hid", board));
+    CHECK(hotplug.added(ChessHidConnect::isBoard));
+    reconnect.plugged(now + 20 * MS);
+    CHECK(reconnect.attempt(now + 20 * MS, true));
+    CHECK(reconnect.retrying(now + 20 * MS, true));
+    CHECK(reconnect.attempt(now + 30 * MS, true));
+    CHECK(!reconnect.attempt(now + 2030 * MS, true));
+    CHECK(!reconnect.retrying(now + 2030 * MS, true));
+    CHECK(reconnect.attempt(now + 5030 * MS, true));
+
+    // connect() wakes the driving thread, which tries at once
+    CHECK(!reconnect.attempt(now + 5040 * MS, true));
+    reconnect.wake();
+    CHECK(reconnect.attempt(now + 5040 * MS, true));
+
+    // once connected the retry window is over
+    reconnect.plugged(now + 6000 * MS);
+    reconnect.connected();
+    CHECK(!reconnect.retrying(now + 6000 * MS, true));
+
+    // without a monitor every attempt is due
+    CHECK(reconnect.attempt(now + 6001 * MS, false));
+    CHECK(reconnect.attempt(now + 6002 * MS, false));
+    CHECK(reconnect.retrying(now + 6002 * MS, false));
+  }
+
+  hotplug.close();
+  CHECK(hotplug.descriptor() == -1);
+  close(fds[1]);
+  return checkResult();
+}
@@ -0,0 +1,63 @@
+// Boards driven by a ChessLinkHub: a board connected while its thread is idle
+// is watched right away, reconnects are picked up the same way, and a link
+// that outlives the hub fails its commands.
+
+#include "ChessLinkHub.h"
+#include "Check.h"
+#include "MockBoard.h"
+
+static atomic<uint64_t> positions;
+
+static void onBoard(const uint8_t *, uint64_t) { positions++; }
+
+// milliseconds until a position sent right after connect reaches the
+// callback, -1 if it does not within 2 seconds
+static long connectAndSend(MockBoards &boards, ChessLink &link) {
+  positions = 0;
+  auto start = chrono::steady_clock::now();
+  if (!link.connect()) {
+    return -1;
+  }
+  auto board = MockBoards::initialBoard();
+  boards.sendBoard(0, board.data());
+  while (positions == 0) {
+    if (chrono::steady_clock::now() - start > chrono::seconds(2)) {
+      return -1;
+    }
+    this_thread::sleep_for(chrono::milliseconds(1));
+  }
+  return static_cast<long>(chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - start).count());
+}
+
+int main() {
+  MockBoards boards(1);
+  auto hub = unique_ptr<ChessLinkHub>(new ChessLinkHub(1));
+  auto link = hub->attach(boards.path(0));
+  link->setBoardCallback(onBoard);
+
+  for (int round = 0; round < 3; round++) {
+    // the hub thread sleeps for its idle interval while nothing is connected,
+    // connect must wake it instead of waiting that out
+    this_thread::sleep_for(chrono::milliseconds(50));
+    long millis = connectAndSend(boards, *link);
+    CHECK(millis >= 0);
+    CHECK(millis < 100);
+    link->disconnect();
+  }
+
+  // queries still go through the hub thread after the reconnects
+  CHECK(link->connect());
+  CHECK(link->getBattery() == 80);
+
+  // a link that outlives its hub fails its commands instead of waiting for a
+  // thread that is gone, and does not open the node again
+  hub.reset();
+  auto start = chrono::steady_clock::now();
+  CHECK(link->getBattery() == 0);
+  CHECK(link->getFileCount() == 0);
+  CHECK(link->queryDeviceInfo().battery == -1);
+  CHECK(!link->deleteFile());
+  CHECK(chrono::steady_clock::now() - start < chrono::milliseconds(500));
+  CHECK(!link->connect());
+  return checkResult();
+}
@@ -0,0 +1,216 @@
+// ChessMoveTracker against known move counts and hand-picked positions:
+// perft through update() from the start position and two standard test
+// positions, castling, en passant, promotion, pins, UCI and replay.
+
+#include "ChessMoveTracker.h"
+#include "Check.h"
+#include <string>
+
+using namespace std;
+
+constexpr const char *START = "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR";
+constexpr const char *KIWIPETE = "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R";
+constexpr const char *ENDGAME = "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8";
+
+static BoardState position(const char *fen) {
+  BoardState board = {};
+  CHECK(BoardState::fromFen(fen, board));
+  return board;
+}
+
+static void clearSquare(BoardState &board, int square) {
+  for (auto &pieces : board.pieces) {
+    pieces &= ~(1ull << square);
+  }
+  board.occupied &= ~(1ull << square);
+}
+
+static void putPiece(BoardState &board, int square, uint8_t piece) {
+  clearSquare(board, square);
+  board.pieces[piece - 1] |= 1ull << square;
+  board.occupied |= 1ull << square;
+}
+
+// the position after a legal move, worked out independently of the tracker
+static BoardState afterMove(const BoardState &board, const ChessMove &move) {
+  BoardState next = board;
+  clearSquare(next, move.from);
+  putPiece(next, move.to, move.promotion ? move.promotion : move.piece);
+  if (move.flags & ChessMove::EnPassant) {
+    clearSquare(next, move.from / 8 * 8 + move.to % 8);
+  }
+  if (move.flags & ChessMove::Castle) {
+    int rookFrom = move.to % 8 == 6 ? move.to + 1 : move.to - 2;
+    int rookTo = move.to % 8 == 6 ? move.to - 1 : move.to + 1;
+    putPiece(next, rookTo, board.pieceAt(rookFrom));
+    clearSquare(next, rookFrom);
+  }
+  return next;
+}
+
+// leaf nodes depth plies deep, every move is made by feeding its position
+// to update(), which has to find that very move again
+static uint64_t perft(const ChessMoveTracker &tracker, int depth) {
+  ChessMove moves[LEGAL_MOVES_MAX];
+  size_t count = tracker.legalMoves(moves);
+  if (depth == 1) {
+    return count;
+  }
+  uint64_t nodes = 0;
+  for (size_t i = 0; i < count; i++) {
+    ChessMoveTracker next = tracker;
+    ChessMove found;
+    if (!next.update(afterMove(tracker.board(), moves[i]), &found) || found.uci() != moves[i].uci()) {
+      fprintf(stderr, "update missed %s in %s\n", moves[i].uci().c_str(), tracker.fen().c_str());
+      checkFailures()++;
+      continue;
+    }
+    nodes += perft(next, depth - 1);
+  }
+  return nodes;
+}
+
+static bool hasMove(const ChessMoveTracker &tracker, const string &uci) {
+  ChessMove moves[LEGAL_MOVES_MAX];
+  size_t count = tracker.legalMoves(moves);
+  for (size_t i = 0; i < count; i++) {
+    if (moves[i].uci() == uci) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// feed the positions in order, Returns the move that led to the last one
+static ChessMove play(ChessMoveTracker &tracker, const vector<const char *> &fens) {
+  ChessMove move = {};
+  for (auto fen : fens) {
+    CHECK(tracker.update(position(fen), &move));
+  }
+  return move;
+}
+
+int main() {
+  // perft
+  {
+    struct Case {
+      const char *fen;
+      vector<uint64_t> nodes;
+    };
+    const Case cases[] = {
+        {START, {20, 400, 8902, 197281}},
+        {KIWIPETE, {48, 2039, 97862}},
+        {ENDGAME, {14, 191, 2812, 43238}},
+    };
+    for (auto &c : cases) {
+      ChessMoveTracker tracker;
+      tracker.reset(position(c.fen), true);
+      for (size_t depth = 1; depth <= c.nodes.size(); depth++) {
+        auto nodes = perft(tracker, static_cast<int>(depth));
+        if (nodes != c.nodes[depth - 1]) {
+          fprintf(stderr, "perft %zu of %s: %llu, expected %llu\n", depth, c.fen,
+                  static_cast<unsigned long long>(nodes), static_cast<unsigned long long>(c.nodes[depth - 1]));
+          checkFailures()++;
+        }
+      }
+    }
+  }
+
+  // initial state and rights derived by reset
+  {
+    ChessMoveTracker tracker;
+    CHECK(tracker.fen() == "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1");
+    tracker.reset(position(KIWIPETE), true);
+    CHECK(tracker.castlingRights() == 15);
+    tracker.reset(position(ENDGAME), true);
+    CHECK(tracker.castlingRights() == 0);
+  }
+
+  // castling through or out of check is refused, the other side is allowed
+  {
+    ChessMoveTracker tracker;
+    tracker.reset(position("4kr2/8/8/8/8/8/8/R3K2R"), true);
+    CHECK(!hasMove(tracker, "e1g1"));
+    CHECK(hasMove(tracker, "e1c1"));
+    CHECK(!tracker.update(position("4kr2/8/8/8/8/8/8/R4RK1")));
+
+    tracker.reset(position("4k3/8/8/8/8/8/8/R3K2R"), true);
+    auto move = play(tracker, {"4k3/8/8/8/8/8/8/R4RK1"});
+    CHECK(move.uci() == "e1g1");
+    CHECK(move.flags & ChessMove::Castle);
+    CHECK(tracker.castlingRights() == 0);
+
+    tracker.reset(position("4k3/8/8/8/4r3/8/8/R3K2R"), true);
+    CHECK(!hasMove(tracker, "e1g1") && !hasMove(tracker, "e1c1"));
+  }
+
+  // a king or rook move gives up its rights
+  {
+    ChessMoveTracker tracker;
+    tracker.reset(position("r3k2r/8/8/8/8/8/8/R3K2R"), true);
+    play(tracker, {"r3k2r/8/8/8/8/8/8/1R2K2R"});
+    CHECK(tracker.castlingRights() == (ChessMoveTracker::WhiteKingside | ChessMoveTracker::BlackKingside |
+                                       ChessMoveTracker::BlackQueenside));
+    play(tracker, {"r4k1r/8/8/8/8/8/8/1R2K2R"});
+    CHECK(tracker.castlingRights() == ChessMoveTracker::WhiteKingside);
+  }
+
+  // en passant is known from the double push before it
+  {
+    ChessMoveTracker tracker;
+    play(tracker, {"rnbqkbnr/pppppppp/8/8/4P3/8/PPPP1PPP/RNBQKBNR", "rnbqkbnr/1ppppppp/p7/8/4P3/8/PPPP1PPP/RNBQKBNR",
+                   "rnbqkbnr/1ppppppp/p7/4P3/8/8/PPPP1PPP/RNBQKBNR"});
+    auto push = play(tracker, {"rnbqkbnr/1pp1pppp/p7/3pP3/8/8/PPPP1PPP/RNBQKBNR"});
+    CHECK(push.flags & ChessMove::DoublePush);
+    CHECK(tracker.fen() == "rnbqkbnr/1pp1pppp/p7/3pP3/8/8/PPPP1PPP/RNBQKBNR w KQkq d6 0 3");
+    auto capture = play(tracker, {"rnbqkbnr/1pp1pppp/p2P4/8/8/8/PPPP1PPP/RNBQKBNR"});
+    CHECK(capture.uci() == "e5d6");
+    CHECK(capture.flags & ChessMove::EnPassant);
+    CHECK(capture.captured == BoardState::BlackPawn);
+
+    // a single push does not allow it
+    ChessMoveTracker late;
+    late.reset(position("4k3/8/3p4/4P3/8/8/8/4K3"), false);
+    play(late, {"4k3/8/8/3pP3/8/8/8/4K3"});
+    CHECK(!hasMove(late, "e5d6"));
+  }
+
+  // the promotion piece is read off the board
+  {
+    ChessMoveTracker tracker;
+    tracker.reset(position("8/P6k/8/8/8/8/8/K7"), true);
+    auto queen = tracker;
+    auto move = play(queen, {"Q7/7k/8/8/8/8/8/K7"});
+    CHECK(move.uci() == "a7a8q");
+    CHECK(move.promotion == BoardState::WhiteQueen);
+    CHECK(move.flags & ChessMove::Promotion);
+    auto knight = tracker;
+    CHECK(play(knight, {"N7/7k/8/8/8/8/8/K7"}).uci() == "a7a8n");
+    ChessMove moves[LEGAL_MOVES_MAX];
+    CHECK(tracker.legalMoves(moves) == 3 + 4);
+  }
+
+  // pinned pieces stay, a king in check must answer it
+  {
+    ChessMoveTracker tracker;
+    tracker.reset(position("4r1k1/8/8/8/8/8/4B3/4K3"), true);
+    CHECK(!hasMove(tracker, "e2d3"));
+    CHECK(!tracker.update(position("4r1k1/8/8/8/8/3B4/8/4K3")));
+    tracker.reset(position("4k3/8/8/8/8/3n4/8/R3K3"), true);
+    ChessMove moves[LEGAL_MOVES_MAX];
+    CHECK(tracker.legalMoves(moves) == 4);
+  }
+
+  // replay starts over at the initial position and takes any other first
+  // position as the start of a game
+  {
+    auto moves = ChessMoveTracker::replay({START, "rnbqkbnr/pppppppp/8/8/4P3/8/PPPP1PPP/RNBQKBNR", START,
+                                           "rnbqkbnr/pppppppp/8/8/3P4/8/PPP1PPPP/RNBQKBNR"});
+    CHECK(moves.size() == 2);
+    CHECK(moves.size() == 2 && moves[0].uci() == "e2e4" && moves[1].uci() == "d2d4");
+
+    moves = ChessMoveTracker::replay({"4k3/8/8/8/8/8/4P3/4K3", "4k3/8/8/8/4P3/8/8/4K3", "3k4/8/8/8/4P3/8/8/4K3"});
+    CHECK(moves.size() == 2 && moves[0].uci() == "e2e4" && moves[1].uci() == "e8d8");
+  }
+  return checkResult();
+}
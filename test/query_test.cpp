@@ -0,0 +1,54 @@
+// Queries against mock boards, with the response opcodes the SDK expects and
+// with opcodes it does not know.
+
+#include "Check.h"
+#include "MockBoard.h"
+
+int main() {
+  {
+    MockBoards boards(1);
+    boards.addGame(0, {MockBoards::initialBoard()});
+    auto link = ChessLink::fromHidrawConnect(boards.path(0));
+    CHECK(link->connect());
+    CHECK(link->getMcuVersion() == MOCK_MCU_VERSION);
+    CHECK(link->getBleVersion() == MOCK_BLE_VERSION);
+    CHECK(link->getBattery() == 80);
+    CHECK(link->getFileCount() == 1);
+    auto stats = link->getRequestStats();
+    CHECK(stats.matched == 4 && stats.fallbacks == 0 && stats.unmatched == 0);
+    link->disconnect();
+  }
+
+  // a firmware answering the version and file count queries with other
+  // opcodes still answers them, in the order they were sent
+  {
+    MockBoards boards(1);
+    boards.setResponse(0x27, 0x2B);
+    boards.setResponse(0x31, 0x3B);
+    boards.addGame(0, {MockBoards::initialBoard()});
+    boards.addGame(0, {MockBoards::initialBoard()});
+    auto link = ChessLink::fromHidrawConnect(boards.path(0));
+    CHECK(link->connect());
+    CHECK(link->getMcuVersion() == MOCK_MCU_VERSION);
+    CHECK(link->getFileCount() == 2);
+    auto info = link->queryDeviceInfo();
+    CHECK(info.mcuVersion == MOCK_MCU_VERSION);
+    CHECK(info.bleVersion == MOCK_BLE_VERSION);
+    CHECK(info.battery == 80);
+    CHECK(info.fileCount == 2);
+    auto stats = link->getRequestStats();
+    CHECK(stats.matched == 1 && stats.fallbacks == 5 && stats.unmatched == 0);
+
+    // a report that answers nothing is counted
+    const unsigned char stray[] = {0x3C, 0x01, 0x00};
+    CHECK(boards.send(0, stray, sizeof(stray)));
+    auto deadline = chrono::steady_clock::now() + chrono::seconds(2);
+    while (link->getRequestStats().unmatched == 0 && chrono::steady_clock::now() < deadline) {
+      this_thread::sleep_for(chrono::milliseconds(5));
+    }
+    CHECK(link->getRequestStats().unmatched == 1);
+    link->disconnect();
+  }
+
+  return checkResult();
+}
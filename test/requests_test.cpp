@@ -0,0 +1,78 @@
+// Matching of query responses to the requests waiting for them.
+
+#include "Check.h"
+#include "EasyLink.h"
+
+static bool completed(const ResponseHandle &handle) {
+  return handle.wait_for(chrono::seconds(0)) == future_status::ready;
+}
+
+int main() {
+  // a report completes the oldest request waiting for its opcode
+  {
+    ChessRequests requests;
+    ResponseHandle first, second;
+    requests.add(0x2A, &first);
+    requests.add(0x2A, &second);
+    const unsigned char report[] = {0x2A, 0x02, 55, 0};
+    CHECK(requests.complete(report, sizeof(report)));
+    CHECK(completed(first) && first.get().at(2) == 55);
+    CHECK(!completed(second));
+    auto stats = requests.stats();
+    CHECK(stats.matched == 1 && stats.fallbacks == 0 && stats.unmatched == 0);
+  }
+
+  // a report nobody waits for completes the oldest request allowing a
+  // fallback, whatever its opcode
+  {
+    ChessRequests requests;
+    requests.allowFallback(0x28);
+    requests.allowFallback(0x32);
+    ResponseHandle count, version, battery;
+    requests.add(0x32, &count);
+    requests.add(0x28, &version);
+    requests.add(0x2A, &battery);
+    const unsigned char report[] = {0x33, 0x01, 3};
+    CHECK(requests.complete(report, sizeof(report)));
+    CHECK(completed(count) && count.get().at(0) == 0x33);
+    CHECK(!completed(version) && !completed(battery));
+    CHECK(requests.complete(report, sizeof(report)));
+    CHECK(completed(version));
+    // the battery request does not allow a fallback
+    CHECK(!requests.complete(report, sizeof(report)));
+    CHECK(!completed(battery));
+    auto stats = requests.stats();
+    CHECK(stats.matched == 0 && stats.fallbacks == 2 && stats.unmatched == 1);
+  }
+
+  // a report that must not fall back is counted as unmatched instead
+  {
+    ChessRequests requests;
+    requests.allowFallback(0x28);
+    ResponseHandle version;
+    requests.add(0x28, &version);
+    const unsigned char battery[] = {0x2A, 0x02, 80, 0};
+    CHECK(!requests.complete(battery, sizeof(battery), false));
+    CHECK(!completed(version));
+    CHECK(requests.stats().unmatched == 1);
+    const unsigned char report[] = {0x28, 0x02, 1, 'x'};
+    CHECK(requests.complete(report, sizeof(report), false));
+    CHECK(completed(version));
+    CHECK(requests.stats().matched == 1);
+  }
+
+  // cancelled requests fail with an empty response and are not completed
+  // again
+  {
+    ChessRequests requests;
+    requests.allowFallback(0x28);
+    ResponseHandle version;
+    auto id = requests.add(0x28, &version);
+    requests.cancel(0x28, id);
+    CHECK(completed(version) && version.get().empty());
+    const unsigned char report[] = {0x28, 0x01, 1};
+    CHECK(!requests.complete(report, sizeof(report)));
+  }
+
+  return checkResult();
+}
@@ -0,0 +1,91 @@
+// Lift and place events between two positions, BoardState::diff and
+// BoardState::events on positions parsed from FEN placement fields.
+
+#include "ChessBoard.h"
+#include "Check.h"
+#include <string>
+
+using namespace std;
+
+static BoardState position(const char *fen) {
+  BoardState board = {};
+  CHECK(BoardState::fromFen(fen, board));
+  return board;
+}
+
+static string squareName(int square) {
+  return {static_cast<char>('a' + square % 8), static_cast<char>('1' + square / 8)};
+}
+
+// the events as text, e.g. "lift e2 P, place e4 P"
+static string describe(const ChessSquareEvent *events, size_t count) {
+  static const char PIECES[] = "0qkbpnRPrBNQK";
+  string text;
+  for (size_t i = 0; i < count; i++) {
+    text += i > 0 ? ", " : "";
+    text += events[i].type == ChessSquareEvent::Lift ? "lift " : "place ";
+    text += squareName(events[i].square) + ' ' + PIECES[events[i].piece];
+  }
+  return text;
+}
+
+int main() {
+  struct Case {
+    const char *name;
+    const char *before;
+    const char *after;
+    const char *events;
+  };
+  const Case cases[] = {
+      {"quiet move", "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR", "rnbqkbnr/pppppppp/8/8/4P3/8/PPPP1PPP/RNBQKBNR",
+       "lift e2 P, place e4 P"},
+      {"capture", "4k3/8/8/3p4/4P3/8/8/4K3", "4k3/8/8/3P4/8/8/8/4K3", "lift e4 P, lift d5 p, place d5 P"},
+      {"kingside castling", "4k3/8/8/8/8/8/8/4K2R", "4k3/8/8/8/8/8/8/5RK1",
+       "lift e1 K, lift h1 R, place f1 R, place g1 K"},
+      {"queenside castling", "r3k3/8/8/8/8/8/8/4K3", "2kr4/8/8/8/8/8/8/4K3",
+       "lift a8 r, lift e8 k, place c8 k, place d8 r"},
+      {"en passant", "4k3/8/8/3pP3/8/8/8/4K3", "4k3/8/3P4/8/8/8/8/4K3", "lift d5 p, lift e5 P, place d6 P"},
+      {"promotion", "8/P6k/8/8/8/8/8/K7", "Q7/7k/8/8/8/8/8/K7", "lift a7 P, place a8 Q"},
+      {"capturing underpromotion", "r6k/1P6/8/8/8/8/8/K7", "N6k/8/8/8/8/8/8/K7", "lift b7 P, lift a8 r, place a8 N"},
+      {"lifted piece", "4k3/8/8/8/8/8/4P3/4K3", "4k3/8/8/8/8/8/8/4K3", "lift e2 P"},
+      {"placed piece", "4k3/8/8/8/8/8/8/4K3", "4k3/8/8/8/8/8/8/3QK3", "place d1 Q"},
+      {"piece swapped in place", "4k3/8/8/8/8/8/8/3QK3", "4k3/8/8/8/8/8/8/3RK3", "lift d1 Q, place d1 R"},
+      {"unchanged", "4k3/8/8/8/8/8/8/4K3", "4k3/8/8/8/8/8/8/4K3", ""},
+  };
+
+  for (auto &c : cases) {
+    auto before = position(c.before);
+    auto after = position(c.after);
+    ChessSquareEvent events[SQUARE_EVENTS_MAX];
+    auto count = before.events(after, 42, events);
+    auto text = describe(events, count);
+    if (text != c.events) {
+      fprintf(stderr, "%s: \"%s\", expected \"%s\"\n", c.name, text.c_str(), c.events);
+      checkFailures()++;
+    }
+    for (size_t i = 0; i < count; i++) {
+      CHECK(events[i].timestamp == 42);
+    }
+
+    // the diff holds exactly the squares of the events, in both directions
+    uint64_t squares = 0;
+    for (size_t i = 0; i < count; i++) {
+      squares |= 1ull << events[i].square;
+    }
+    CHECK(before.diff(after) == squares);
+    CHECK(after.diff(before) == squares);
+    CHECK((before == after) == (count == 0));
+  }
+
+  // every square emptied and filled at once still fits
+  {
+    auto full = position("rnbqkbnr/pppppppp/qqqqqqqq/QQQQQQQQ/qqqqqqqq/QQQQQQQQ/PPPPPPPP/RNBQKBNR");
+    auto swapped = position("RNBQKBNR/PPPPPPPP/QQQQQQQQ/qqqqqqqq/QQQQQQQQ/qqqqqqqq/pppppppp/rnbqkbnr");
+    ChessSquareEvent events[SQUARE_EVENTS_MAX];
+    CHECK(full.events(swapped, 0, events) == SQUARE_EVENTS_MAX);
+    CHECK(events[0].type == ChessSquareEvent::Lift && events[63].type == ChessSquareEvent::Lift);
+    CHECK(events[64].type == ChessSquareEvent::Place && events[64].square == 0);
+    CHECK(events[64].piece == BoardState::BlackRook);
+  }
+  return checkResult();
+}
@@ -0,0 +1,67 @@
+// Boards driven by a ChessUringLoop: queries, realtime positions, commands
+// and reconnects against mock boards.
+
+#include "ChessUring.h"
+#include "Check.h"
+#include "MockBoard.h"
+
+// exit status ctest reports as skipped
+constexpr int SKIPPED = 77;
+
+static atomic<uint64_t> positions[4];
+
+// board callback of board I
+template <size_t I> static void onBoard(const uint8_t *, uint64_t) { positions[I]++; }
+static const BoardCallback CALLBACKS[] = {onBoard<0>, onBoard<1>, onBoard<2>, onBoard<3>};
+
+int main() {
+  auto loop = ChessUringLoop::create();
+  if (!loop) {
+    fprintf(stderr, "io_uring is not available\n");
+    return SKIPPED;
+  }
+
+  MockBoards boards(4);
+  vector<shared_ptr<ChessLink>> links;
+  for (size_t i = 0; i < boards.size(); i++) {
+    boards.setBattery(i, static_cast<unsigned char>(50 + i));
+    auto link = ChessLink::fromUringLoop(loop, boards.path(i));
+    link->setBoardCallback(CALLBACKS[i]);
+    CHECK(link->connect());
+    links.push_back(link);
+  }
+
+  // queries of all boards answered through the one loop
+  for (size_t i = 0; i < links.size(); i++) {
+    CHECK(links[i]->getBattery() == 50 + i);
+    CHECK(links[i]->getMcuVersion() == MOCK_MCU_VERSION);
+  }
+
+  // realtime positions reach the callback of their own board only
+  auto board = MockBoards::initialBoard();
+  CHECK(boards.sendBoard(2, board.data()));
+  auto deadline = chrono::steady_clock::now() + chrono::seconds(2);
+  while (positions[2] == 0 && chrono::steady_clock::now() < deadline) {
+    this_thread::sleep_for(chrono::milliseconds(5));
+  }
+  CHECK(positions[2] == 1);
+  CHECK(positions[0] == 0 && positions[1] == 0 && positions[3] == 0);
+
+  // commands are written by the loop
+  CHECK(links[1]->setLedAsync({bitset<8>("10000001")}).get() > 0);
+  CHECK(boards.waitCommands(1, 0x0a, 1, chrono::seconds(2)));
+  CHECK(boards.commands(0, 0x0a) == 0);
+
+  // a board that disconnects and connects again is driven again
+  links[3]->disconnect();
+  CHECK(links[3]->connect());
+  CHECK(links[3]->getBattery() == 53);
+
+  auto stats = loop->getStats();
+  CHECK(stats.reports > 0 && stats.writes > 0);
+
+  for (auto &link : links) {
+    link->disconnect();
+  }
+  return checkResult();
+}